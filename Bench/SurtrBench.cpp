@@ -0,0 +1,377 @@
+#include "pch.h"
+#include "Fracture.h"
+#include "Profiler.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Headless fracture benchmark.
+// Usage : SurtrBench [model index] [impact count] [--seed n] [--radius r] [--general] [--resources dir] [--hull n] [--refit k] [--dual] [--voro-wall] [--split]
+//                   [--threads n] [--pin] [--stats] [--memory] [--trace file]
+// --hull n runs only the convex hull microbenchmark, n times per point limit.
+// --refit k refits the pieces with a fixed k-DOP (6, 14, 18, 26) instead of the ICH normals.
+// --dual generates the Voronoi cells from the Delaunay dual instead of voro++.
+// --voro-wall cuts the convex of each piece in a voro++ container walled by its planes, instead of clipping.
+// --split splits each piece by all of its cells in one recursive pass, instead of clipping it per cell.
+// --threads n runs the thread pool with n workers, 0 is the hardware concurrency. --pin pins each of them to one logical processor.
+// --stats prints the counters of each worker after each fracture.
+// --memory prints the pieces held by the piece store after each fracture. Replaced compounds are released, so it should not keep growing.
+// --trace file writes the profiler zones of the whole run as a Chrome trace, if built with SURTR_PROFILE.
+
+using DirectX::SimpleMath::Vector3;
+
+struct BenchModel
+{
+	const char*		FileName;
+	float			Scale;
+};
+
+// Same table as Surtr::CreateCommandListDependentResources.
+static constexpr BenchModel c_benchModels[] =
+{
+	{ "lowpoly-bunny-closed.obj",	70.0f },
+	{ "cube.obj",					3.0f },
+	{ "pumpkin.obj",				0.15f },
+	{ "cylinder.obj",				3.0f },
+	{ "highpoly-sphere.obj",		5.0f },
+	{ "cessna.obj",					0.6f },
+	{ "shuttle.obj",				1.0f },
+};
+
+struct BenchArgument
+{
+	int				ModelIndex = 0;
+	int				ImpactCount = 3;
+	int				Seed = 46354;
+	float			ImpactRadius = 1.0f;
+	bool			PartialFracture = true;
+	int				HullIteration = 0;
+	Fracture::RefittingMode	Refitting = Fracture::RefittingMode::ICH;
+	Fracture::VoronoiMode	Voronoi = Fracture::VoronoiMode::VoroPlusPlus;
+	Fracture::ConvexFractureMode	ConvexFracture = Fracture::ConvexFractureMode::Clip;
+	bool			RecursiveSplit = false;
+	int				ThreadCnt = 0;
+	bool			PinThreads = false;
+	bool			PrintStats = false;
+	bool			PrintMemory = false;
+	std::string		TraceFileName;
+	std::string		ResourceDir = "Resources/Models/";
+};
+
+// Mirrors the assimp import flags of Surtr::LoadModelData.
+// (Triangulate | FlipWindingOrder | JoinIdenticalVertices, x negated)
+static bool LoadObj(_In_ const std::string& fileName,
+					_In_ const float scale,
+					_Out_ std::vector<Vector3>& vertices,
+					_Out_ std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	std::ifstream file(fileName);
+	if (FALSE == file.is_open())
+		return false;
+
+	std::vector<int> remap;
+	std::map<std::tuple<float, float, float>, int> joined;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string tag;
+		stream >> tag;
+
+		if (tag == "v")
+		{
+			float x, y, z;
+			stream >> x >> y >> z;
+
+			const auto res = joined.insert({ std::make_tuple(x, y, z), (int)vertices.size() });
+			if (TRUE == res.second)
+				vertices.push_back(Vector3(-x * scale, y * scale, z * scale));
+
+			remap.push_back(res.first->second);
+		}
+		else if (tag == "f")
+		{
+			std::vector<int> face;
+			std::string token;
+			while (stream >> token)
+			{
+				// Only position index is used. (v, v/vt, v//vn, v/vt/vn)
+				int index = std::stoi(token.substr(0, token.find('/')));
+				index = index < 0 ? (int)remap.size() + index : index - 1;
+				face.push_back(remap[index]);
+			}
+
+			// Fan triangulation with flipped winding order.
+			for (int i = 1; i + 1 < face.size(); i++)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[i + 1]);
+				indices.push_back(face[i]);
+			}
+		}
+	}
+
+	return FALSE == vertices.empty();
+}
+
+static BenchArgument CollectBenchArgument(int argc, char** argv)
+{
+	BenchArgument arguments;
+
+	int positional = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--seed" && i + 1 < argc)
+			arguments.Seed = std::stoi(argv[++i]);
+		else if (arg == "--radius" && i + 1 < argc)
+			arguments.ImpactRadius = std::stof(argv[++i]);
+		else if (arg == "--resources" && i + 1 < argc)
+			arguments.ResourceDir = argv[++i];
+		else if (arg == "--hull" && i + 1 < argc)
+			arguments.HullIteration = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--refit" && i + 1 < argc)
+		{
+			switch (std::stoi(argv[++i]))
+			{
+			case 6:		arguments.Refitting = Fracture::RefittingMode::Kdop6; break;
+			case 14:	arguments.Refitting = Fracture::RefittingMode::Kdop14; break;
+			case 18:	arguments.Refitting = Fracture::RefittingMode::Kdop18; break;
+			case 26:	arguments.Refitting = Fracture::RefittingMode::Kdop26; break;
+			default:	arguments.Refitting = Fracture::RefittingMode::ICH; break;
+			}
+		}
+		else if (arg == "--dual")
+			arguments.Voronoi = Fracture::VoronoiMode::DelaunayDual;
+		else if (arg == "--voro-wall")
+			arguments.ConvexFracture = Fracture::ConvexFractureMode::VoroWall;
+		else if (arg == "--split")
+			arguments.RecursiveSplit = true;
+		else if (arg == "--threads" && i + 1 < argc)
+			arguments.ThreadCnt = std::max(0, std::stoi(argv[++i]));
+		else if (arg == "--pin")
+			arguments.PinThreads = true;
+		else if (arg == "--stats")
+			arguments.PrintStats = true;
+		else if (arg == "--memory")
+			arguments.PrintMemory = true;
+		else if (arg == "--trace" && i + 1 < argc)
+			arguments.TraceFileName = argv[++i];
+		else if (arg == "--general")
+			arguments.PartialFracture = false;
+		else if (positional == 0)
+		{
+			arguments.ModelIndex = std::clamp(std::stoi(arg), 0, (int)std::size(c_benchModels) - 1);
+			positional++;
+		}
+		else if (positional == 1)
+		{
+			arguments.ImpactCount = std::max(0, std::stoi(arg));
+			positional++;
+		}
+	}
+
+	return arguments;
+}
+
+// Counters since the last call, in the order of the workers.
+static void PrintThreadPoolStats()
+{
+	const std::vector<dp::worker_stats> statsVec = g_threadPool.stats();
+	g_threadPool.reset_stats();
+
+	std::printf("  %-8s %10s %10s %12s %10s\n", "Worker", "Tasks", "Stolen", "Idle ms", "Max queue");
+	for (int i = 0; i < statsVec.size(); i++)
+	{
+		const dp::worker_stats& stats = statsVec[i];
+		std::printf("  %-8d %10llu %10llu %12.3f %10zu\n", i, (unsigned long long)stats.tasks_executed, (unsigned long long)stats.tasks_stolen,
+					std::chrono::duration<double, std::milli>(stats.idle_time).count(), stats.max_queue_depth);
+	}
+
+	std::printf("\n");
+}
+
+static void PrintPieceStoreStats(const Fracture::PieceStore& pieceStore)
+{
+	const Fracture::PieceStoreStats stats = pieceStore.GetStats();
+
+	std::printf("  Live pieces %zu / Slots %zu / Live %.3f MB / Total %.3f MB\n\n", stats.LivePieceCnt, stats.SlotCnt,
+				stats.LiveBytes / (1024.0 * 1024.0), stats.TotalBytes / (1024.0 * 1024.0));
+}
+
+static void PrintResult(const char* title, const Fracture::FractureResult& result, const Fracture::PieceStore& pieceStore,
+						const std::vector<Fracture::Compound>& compoundVec)
+{
+	size_t pieceCnt = 0;
+	size_t convexVertexCnt = 0;
+	size_t meshVertexCnt = 0;
+	for (const auto& compound : compoundVec)
+	{
+		pieceCnt += compound.PieceVec.size();
+		for (const Fracture::PieceHandle handle : compound.PieceVec)
+		{
+			const Fracture::Piece* piece = pieceStore.Get(handle);
+			convexVertexCnt += piece->GetConvex().size();
+			meshVertexCnt += piece->GetMesh().size();
+		}
+	}
+
+	double total = 0.0;
+	std::printf("[%s]\n", title);
+	for (const Fracture::FractureStage& stage : result.StageVec)
+	{
+		std::printf("  %-20s %10.3f ms\n", stage.Name, stage.ElapsedMs);
+		total += stage.ElapsedMs;
+	}
+	std::printf("  %-20s %10.3f ms\n", "Total", total);
+	std::printf("  Compounds %zu / Pieces %zu / Convex vertices %zu / Mesh vertices %zu\n\n", compoundVec.size(), pieceCnt, convexVertexCnt, meshVertexCnt);
+}
+
+// Throughput of VMACH::ConvexHull on the model vertices, without and with the thread pool.
+// Point limits are the ICH default (GenerateICHNormal) and 0, which builds the full hull.
+// Then VMACH::QuickHull, which only finds the exact hull vertices.
+static void RunHullBench(const std::vector<Vector3>& vertices, const int iteration)
+{
+	const Fracture::FractureArgs defaultArgs;
+
+	for (const int limit : { defaultArgs.ICHIncludePointLimit, 0 })
+	{
+		for (dp::thread_pool<>* threadPool : { (dp::thread_pool<>*)nullptr, &g_threadPool })
+		{
+			size_t faceCnt = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iteration; i++)
+			{
+				VMACH::ConvexHull hull(vertices, limit, threadPool);
+				faceCnt = hull.GetFaces().size();
+			}
+			const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			std::printf("[ConvexHull limit %d%s]\n", limit, threadPool == nullptr ? "" : " / thread pool");
+			std::printf("  %-20s %10.3f ms\n", "Per hull", elapsedMs / iteration);
+			std::printf("  %-20s %10.1f\n", "Hulls per second", iteration * 1000.0 / elapsedMs);
+			std::printf("  Iterations %d / Faces %zu\n\n", iteration, faceCnt);
+		}
+	}
+
+	// Exact hull prefilter of GenerateICHNormal.
+	size_t hullPointCnt = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iteration; i++)
+	{
+		VMACH::QuickHull exactHull(vertices);
+		hullPointCnt = exactHull.GetHullPointIDs().size();
+	}
+	const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("[QuickHull]\n");
+	std::printf("  %-20s %10.3f ms\n", "Per hull", elapsedMs / iteration);
+	std::printf("  %-20s %10.1f\n", "Hulls per second", iteration * 1000.0 / elapsedMs);
+	std::printf("  Iterations %d / Hull points %zu / Discarded points %zu\n\n", iteration, hullPointCnt, vertices.size() - hullPointCnt);
+}
+
+int main(int argc, char** argv)
+{
+	const BenchArgument arguments = CollectBenchArgument(argc, argv);
+	const BenchModel& model = c_benchModels[arguments.ModelIndex];
+
+	std::vector<Vector3> vertices;
+	std::vector<uint32_t> indices;
+	const std::string modelPath = (std::filesystem::path(arguments.ResourceDir) / model.FileName).string();
+	if (FALSE == LoadObj(modelPath, model.Scale, vertices, indices))
+	{
+		std::fprintf(stderr, "Failed to load %s\n", modelPath.c_str());
+		return 1;
+	}
+
+	std::vector<Vector3> spherePointCloud;
+	std::vector<uint32_t> sphereIndices;
+	const std::string spherePath = (std::filesystem::path(arguments.ResourceDir) / "sphere.obj").string();
+	if (FALSE == LoadObj(spherePath, 0.5f, spherePointCloud, sphereIndices))
+	{
+		std::fprintf(stderr, "Failed to load %s\n", spherePath.c_str());
+		return 1;
+	}
+
+	g_threadPool.reset(arguments.ThreadCnt, arguments.PinThreads);
+
+	std::printf("%s : %zu vertices / %zu triangles / %zu threads\n\n", model.FileName, vertices.size(), indices.size() / 3, g_threadPool.size());
+
+	if (arguments.HullIteration > 0)
+	{
+		RunHullBench(vertices, arguments.HullIteration);
+		return 0;
+	}
+
+	Fracture::FractureEngine engine;
+	engine.SetSpherePointCloud(spherePointCloud);
+
+	Fracture::FractureArgs& fractureArgs = engine.GetArgs();
+	fractureArgs.Seed = arguments.Seed;
+	fractureArgs.ImpactRadius = arguments.ImpactRadius;
+	fractureArgs.PartialFracture = arguments.PartialFracture;
+	fractureArgs.Refitting = arguments.Refitting;
+	fractureArgs.Voronoi = arguments.Voronoi;
+	fractureArgs.ConvexFracture = arguments.ConvexFracture;
+	fractureArgs.RecursiveSplit = arguments.RecursiveSplit;
+
+	Profiler::SetThreadName("Main");
+	if (FALSE == arguments.TraceFileName.empty())
+		Profiler::BeginCapture();
+
+	std::vector<Fracture::Compound> compoundVec = { engine.PrepareFracture(vertices, indices) };
+	PrintResult("PrepareFracture", engine.GetResult(), engine.GetPieceStore(), compoundVec);
+	if (TRUE == arguments.PrintStats)
+		PrintThreadPoolStats();
+	if (TRUE == arguments.PrintMemory)
+		PrintPieceStoreStats(engine.GetPieceStore());
+
+	std::mt19937 gen(arguments.Seed);
+	for (int i = 0; i < arguments.ImpactCount; i++)
+	{
+		// Hit the largest compound at one of its surface vertices.
+		const auto target = std::max_element(compoundVec.begin(), compoundVec.end(),
+											 [](const Fracture::Compound& a, const Fracture::Compound& b) { return a.PieceVec.size() < b.PieceVec.size(); });
+		if (target == compoundVec.end() || target->PieceVec.empty())
+			break;
+
+		const Fracture::Piece* piece = engine.GetPieceStore().Get(target->PieceVec[std::uniform_int_distribution<size_t>(0, target->PieceVec.size() - 1)(gen)]);
+		const Poly::Polyhedron& mesh = piece->GetMesh();
+		if (mesh.empty())
+			continue;
+
+		fractureArgs.ImpactPosition = mesh.Position(std::uniform_int_distribution<size_t>(0, mesh.size() - 1)(gen));
+
+		std::vector<Fracture::Compound> fracturedCompoundVec = engine.DoFracture(*target);
+
+		engine.GetPieceStore().ReleaseReplaced(*target, fracturedCompoundVec);
+		compoundVec.erase(target);
+		compoundVec.insert(compoundVec.end(), fracturedCompoundVec.begin(), fracturedCompoundVec.end());
+
+		char title[128];
+		std::snprintf(title, sizeof(title), "Impact %d (%.3f, %.3f, %.3f)", i, fractureArgs.ImpactPosition.x, fractureArgs.ImpactPosition.y, fractureArgs.ImpactPosition.z);
+		PrintResult(title, engine.GetResult(), engine.GetPieceStore(), compoundVec);
+		if (TRUE == arguments.PrintStats)
+			PrintThreadPoolStats();
+		if (TRUE == arguments.PrintMemory)
+			PrintPieceStoreStats(engine.GetPieceStore());
+	}
+
+	if (FALSE == arguments.TraceFileName.empty())
+	{
+		Profiler::EndCapture();
+		if (FALSE == Profiler::WriteChromeTrace(arguments.TraceFileName))
+			std::fprintf(stderr, "Failed to write %s\n", arguments.TraceFileName.c_str());
+	}
+
+	return 0;
+}
@@ -52,107 +52,342 @@ namespace DT
 		}
 	};
 
+	/* Triangle of the indexed mesh, counterclockwise.
+	   Edge i is opposite to vertexID[i], adjTriangle[i] is the triangle across it (-1 if none). */
+	struct IndexedTriangle
+	{
+		int vertexID[3];
+		int adjTriangle[3];
+	};
+
 	struct Delaunay 
 	{
 		std::vector<Triangle> triangles;
 		std::vector<Edge> edges;
+
+		/* Same order as triangles. Vertex IDs are in insertion order of the points. */
+		std::vector<IndexedTriangle> indexedTriangles;
 	};
 
-	Delaunay triangulate(const std::vector<Vector2>& points)
+	/* Index of the point on the 2D Hilbert curve of n x n cells. */
+	uint64_t hilbertIndex(uint32_t x, uint32_t y, const uint32_t n)
 	{
-		if (points.size() < 3) 
-			return Delaunay{};
+		uint64_t d = 0;
+		for (uint32_t s = n / 2; s > 0; s /= 2)
+		{
+			const uint32_t rx = (x & s) > 0;
+			const uint32_t ry = (y & s) > 0;
+			d += (uint64_t)s * s * ((3 * rx) ^ ry);
 
-		auto xmin = points[0].x;
-		auto xmax = xmin;
-		auto ymin = points[0].y;
-		auto ymax = ymin;
-		
-		for (auto const& pt : points) 
+			if (ry == 0)
+			{
+				if (rx == 1)
+				{
+					x = n - 1 - x;
+					y = n - 1 - y;
+				}
+
+				std::swap(x, y);
+			}
+		}
+
+		return d;
+	}
+
+	/* Bowyer-Watson on an indexed mesh with edge adjacency.
+	   Points are inserted chunk by chunk, the bounds given first must cover all of them,
+	   they decide the super triangle. Points far out of the bounds, and duplicated points, are skipped. */
+	class Triangulator
+	{
+	public:
+		Triangulator(const Vector2& minBound, const Vector2& maxBound) : m_minBound(minBound), m_maxBound(maxBound)
 		{
-			xmin = std::min(xmin, pt.x);
-			xmax = std::max(xmax, pt.x);
-			ymin = std::min(ymin, pt.y);
-			ymax = std::max(ymax, pt.y);
+			const auto dx = maxBound.x - minBound.x;
+			const auto dy = maxBound.y - minBound.y;
+			const auto dmax = std::max(dx, dy);
+			const auto midx = (minBound.x + maxBound.x) / 2.0f;
+			const auto midy = (minBound.y + maxBound.y) / 2.0f;
+
+			/* Super triangle, counterclockwise. */
+			m_posVec.push_back({ midx - 20 * dmax, midy - dmax });
+			m_posVec.push_back({ midx + 20 * dmax, midy - dmax });
+			m_posVec.push_back({ midx, midy + 20 * dmax });
+
+			createTriangle({ 0, 1, 2 });
 		}
 
-		const auto dx = xmax - xmin;
-		const auto dy = ymax - ymin;
-		const auto dmax = std::max(dx, dy);
-		const auto midx = (xmin + xmax) / 2.0f;
-		const auto midy = (ymin + ymax) / 2.0f;
+		/* Chunk is sorted along the Hilbert curve, so the walk of the point location stays short. */
+		void insert(const std::vector<Vector2>& chunk)
+		{
+			constexpr uint32_t n = 1u << 16;
 
-		/* Init Delaunay triangulation. */
-		auto d = Delaunay{};
+			const auto extent = std::max(std::max(m_maxBound.x - m_minBound.x, m_maxBound.y - m_minBound.y), FLT_MIN);
+			const auto scale = (n - 1) / extent;
 
-		const auto p0 = Vector2{midx - 20 * dmax, midy - dmax};
-		const auto p1 = Vector2{midx, midy + 20 * dmax};
-		const auto p2 = Vector2{midx + 20 * dmax, midy - dmax};
-		d.triangles.emplace_back(Triangle{p0, p1, p2});
+			std::vector<std::pair<uint64_t, int>> orderVec(chunk.size());
+			for (int i = 0; i < chunk.size(); i++)
+			{
+				const auto qx = std::clamp((chunk[i].x - m_minBound.x) * scale, 0.0f, (float)(n - 1));
+				const auto qy = std::clamp((chunk[i].y - m_minBound.y) * scale, 0.0f, (float)(n - 1));
+				orderVec[i] = { hilbertIndex((uint32_t)qx, (uint32_t)qy, n), i };
+			}
 
-		for (auto const& pt : points) 
+			std::sort(orderVec.begin(), orderVec.end());
+
+			for (const auto& order : orderVec)
+				insertPoint(chunk[order.second]);
+		}
+
+		/* Triangulation of the points inserted so far, without the super triangle. */
+		Delaunay build() const
 		{
-			std::vector<Edge> edges;
-			std::vector<Triangle> tmps;
-			for (auto const& tri : d.triangles) 
+			Delaunay d;
+
+			std::vector<int> remap(m_triVec.size(), -1);
+			for (int t = 0; t < m_triVec.size(); t++)
+			{
+				const TriCell& tri = m_triVec[t];
+				if (TRUE == tri.dead || tri.vertexID[0] < 3 || tri.vertexID[1] < 3 || tri.vertexID[2] < 3)
+					continue;
+
+				remap[t] = d.indexedTriangles.size();
+				d.indexedTriangles.push_back(tri);
+			}
+
+			for (int t = 0; t < d.indexedTriangles.size(); t++)
 			{
-				/* Check if the point is inside the triangle circumcircle. */
-				const auto dist = Vector2::DistanceSquared(tri.circle.center, pt);
-				if ((dist - tri.circle.radius) <= eps) 
+				IndexedTriangle& tri = d.indexedTriangles[t];
+				for (int i = 0; i < 3; i++)
+				{
+					tri.vertexID[i] -= 3;
+					tri.adjTriangle[i] = tri.adjTriangle[i] == -1 ? -1 : remap[tri.adjTriangle[i]];
+				}
+
+				const auto& p0 = m_pointVec[tri.vertexID[0]];
+				const auto& p1 = m_pointVec[tri.vertexID[1]];
+				const auto& p2 = m_pointVec[tri.vertexID[2]];
+				d.triangles.emplace_back(p0, p1, p2);
+
+				/* Each edge once, from the lower index or from the hull. */
+				for (int i = 0; i < 3; i++)
 				{
-					edges.push_back(tri.e0);
-					edges.push_back(tri.e1);
-					edges.push_back(tri.e2);
+					if (tri.adjTriangle[i] == -1 || tri.adjTriangle[i] > t)
+						d.edges.emplace_back(m_pointVec[tri.vertexID[(i + 1) % 3]], m_pointVec[tri.vertexID[(i + 2) % 3]]);
 				}
-				else 
+			}
+
+			return d;
+		}
+
+	private:
+		struct TriCell : IndexedTriangle
+		{
+			double center[2];
+			double radiusSq;
+			bool dead;
+		};
+
+		static double orient2D(const std::array<double, 2>& a, const std::array<double, 2>& b, const std::array<double, 2>& c)
+		{
+			return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+		}
+
+		bool inCircumcircle(const TriCell& tri, const std::array<double, 2>& p) const
+		{
+			const double dx = p[0] - tri.center[0];
+			const double dy = p[1] - tri.center[1];
+
+			return dx * dx + dy * dy < tri.radiusSq;
+		}
+
+		int createTriangle(const std::array<int, 3>& vertexID)
+		{
+			int id;
+			if (m_freeTriVec.empty())
+			{
+				id = m_triVec.size();
+				m_triVec.emplace_back();
+				m_visitVec.push_back(-1);
+			}
+			else
+			{
+				id = m_freeTriVec.back();
+				m_freeTriVec.pop_back();
+			}
+
+			TriCell& tri = m_triVec[id];
+			std::copy(vertexID.begin(), vertexID.end(), tri.vertexID);
+			std::fill(tri.adjTriangle, tri.adjTriangle + 3, -1);
+			tri.dead = false;
+
+			/* Circumcircle, relative to the first vertex. */
+			const auto& a = m_posVec[vertexID[0]];
+			const double bx = m_posVec[vertexID[1]][0] - a[0], by = m_posVec[vertexID[1]][1] - a[1];
+			const double cx = m_posVec[vertexID[2]][0] - a[0], cy = m_posVec[vertexID[2]][1] - a[1];
+			const double b2 = bx * bx + by * by;
+			const double c2 = cx * cx + cy * cy;
+			const double s = 0.5 / (bx * cy - by * cx);
+			const double ux = (cy * b2 - by * c2) * s;
+			const double uy = (bx * c2 - cx * b2) * s;
+
+			tri.center[0] = a[0] + ux;
+			tri.center[1] = a[1] + uy;
+			tri.radiusSq = ux * ux + uy * uy;
+
+			return id;
+		}
+
+		/* Visibility walk, the first edge tested rotates each step so the walk does not cycle. */
+		int locate(const std::array<double, 2>& p) const
+		{
+			int tri = m_lastTri;
+			for (int step = 0; step < m_triVec.size(); step++)
+			{
+				const TriCell& cell = m_triVec[tri];
+
+				int next = -2;
+				for (int k = 0; k < 3; k++)
 				{
-					tmps.push_back(tri);
+					const int i = (k + step) % 3;
+					if (orient2D(m_posVec[cell.vertexID[(i + 1) % 3]], m_posVec[cell.vertexID[(i + 2) % 3]], p) < 0)
+					{
+						next = cell.adjTriangle[i];
+						break;
+					}
 				}
+
+				if (next == -2)
+					return tri;
+
+				if (next == -1)
+					return -1;
+
+				tri = next;
 			}
 
-			/* Delete duplicate edges. */
-			std::vector<bool> remove(edges.size(), false);
-			for (auto it1 = edges.begin(); it1 != edges.end(); ++it1)
+			return -1;
+		}
+
+		void insertPoint(const Vector2& point)
+		{
+			const std::array<double, 2> p = { point.x, point.y };
+
+			/* 1. Locate. */
+			int startTri = locate(p);
+			if (startTri == -1)
+				return;
+
+			const int* vertexID = m_triVec[startTri].vertexID;
+			if (std::any_of(vertexID, vertexID + 3, [&](const int v) { return m_posVec[v] == p; }))
+				return;
+
+			const int pointID = m_posVec.size();
+			m_posVec.push_back(p);
+			m_pointVec.push_back(point);
+
+			/* 2. Cavity. */
+			const int stamp = pointID;
+			m_cavityVec.clear();
+			m_cavityVec.push_back(startTri);
+			m_triVec[startTri].dead = true;
+			m_visitVec[startTri] = stamp;
+
+			for (int c = 0; c < m_cavityVec.size(); c++)
 			{
-				for (auto it2 = edges.begin(); it2 != edges.end(); ++it2) 
+				for (const int adj : m_triVec[m_cavityVec[c]].adjTriangle)
 				{
-					if (it1 == it2) 
+					if (adj == -1 || m_visitVec[adj] == stamp)
 						continue;
-					
-					if (*it1 == *it2) 
+
+					m_visitVec[adj] = stamp;
+					if (TRUE == inCircumcircle(m_triVec[adj], p))
 					{
-						remove[std::distance(edges.begin(), it1)] = true;
-						remove[std::distance(edges.begin(), it2)] = true;
+						m_triVec[adj].dead = true;
+						m_cavityVec.push_back(adj);
 					}
 				}
 			}
 
-			edges.erase(std::remove_if(edges.begin(), edges.end(), [&](auto const& e) { return remove[&e - &edges[0]]; }), edges.end());
+			/* 3. Connect the boundary edges to the point.
+			   New triangles share the edges from the point, keyed by their other vertex. */
+			m_openEdgeMap.clear();
+
+			for (const int cavityTri : m_cavityVec)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					const int outside = m_triVec[cavityTri].adjTriangle[i];
+					if (outside != -1 && TRUE == m_triVec[outside].dead)
+						continue;
+
+					std::array<int, 3> newVertexID = { m_triVec[cavityTri].vertexID[0], m_triVec[cavityTri].vertexID[1], m_triVec[cavityTri].vertexID[2] };
+					newVertexID[i] = pointID;
 
-			/* Update triangulation. */
-			for (auto const& e : edges) 
-				tmps.push_back({ e.p0, e.p1, {pt.x, pt.y} });
-			
-			d.triangles = tmps;
+					const int newTri = createTriangle(newVertexID);
+					m_triVec[newTri].adjTriangle[i] = outside;
+					if (outside != -1)
+					{
+						int* adjTriangle = m_triVec[outside].adjTriangle;
+						*std::find(adjTriangle, adjTriangle + 3, cavityTri) = newTri;
+					}
+
+					for (int j = 0; j < 3; j++)
+					{
+						if (j == i)
+							continue;
+
+						const int key = newVertexID[3 - i - j];
+						const auto res = m_openEdgeMap.insert({ key, { newTri, j } });
+						if (FALSE == res.second)
+						{
+							m_triVec[newTri].adjTriangle[j] = res.first->second.first;
+							m_triVec[res.first->second.first].adjTriangle[res.first->second.second] = newTri;
+							m_openEdgeMap.erase(res.first);
+						}
+					}
+
+					m_lastTri = newTri;
+				}
+			}
+
+			m_freeTriVec.insert(m_freeTriVec.end(), m_cavityVec.begin(), m_cavityVec.end());
 		}
 
-		/* Remove original super triangle. */
-		d.triangles.erase(std::remove_if(d.triangles.begin(), d.triangles.end(), 
-			[&](auto const& tri) 
-			{
-				return ((tri.p0 == p0 || tri.p1 == p0 || tri.p2 == p0) ||
-						(tri.p0 == p1 || tri.p1 == p1 || tri.p2 == p1) ||
-						(tri.p0 == p2 || tri.p1 == p2 || tri.p2 == p2));
-			}), d.triangles.end());
+		Vector2 m_minBound;
+		Vector2 m_maxBound;
+
+		std::vector<std::array<double, 2>> m_posVec;	/* Super triangle, then the inserted points. */
+		std::vector<Vector2> m_pointVec;				/* Inserted points. */
+
+		std::vector<TriCell> m_triVec;
+		std::vector<int> m_freeTriVec;
+		std::vector<int> m_visitVec;
+		std::vector<int> m_cavityVec;
+		std::unordered_map<int, std::pair<int, int>> m_openEdgeMap;
+		int m_lastTri = 0;
+	};
 
-		/* Add edges. */
-		for (auto const& tri : d.triangles) 
+	Delaunay triangulate(const std::vector<Vector2>& points)
+	{
+		if (points.size() < 3) 
+			return Delaunay{};
+
+		auto xmin = points[0].x;
+		auto xmax = xmin;
+		auto ymin = points[0].y;
+		auto ymax = ymin;
+		
+		for (auto const& pt : points) 
 		{
-			d.edges.push_back(tri.e0);
-			d.edges.push_back(tri.e1);
-			d.edges.push_back(tri.e2);
+			xmin = std::min(xmin, pt.x);
+			xmax = std::max(xmax, pt.x);
+			ymin = std::min(ymin, pt.y);
+			ymax = std::max(ymax, pt.y);
 		}
-		
-		return d;
+
+		Triangulator triangulator({ xmin, ymin }, { xmax, ymax });
+		triangulator.insert(points);
+
+		return triangulator.build();
 	}
 }
\ No newline at end of file
@@ -6,6 +6,7 @@ namespace DT3D
 {
 	using DirectX::SimpleMath::Vector3;
 	using DirectX::SimpleMath::Matrix;
+	using DirectX::SimpleMath::Plane;
 
 	void tetrahedron_circumcenter(
 		// In:
@@ -150,12 +151,359 @@ namespace DT3D
 		}
 	};
 
+	// Tetrahedron of the indexed mesh, positively oriented.
+	// Face i is opposite to VertexID[i], AdjTet[i] is the tetrahedron across it (-1 if none).
+	struct IndexedTetrahedron
+	{
+		int VertexID[4];
+		int AdjTet[4];
+	};
+
 	struct Delaunay
 	{
 		std::vector<Tetrahedron> TetVec;
 		std::vector<Triangle> FaceVec;
+
+		// Same order as TetVec. Vertex IDs are the indices of the input points.
+		std::vector<IndexedTetrahedron> IndexedTetVec;
 	};
 
+	// Working tetrahedron of Triangulate.
+	struct TetCell : IndexedTetrahedron
+	{
+		bool Dead;
+	};
+
+	// Index of the point on the 3D Hilbert curve, with 'bits' bits per axis.
+	// Transposes the axes and interleaves them. (Skilling, Programming the Hilbert curve, 2004)
+	uint64_t HilbertIndex(uint32_t x, uint32_t y, uint32_t z, const int bits)
+	{
+		uint32_t X[3] = { x, y, z };
+
+		// Inverse undo.
+		for (uint32_t Q = 1u << (bits - 1); Q > 1; Q >>= 1)
+		{
+			const uint32_t P = Q - 1;
+			for (int i = 0; i < 3; i++)
+			{
+				if (X[i] & Q)
+				{
+					X[0] ^= P;
+				}
+				else
+				{
+					const uint32_t t = (X[0] ^ X[i]) & P;
+					X[0] ^= t;
+					X[i] ^= t;
+				}
+			}
+		}
+
+		// Gray encode.
+		X[1] ^= X[0];
+		X[2] ^= X[1];
+
+		uint32_t t = 0;
+		for (uint32_t Q = 1u << (bits - 1); Q > 1; Q >>= 1)
+		{
+			if (X[2] & Q)
+				t ^= Q - 1;
+		}
+
+		for (int i = 0; i < 3; i++)
+			X[i] ^= t;
+
+		uint64_t index = 0;
+		for (int b = bits - 1; b >= 0; b--)
+		{
+			for (int i = 0; i < 3; i++)
+				index = (index << 1) | ((X[i] >> b) & 1);
+		}
+
+		return index;
+	}
+
+	// Biased randomized insertion order.
+	// Points are shuffled, split into rounds doubling in size, and each round is sorted along the Hilbert curve.
+	// Consecutive points are close to each other, so the walk of the point location stays short.
+	std::vector<int> SortBRIO(const std::vector<Vector3>& points, const Vector3& minBB, const Vector3& maxBB)
+	{
+		constexpr int bits = 10;
+		constexpr int roundMinSize = 64;
+
+		std::vector<int> order(points.size());
+		std::iota(order.begin(), order.end(), 0);
+
+		// Fixed seed, the triangulation should not change between runs.
+		std::mt19937 gen(5489u);
+		std::shuffle(order.begin(), order.end(), gen);
+
+		const Vector3 extent = maxBB - minBB;
+		const float scale = (float)((1u << bits) - 1) / std::max(std::max(std::max(extent.x, extent.y), extent.z), FLT_MIN);
+
+		std::vector<uint64_t> keyVec(points.size());
+		for (int i = 0; i < points.size(); i++)
+		{
+			const Vector3 q = (points[i] - minBB) * scale;
+			keyVec[i] = HilbertIndex((uint32_t)q.x, (uint32_t)q.y, (uint32_t)q.z, bits);
+		}
+
+		// Last round is the larger half of the points, the one before it the half of the rest, and so on.
+		size_t end = order.size();
+		while (end > 0)
+		{
+			const size_t begin = end > roundMinSize ? end / 2 : 0;
+			std::sort(order.begin() + begin, order.begin() + end, [&](const int a, const int b) { return keyVec[a] < keyVec[b]; });
+			end = begin;
+		}
+
+		return order;
+	}
+
+#ifdef _MSC_VER
+	// Error free transformations need every operation rounded as written, the project builds with /fp:fast.
+#pragma float_control(precise, on, push)
+#endif
+
+	// Exact sign of the predicates. (Shewchuk, Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates, 1997)
+	// Floating point result is returned if it is out of the error bound, the sign is computed with expansions otherwise.
+	// Expansion is an exact sum of nonoverlapping doubles in increasing magnitude, without zeros.
+	typedef std::vector<double> Expansion;
+
+	void TwoSum(const double a, const double b, double& x, double& y)
+	{
+		x = a + b;
+		const double bv = x - a;
+		const double av = x - bv;
+		y = (a - av) + (b - bv);
+	}
+
+	void TwoProduct(const double a, const double b, double& x, double& y)
+	{
+		x = a * b;
+		y = std::fma(a, b, -x);
+	}
+
+	Expansion GrowExpansion(const Expansion& e, double b)
+	{
+		Expansion h;
+		h.reserve(e.size() + 1);
+
+		for (const double component : e)
+		{
+			double err;
+			TwoSum(b, component, b, err);
+			if (err != 0)
+				h.push_back(err);
+		}
+
+		if (b != 0)
+			h.push_back(b);
+
+		return h;
+	}
+
+	Expansion SumExpansion(Expansion e, const Expansion& f)
+	{
+		for (const double component : f)
+			e = GrowExpansion(e, component);
+
+		return e;
+	}
+
+	Expansion MulExpansion(const Expansion& e, const Expansion& f)
+	{
+		Expansion h;
+		for (const double a : e)
+		{
+			for (const double b : f)
+			{
+				double product, err;
+				TwoProduct(a, b, product, err);
+				h = GrowExpansion(GrowExpansion(h, err), product);
+			}
+		}
+
+		return h;
+	}
+
+	Expansion DiffExpansion(const double a, const double b)
+	{
+		double diff, err;
+		TwoSum(a, -b, diff, err);
+
+		return GrowExpansion(err != 0 ? Expansion{ err } : Expansion(), diff);
+	}
+
+	Expansion NegateExpansion(Expansion e)
+	{
+		for (double& component : e)
+			component = -component;
+
+		return e;
+	}
+
+	// Largest component decides the sign.
+	double ExpansionSign(const Expansion& e)
+	{
+		return e.empty() ? 0 : (e.back() > 0 ? 1 : -1);
+	}
+
+	// Positive if a, b, c, d is positively oriented, (b - a) . ((c - a) x (d - a)) > 0.
+	// Only the sign is exact.
+	double Orient3D(const double a[3], const double b[3], const double c[3], const double d[3])
+	{
+		constexpr double eps = DBL_EPSILON * 0.5;
+		constexpr double errBound = (7 + 56 * eps) * eps;
+
+		const double bax = b[0] - a[0], bay = b[1] - a[1], baz = b[2] - a[2];
+		const double cax = c[0] - a[0], cay = c[1] - a[1], caz = c[2] - a[2];
+		const double dax = d[0] - a[0], day = d[1] - a[1], daz = d[2] - a[2];
+
+		const double det = bax * (cay * daz - caz * day) + bay * (caz * dax - cax * daz) + baz * (cax * day - cay * dax);
+		const double permanent = std::abs(bax) * (std::abs(cay * daz) + std::abs(caz * day)) +
+								 std::abs(bay) * (std::abs(caz * dax) + std::abs(cax * daz)) +
+								 std::abs(baz) * (std::abs(cax * day) + std::abs(cay * dax));
+
+		if (std::abs(det) > errBound * permanent)
+			return det;
+
+		const Expansion ex[3] = { DiffExpansion(b[0], a[0]), DiffExpansion(b[1], a[1]), DiffExpansion(b[2], a[2]) };
+		const Expansion ey[3] = { DiffExpansion(c[0], a[0]), DiffExpansion(c[1], a[1]), DiffExpansion(c[2], a[2]) };
+		const Expansion ez[3] = { DiffExpansion(d[0], a[0]), DiffExpansion(d[1], a[1]), DiffExpansion(d[2], a[2]) };
+
+		Expansion exact;
+		for (int i = 0; i < 3; i++)
+		{
+			const int j = (i + 1) % 3, k = (i + 2) % 3;
+			const Expansion cross = SumExpansion(MulExpansion(ey[j], ez[k]), NegateExpansion(MulExpansion(ey[k], ez[j])));
+			exact = SumExpansion(exact, MulExpansion(ex[i], cross));
+		}
+
+		return ExpansionSign(exact);
+	}
+
+	// Positive if e is strictly inside the circumsphere of the positively oriented a, b, c, d.
+	// Only the sign is exact.
+	double InSphere(const double a[3], const double b[3], const double c[3], const double d[3], const double e[3])
+	{
+		constexpr double eps = DBL_EPSILON * 0.5;
+		constexpr double errBound = (16 + 224 * eps) * eps;
+
+		// Rows relative to e, lifted onto the paraboloid. Negated determinant, so inside is positive.
+		// det = alift |b c d| - blift |a c d| + clift |a b d| - dlift |a b c|
+		const double* const row[4] = { a, b, c, d };
+		constexpr double rowSign[4] = { 1, -1, 1, -1 };
+
+		double rel[4][3];
+		for (int r = 0; r < 4; r++)
+			for (int i = 0; i < 3; i++)
+				rel[r][i] = row[r][i] - e[i];
+
+		// Minor of row r is the determinant of the other rows, in order.
+		double det = 0, permanent = 0;
+		for (int r = 0; r < 4; r++)
+		{
+			const double* p = rel[r == 0 ? 1 : 0];
+			const double* q = rel[r <= 1 ? 2 : 1];
+			const double* s = rel[r <= 2 ? 3 : 2];
+
+			const double lift = rel[r][0] * rel[r][0] + rel[r][1] * rel[r][1] + rel[r][2] * rel[r][2];
+			const double minor = p[0] * (q[1] * s[2] - q[2] * s[1]) + p[1] * (q[2] * s[0] - q[0] * s[2]) + p[2] * (q[0] * s[1] - q[1] * s[0]);
+			const double minorPermanent = std::abs(p[0]) * (std::abs(q[1] * s[2]) + std::abs(q[2] * s[1])) +
+										  std::abs(p[1]) * (std::abs(q[2] * s[0]) + std::abs(q[0] * s[2])) +
+										  std::abs(p[2]) * (std::abs(q[0] * s[1]) + std::abs(q[1] * s[0]));
+
+			det += rowSign[r] * lift * minor;
+			permanent += lift * minorPermanent;
+		}
+
+		if (std::abs(det) > errBound * permanent)
+			return det;
+
+		Expansion relExp[4][3];
+		for (int r = 0; r < 4; r++)
+			for (int i = 0; i < 3; i++)
+				relExp[r][i] = DiffExpansion(row[r][i], e[i]);
+
+		Expansion exact;
+		for (int r = 0; r < 4; r++)
+		{
+			const Expansion* p = relExp[r == 0 ? 1 : 0];
+			const Expansion* q = relExp[r <= 1 ? 2 : 1];
+			const Expansion* s = relExp[r <= 2 ? 3 : 2];
+
+			Expansion lift;
+			for (int i = 0; i < 3; i++)
+				lift = SumExpansion(lift, MulExpansion(relExp[r][i], relExp[r][i]));
+
+			Expansion minor;
+			for (int i = 0; i < 3; i++)
+			{
+				const int j = (i + 1) % 3, k = (i + 2) % 3;
+				const Expansion cross = SumExpansion(MulExpansion(q[j], s[k]), NegateExpansion(MulExpansion(q[k], s[j])));
+				minor = SumExpansion(minor, MulExpansion(p[i], cross));
+			}
+
+			const Expansion term = MulExpansion(lift, minor);
+			exact = SumExpansion(exact, rowSign[r] > 0 ? term : NegateExpansion(term));
+		}
+
+		return ExpansionSign(exact);
+	}
+
+#ifdef _MSC_VER
+#pragma float_control(pop)
+#endif
+
+	bool InCircumsphere(const TetCell& tet, const std::vector<std::array<double, 3>>& posVec, const double p[3])
+	{
+		return InSphere(posVec[tet.VertexID[0]].data(), posVec[tet.VertexID[1]].data(), posVec[tet.VertexID[2]].data(), posVec[tet.VertexID[3]].data(), p) > 0;
+	}
+
+	// Visibility walk from the start tetrahedron, crossing any face the point is behind.
+	// The first face tested rotates each step, so the walk does not cycle.
+	// Returns -1 if the point is out of the mesh or the walk does not end within maxStep.
+	int LocateTet(const std::vector<TetCell>& tetVec, const std::vector<std::array<double, 3>>& posVec, const double p[3], int tet, const int maxStep)
+	{
+		for (int step = 0; step < maxStep; step++)
+		{
+			const TetCell& cell = tetVec[tet];
+
+			int next = -2;
+			for (int k = 0; k < 4; k++)
+			{
+				const int i = (k + step) & 3;
+
+				const double* v[4] = { posVec[cell.VertexID[0]].data(), posVec[cell.VertexID[1]].data(),
+									   posVec[cell.VertexID[2]].data(), posVec[cell.VertexID[3]].data() };
+				v[i] = p;
+
+				if (Orient3D(v[0], v[1], v[2], v[3]) < 0)
+				{
+					next = cell.AdjTet[i];
+					break;
+				}
+			}
+
+			if (next == -2)
+				return tet;
+
+			if (next == -1)
+				return -1;
+
+			tet = next;
+		}
+
+		return -1;
+	}
+
+	// Bowyer-Watson on an indexed mesh with neighbor links.
+	// 1. Points are inserted in BRIO order.
+	// 2. Point location walks from the last created tetrahedron.
+	// 3. Cavity is collected by BFS over the neighbors whose circumsphere strictly contains the point.
+	//    Predicates are exact, so cospherical points do not leave flat or inverted tetrahedra.
+	// 4. Cavity boundary faces are connected to the point, new tetrahedra are linked through a hash of their shared edges.
 	Delaunay Triangulate(const std::vector<Vector3>& points)
 	{
 		if (points.size() < 3)
@@ -193,67 +541,190 @@ namespace DT3D
 		const auto p2 = Vector3{ midx + 20 * dmax,  midy - dmax,		midz - dmax };
 		const auto p3 = Vector3{ midx,				midy + 20 * dmax,	midz };
 
-		dt.TetVec.emplace_back(p0, p1, p2, p3);
+		// Input points, then the super tetrahedron.
+		const int pointCnt = points.size();
 
-		for (int i = 0; i < points.size(); i++)
+		std::vector<std::array<double, 3>> posVec(pointCnt + 4);
+		for (int i = 0; i < pointCnt; i++)
+			posVec[i] = { points[i].x, points[i].y, points[i].z };
+
+		posVec[pointCnt + 0] = { p0.x, p0.y, p0.z };
+		posVec[pointCnt + 1] = { p1.x, p1.y, p1.z };
+		posVec[pointCnt + 2] = { p2.x, p2.y, p2.z };
+		posVec[pointCnt + 3] = { p3.x, p3.y, p3.z };
+
+		std::vector<TetCell> tetVec;
+		std::vector<int> freeTetVec;
+		std::vector<int> visitVec;
+
+		const auto createTet = [&](const int (&vertexID)[4]) -> int
+		{
+			int id;
+			if (freeTetVec.empty())
+			{
+				id = tetVec.size();
+				tetVec.emplace_back();
+				visitVec.push_back(-1);
+			}
+			else
+			{
+				id = freeTetVec.back();
+				freeTetVec.pop_back();
+			}
+
+			TetCell& tet = tetVec[id];
+			std::copy(vertexID, vertexID + 4, tet.VertexID);
+			std::fill(tet.AdjTet, tet.AdjTet + 4, -1);
+			tet.Dead = false;
+
+			return id;
+		};
+
+		{
+			int superID[4] = { pointCnt + 0, pointCnt + 1, pointCnt + 2, pointCnt + 3 };
+			if (Orient3D(posVec[superID[0]].data(), posVec[superID[1]].data(), posVec[superID[2]].data(), posVec[superID[3]].data()) < 0)
+				std::swap(superID[0], superID[1]);
+
+			createTet(superID);
+		}
+
+		std::vector<int> cavityVec;
+		std::vector<int> newTetVec;
+		std::unordered_map<uint64_t, std::pair<int, int>> openFaceMap;
+
+		int lastTet = 0;
+		const std::vector<int> order = SortBRIO(points, Vector3(xmin, ymin, zmin), Vector3(xmax, ymax, zmax));
+		for (int iter = 0; iter < order.size(); iter++)
 		{
-			const auto pt = points[i];
+			const int pointID = order[iter];
+			const double* pt = posVec[pointID].data();
+
+			// 1. Locate the point, and skip it if it is duplicated.
+			// Fall back to a scan if the walk fails on a degenerate mesh.
+			int startTet = LocateTet(tetVec, posVec, pt, lastTet, tetVec.size());
+			if (startTet != -1)
+			{
+				const int* vertexID = tetVec[startTet].VertexID;
+				if (std::any_of(vertexID, vertexID + 4, [&](const int v) { return posVec[v] == posVec[pointID]; }))
+					continue;
+			}
 
-			std::vector<Triangle> faces;
-			std::vector<Tetrahedron> tmps;
-			for (auto const& tet : dt.TetVec)
+			if (startTet == -1 || FALSE == InCircumsphere(tetVec[startTet], posVec, pt))
 			{
-				// #CORRECTION
-				// Check if the point is inside the tetrahedron circumsphere.
-				const auto dist = Vector3::Distance(tet.sphere.center, pt);
-				if ((dist - tet.sphere.radius) <= EPSILON)
+				startTet = -1;
+				for (int t = 0; t < tetVec.size(); t++)
 				{
-					faces.push_back(tet.t0);
-					faces.push_back(tet.t1);
-					faces.push_back(tet.t2);
-					faces.push_back(tet.t3);
+					if (FALSE == tetVec[t].Dead && TRUE == InCircumsphere(tetVec[t], posVec, pt))
+					{
+						startTet = t;
+						break;
+					}
 				}
-				else
+			}
+
+			if (startTet == -1)
+				continue;
+
+			// 2. Cavity.
+			cavityVec.clear();
+			cavityVec.push_back(startTet);
+			tetVec[startTet].Dead = true;
+			visitVec[startTet] = iter;
+
+			for (int c = 0; c < cavityVec.size(); c++)
+			{
+				for (const int adj : tetVec[cavityVec[c]].AdjTet)
 				{
-					tmps.push_back(tet);
+					if (adj == -1 || visitVec[adj] == iter)
+						continue;
+
+					visitVec[adj] = iter;
+					if (TRUE == InCircumsphere(tetVec[adj], posVec, pt))
+					{
+						tetVec[adj].Dead = true;
+						cavityVec.push_back(adj);
+					}
 				}
 			}
 
-			// Delete duplicate faces.
-			std::vector<bool> remove(faces.size(), false);
-			for (auto it1 = faces.begin(); it1 != faces.end(); ++it1)
+			// 3. Connect the boundary faces to the point.
+			// Replacing the vertex opposite to a boundary face keeps the orientation, the point is on the same side.
+			newTetVec.clear();
+			openFaceMap.clear();
+
+			for (const int cavityTet : cavityVec)
 			{
-				for (auto it2 = faces.begin(); it2 != faces.end(); ++it2)
+				for (int i = 0; i < 4; i++)
 				{
-					if (it1 == it2)
+					const int outside = tetVec[cavityTet].AdjTet[i];
+					if (outside != -1 && TRUE == tetVec[outside].Dead)
 						continue;
 
-					if (*it1 == *it2)
+					int vertexID[4];
+					std::copy(tetVec[cavityTet].VertexID, tetVec[cavityTet].VertexID + 4, vertexID);
+					vertexID[i] = pointID;
+
+					const int newTet = createTet(vertexID);
+					newTetVec.push_back(newTet);
+
+					tetVec[newTet].AdjTet[i] = outside;
+					if (outside != -1)
+					{
+						int* adjTet = tetVec[outside].AdjTet;
+						*std::find(adjTet, adjTet + 4, cavityTet) = newTet;
+					}
+
+					// Other faces contain the point and are shared with another new tetrahedron.
+					// They are keyed by the edge opposite to the point.
+					for (int j = 0; j < 4; j++)
 					{
-						remove[std::distance(faces.begin(), it1)] = true;
-						remove[std::distance(faces.begin(), it2)] = true;
+						if (j == i)
+							continue;
+
+						int a = -1, b = -1;
+						for (int k = 0; k < 4; k++)
+						{
+							if (k == i || k == j)
+								continue;
+
+							(a == -1 ? a : b) = vertexID[k];
+						}
+
+						const uint64_t key = ((uint64_t)std::min(a, b) << 32) | (uint32_t)std::max(a, b);
+						const auto res = openFaceMap.insert({ key, { newTet, j } });
+						if (FALSE == res.second)
+						{
+							tetVec[newTet].AdjTet[j] = res.first->second.first;
+							tetVec[res.first->second.first].AdjTet[res.first->second.second] = newTet;
+							openFaceMap.erase(res.first);
+						}
 					}
 				}
 			}
 
-			faces.erase(std::remove_if(faces.begin(), faces.end(), [&](auto const& f) { return remove[&f - &faces[0]]; }), faces.end());
+			freeTetVec.insert(freeTetVec.end(), cavityVec.begin(), cavityVec.end());
+			lastTet = newTetVec.back();
+		}
 
-			// Update triangulation.
-			for (auto const& f : faces)
-				tmps.emplace_back(f.p0, f.p1, f.p2, pt);
+		// Remove original super triangle.
+		std::vector<int> remap(tetVec.size(), -1);
+		for (int t = 0; t < tetVec.size(); t++)
+		{
+			const TetCell& tet = tetVec[t];
+			if (TRUE == tet.Dead || std::any_of(tet.VertexID, tet.VertexID + 4, [&](const int v) { return v >= pointCnt; }))
+				continue;
 
-			dt.TetVec = tmps;
+			remap[t] = dt.IndexedTetVec.size();
+			dt.IndexedTetVec.push_back(tet);
 		}
 
-		// Remove original super triangle.
-		dt.TetVec.erase(std::remove_if(dt.TetVec.begin(), dt.TetVec.end(),
-			[&](auto const& tet)
-			{
-				return ((tet.p0 == p0 || tet.p1 == p0 || tet.p2 == p0 || tet.p3 == p0) ||
-						(tet.p0 == p1 || tet.p1 == p1 || tet.p2 == p1 || tet.p3 == p1) ||
-						(tet.p0 == p2 || tet.p1 == p2 || tet.p2 == p2 || tet.p3 == p2) ||
-						(tet.p0 == p3 || tet.p1 == p3 || tet.p2 == p3 || tet.p3 == p3));
-			}), dt.TetVec.end());
+		for (IndexedTetrahedron& tet : dt.IndexedTetVec)
+		{
+			for (int& adj : tet.AdjTet)
+				adj = adj == -1 ? -1 : remap[adj];
+
+			dt.TetVec.emplace_back(points[tet.VertexID[0]], points[tet.VertexID[1]], points[tet.VertexID[2]], points[tet.VertexID[3]]);
+		}
 
 		// Add faces.
 		for (auto const& tet : dt.TetVec)
@@ -266,51 +737,246 @@ namespace DT3D
 		return dt;
 	}
 
+	// Dual of the Delaunay tetrahedralization.
+	// Vertex i is the circumcenter of dt.IndexedTetVec[i], edges link the circumcenters of adjacent tetrahedra.
+	struct VoronoiGraph
+	{
+		std::vector<Vector3> VertexVec;
+		std::vector<std::pair<int, int>> EdgeVec;
+	};
+
+	VoronoiGraph VoronoiDual(const Delaunay& dt)
+	{
+		VoronoiGraph graph;
+
+		graph.VertexVec.reserve(dt.TetVec.size());
+		for (const Tetrahedron& tet : dt.TetVec)
+			graph.VertexVec.push_back(tet.sphere.center);
+
+		// Each face is shared by two tetrahedra, take it from the lower index.
+		graph.EdgeVec.reserve(dt.IndexedTetVec.size() * 2);
+		for (int i = 0; i < dt.IndexedTetVec.size(); i++)
+		{
+			for (const int adj : dt.IndexedTetVec[i].AdjTet)
+			{
+				if (adj > i)
+					graph.EdgeVec.emplace_back(i, adj);
+			}
+		}
+
+		return graph;
+	}
+
 	std::vector<Edge> Voronoi(const Delaunay& dt)
 	{
+		const VoronoiGraph graph = VoronoiDual(dt);
+
 		std::vector<Edge> edgeVec;
+		edgeVec.reserve(graph.EdgeVec.size());
+		for (const auto& [v0, v1] : graph.EdgeVec)
+			edgeVec.emplace_back(graph.VertexVec[v0], graph.VertexVec[v1]);
 
-		for (int i = 0; i < dt.TetVec.size(); i++)
+		return edgeVec;
+	}
+
+	// Voronoi cells of the sites inside the box, clipped by the box, in the order of the sites.
+	// Sites out of the box are ignored, same as voro++ container.
+	// 1. Guard points at 5 times the box corners bound every cell, and keep the super tetrahedron far away.
+	// 2. Each Delaunay edge of a site is a cell face, the ring of circumcenters of the tetrahedra around it.
+	//    Predicates of the triangulation are exact, so cospherical sites such as a lattice give closed rings.
+	// 3. Cells reaching out of the box are clipped by its planes.
+	std::vector<VMACH::Polygon3D> VoronoiCells(const std::vector<Vector3>& sites, const Vector3& minBB, const Vector3& maxBB)
+	{
+		std::vector<Vector3> points;
+		for (const Vector3& site : sites)
 		{
-			int adjFaceCnt = 0;
-			for (int j = 0; j < dt.TetVec.size(); j++)
-			{
-				if (i == j)
-					continue;
+			if (site.x >= minBB.x && site.x <= maxBB.x && site.y >= minBB.y && site.y <= maxBB.y && site.z >= minBB.z && site.z <= maxBB.z)
+				points.push_back(site);
+		}
+
+		const int siteCnt = points.size();
+		if (siteCnt == 0)
+			return {};
+
+		const Vector3 center = (minBB + maxBB) * 0.5f;
+		const Vector3 halfExtent = (maxBB - minBB) * 2.5f;
+		for (int c = 0; c < 8; c++)
+			points.push_back(center + Vector3(c & 1 ? halfExtent.x : -halfExtent.x, c & 2 ? halfExtent.y : -halfExtent.y, c & 4 ? halfExtent.z : -halfExtent.z));
 
-				if (
-					(dt.TetVec[i].t0 == dt.TetVec[j].t0) ||
-					(dt.TetVec[i].t0 == dt.TetVec[j].t1) ||
-					(dt.TetVec[i].t0 == dt.TetVec[j].t2) ||
-					(dt.TetVec[i].t0 == dt.TetVec[j].t3) ||
-					(dt.TetVec[i].t1 == dt.TetVec[j].t0) ||
-					(dt.TetVec[i].t1 == dt.TetVec[j].t1) ||
-					(dt.TetVec[i].t1 == dt.TetVec[j].t2) ||
-					(dt.TetVec[i].t1 == dt.TetVec[j].t3) ||
-					(dt.TetVec[i].t2 == dt.TetVec[j].t0) ||
-					(dt.TetVec[i].t2 == dt.TetVec[j].t1) ||
-					(dt.TetVec[i].t2 == dt.TetVec[j].t2) ||
-					(dt.TetVec[i].t2 == dt.TetVec[j].t3) ||
-					(dt.TetVec[i].t3 == dt.TetVec[j].t0) ||
-					(dt.TetVec[i].t3 == dt.TetVec[j].t1) ||
-					(dt.TetVec[i].t3 == dt.TetVec[j].t2) ||
-					(dt.TetVec[i].t3 == dt.TetVec[j].t3))
+		const Delaunay dt = Triangulate(points);
+
+		// 1. One tetrahedron of each Delaunay edge with a site.
+		std::unordered_map<uint64_t, int> edgeTetMap;
+		edgeTetMap.reserve(dt.IndexedTetVec.size() * 2);
+		for (int t = 0; t < dt.IndexedTetVec.size(); t++)
+		{
+			const int* vertexID = dt.IndexedTetVec[t].VertexID;
+			for (int i = 0; i < 4; i++)
+			{
+				for (int j = i + 1; j < 4; j++)
 				{
-					edgeVec.emplace_back(
-						dt.TetVec[i].sphere.center,
-						dt.TetVec[j].sphere.center);
-					
-					adjFaceCnt++;
+					const int a = std::min(vertexID[i], vertexID[j]);
+					const int b = std::max(vertexID[i], vertexID[j]);
+					if (a < siteCnt)
+						edgeTetMap.insert({ ((uint64_t)a << 32) | (uint32_t)b, t });
 				}
+			}
+		}
 
-				if (adjFaceCnt >= 4)
-					break;
+		// 2. Faces. Sorted by edge, the cells do not depend on the hash order.
+		std::vector<std::pair<uint64_t, int>> edgeTetVec(edgeTetMap.begin(), edgeTetMap.end());
+		std::sort(edgeTetVec.begin(), edgeTetVec.end());
+
+		// Tetrahedra sharing a circumsphere are one Voronoi vertex, but their circumcenters are rounded apart.
+		// Adjacent ones are grouped by the exact predicate, and the group takes the circumcenter of its lowest tetrahedron.
+		std::vector<std::array<double, 3>> posVec(points.size());
+		for (int i = 0; i < points.size(); i++)
+			posVec[i] = { points[i].x, points[i].y, points[i].z };
+
+		std::vector<int> vertexTetVec(dt.IndexedTetVec.size());
+		std::iota(vertexTetVec.begin(), vertexTetVec.end(), 0);
+
+		const auto findVertexTet = [&vertexTetVec](int tet)
+		{
+			while (vertexTetVec[tet] != tet)
+			{
+				vertexTetVec[tet] = vertexTetVec[vertexTetVec[tet]];
+				tet = vertexTetVec[tet];
+			}
+
+			return tet;
+		};
+
+		for (int t = 0; t < dt.IndexedTetVec.size(); t++)
+		{
+			const IndexedTetrahedron& tet = dt.IndexedTetVec[t];
+			for (const int adj : tet.AdjTet)
+			{
+				if (adj < t)
+					continue;
+
+				const IndexedTetrahedron& adjTet = dt.IndexedTetVec[adj];
+				const int opposite = adjTet.VertexID[std::find(adjTet.AdjTet, adjTet.AdjTet + 4, t) - adjTet.AdjTet];
+				if (InSphere(posVec[tet.VertexID[0]].data(), posVec[tet.VertexID[1]].data(), posVec[tet.VertexID[2]].data(),
+							 posVec[tet.VertexID[3]].data(), posVec[opposite].data()) != 0)
+					continue;
+
+				const int a = findVertexTet(t);
+				const int b = findVertexTet(adj);
+				vertexTetVec[std::max(a, b)] = std::min(a, b);
 			}
 		}
 
-		std::vector<DT3D::Edge> uniqueEdgeVec;
-		UniqueVector<DT3D::Edge>(edgeVec, uniqueEdgeVec);
+		std::vector<VMACH::Polygon3D> cellVec(siteCnt, VMACH::Polygon3D(true));
+		std::vector<bool> failedVec(siteCnt, false);
+		std::vector<int> ringVec;
+		for (const auto& [key, startTet] : edgeTetVec)
+		{
+			const int s = key >> 32;
+			const int t = key & 0xffffffff;
+
+			// Walk around the edge. Crossing the face opposite to 'skip', the remaining vertex is skipped next.
+			const int* startID = dt.IndexedTetVec[startTet].VertexID;
+			int skip = *std::find_if(startID, startID + 4, [&](const int v) { return v != s && v != t; });
+
+			ringVec.clear();
+
+			int tet = startTet;
+			do
+			{
+				const int vertexTet = findVertexTet(tet);
+				if (TRUE == ringVec.empty() || ringVec.back() != vertexTet)
+					ringVec.push_back(vertexTet);
+
+				const IndexedTetrahedron& cell = dt.IndexedTetVec[tet];
+				const int skipIndex = std::find(cell.VertexID, cell.VertexID + 4, skip) - cell.VertexID;
+				const int remain = *std::find_if(cell.VertexID, cell.VertexID + 4, [&](const int v) { return v != s && v != t && v != skip; });
+
+				tet = cell.AdjTet[skipIndex];
+				skip = remain;
+			} while (tet != startTet && tet != -1);
+
+			while (ringVec.size() > 1 && ringVec.back() == ringVec.front())
+				ringVec.pop_back();
+
+			VMACH::PolygonFace face = { true };
+			for (const int vertexTet : ringVec)
+				face.VertexVec.push_back(dt.TetVec[vertexTet].sphere.center);
+
+			const bool finite = std::all_of(face.VertexVec.begin(), face.VertexVec.end(), [](const Vector3& v)
+											{
+												return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+											});
+
+			// Guard points are the hull, so the ring around a site edge is always closed.
+			// Open ring or a degenerate tetrahedron means the triangulation is broken there, both cells are rejected.
+			if (tet == -1 || FALSE == finite)
+			{
+				failedVec[s] = true;
+				if (t < siteCnt)
+					failedVec[t] = true;
+
+				continue;
+			}
+
+			// Zero area face of cospherical points, the cells only touch at an edge or a vertex.
+			if (face.VertexVec.size() < 3)
+				continue;
+
+			// Newell normal.
+			Vector3 normal = Vector3::Zero;
+			for (int i = 1; i + 1 < face.VertexVec.size(); i++)
+				normal += (face.VertexVec[i] - face.VertexVec[0]).Cross(face.VertexVec[i + 1] - face.VertexVec[0]);
+
+			// Outward from s. Face plane is the bisector of s and t, not the plane of three rounded circumcenters.
+			const Vector3 mid = (points[s] + points[t]) * 0.5f;
+			Vector3 dir = points[t] - points[s];
+			dir.Normalize();
+
+			if (normal.Dot(dir) < 0)
+				std::reverse(face.VertexVec.begin(), face.VertexVec.end());
+
+			face.ManuallySetFacePlane(Plane(mid, dir));
+			cellVec[s].AddFace(face);
+
+			if (t < siteCnt)
+			{
+				std::reverse(face.VertexVec.begin(), face.VertexVec.end());
+				face.ManuallySetFacePlane(Plane(mid, -dir));
+				cellVec[t].AddFace(face);
+			}
+		}
+
+		// Cell which failed to compute is left empty, same as voro++.
+		for (int i = 0; i < siteCnt; i++)
+		{
+			if (TRUE == failedVec[i])
+				cellVec[i] = VMACH::Polygon3D(true);
+		}
+
+		// 3. Clip by the box.
+		const Plane boxPlanes[6] =
+		{
+			Plane(Vector3(-1, 0, 0), minBB.x), Plane(Vector3(1, 0, 0), -maxBB.x),
+			Plane(Vector3(0, -1, 0), minBB.y), Plane(Vector3(0, 1, 0), -maxBB.y),
+			Plane(Vector3(0, 0, -1), minBB.z), Plane(Vector3(0, 0, 1), -maxBB.z),
+		};
+
+		VMACH::ClipContext context;
+		for (VMACH::Polygon3D& cell : cellVec)
+		{
+			for (const Plane& plane : boxPlanes)
+			{
+				const bool out = std::any_of(cell.FaceVec.begin(), cell.FaceVec.end(), [&](const VMACH::PolygonFace& f)
+											 {
+												 return std::any_of(f.VertexVec.begin(), f.VertexVec.end(), [&](const Vector3& v) { return plane.DotCoordinate(v) > 0; });
+											 });
+
+				if (TRUE == out)
+					cell = VMACH::Polygon3D::ClipWithPlane(cell, plane, context);
+			}
+		}
 
-		return uniqueEdgeVec;
+		return cellVec;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,295 @@
+#ifndef FRACTURE_H
+#define FRACTURE_H
+
+#include "VMACH.h"
+#include "Poly.h"
+#include "Kdop.h"
+#include "PieceStore.h"
+#include "thread_pool.h"
+
+// Shared by the fracture engine and the application.
+// One worker per hardware thread, reset it while idle to change the worker count or pinning.
+extern dp::thread_pool<> g_threadPool;
+
+namespace Fracture
+{
+
+using DirectX::SimpleMath::Vector3;
+using DirectX::SimpleMath::Plane;
+
+// Normal set of the k-DOP fitted to each piece by Refitting.
+enum class RefittingMode
+{
+	ICH,		// Normals of the ICH of each piece, up to RefittingPointLimit points.
+	Kdop6,		// Kdop::FixedKdop, no convex hull is built. More directions fit tighter but cost more to clip.
+	Kdop14,
+	Kdop18,
+	Kdop26,
+};
+
+// Generator of the Voronoi cells of the initial decomposition and the fracture patterns.
+enum class VoronoiMode
+{
+	VoroPlusPlus,	// voro++ container.
+	DelaunayDual,	// DT3D::VoronoiCells, dual of the Delaunay tetrahedralization.
+};
+
+// How the convex of a piece is cut by the Voronoi cells. The mesh is always clipped or split by the cell planes.
+enum class ConvexFractureMode
+{
+	Clip,			// Poly::ClipPolyhedron with the planes of every overlapping cell, or PartitionPolyhedron with RecursiveSplit.
+	VoroWall,		// One voro++ container per piece, bounded by its convex planes as walls.
+};
+
+struct FractureArgs
+{
+	int					ICHIncludePointLimit = 20;
+	float				ACHPlaneGapInverse = 2000.0f;
+	int					RefittingPointLimit = 4;
+	RefittingMode		Refitting = RefittingMode::ICH;
+
+	// Radian. ICH normals this close to each other, or to the opposite, share one k-DOP slab.
+	float				KdopNormalTolerance = 0.0f;
+
+	VoronoiMode			Voronoi = VoronoiMode::VoroPlusPlus;
+	ConvexFractureMode	ConvexFracture = ConvexFractureMode::Clip;
+
+	// Split each piece by all of its cells at once with Poly::PartitionPolyhedron, instead of clipping it per cell.
+	bool				RecursiveSplit = false;
+
+	int					Seed = 46354;
+
+	DirectX::XMFLOAT3	ImpactPosition = DirectX::XMFLOAT3(0, 0, 0);
+	float				ImpactRadius = 1.0f;
+
+	bool				RadialMode = true;
+	bool				PartialFracture = true;
+	float				PartialFracturePatternDist = 0.01f;
+	float				GeneralFracturePatternDist = 1.0f;
+
+	int					InitialDecomposeCellCnt = 64;
+	int					PartialFracturePatternCellCnt = 128;
+	int					GeneralFracturePatternCellCnt = 1024;
+
+	float				TargetAdder = 0.01f;
+};
+
+typedef Poly::Extract Extract;
+
+// Derived data of a polyhedron, computed once on first use.
+struct PolyhedronCache
+{
+	Extract										Faces;
+	std::vector<Plane>							FacePlanes;		// Outward, from the first three vertices of each face.
+
+	Vector3										MinBB;
+	Vector3										MaxBB;
+	Vector3										SphereCenter;
+	float										SphereRadius = 0.0f;
+
+	double										Volume = 0.0;
+	Vector3										Centroid;
+};
+
+// Always allocated by a PieceStore, and referred to by its PieceHandle.
+// Convex and mesh are only changed through SetConvex / Transform, which drop the cached data.
+class Piece
+{
+public:
+
+	Piece(const Poly::Polyhedron& convex, const Poly::Polyhedron& mesh);
+	Piece(Poly::Polyhedron&& convex, Poly::Polyhedron&& mesh);
+
+	Piece(Piece const&) = delete;
+	Piece& operator= (Piece const&) = delete;
+
+	const Poly::Polyhedron&						GetConvex() const { return m_convex; }
+	const Poly::Polyhedron&						GetMesh() const { return m_mesh; }
+
+	// Thread safe, as long as the piece is not changed at the same time.
+	const PolyhedronCache&						GetConvexCache() const;
+	const PolyhedronCache&						GetMeshCache() const;
+
+	void										SetConvex(Poly::Polyhedron&& convex);
+	void										Transform(const DirectX::XMMATRIX& matrix);
+
+	// Bytes of the polyhedra and the cached data, the piece itself is not counted.
+	size_t										GetHeapSize() const;
+
+private:
+
+	struct LazyCache
+	{
+		std::once_flag							Flag;
+		PolyhedronCache							Data;
+	};
+
+	static const PolyhedronCache&				Resolve(LazyCache& cache, const Poly::Polyhedron& polyhedron);
+
+	Poly::Polyhedron							m_convex;
+	Poly::Polyhedron							m_mesh;
+
+	mutable std::unique_ptr<LazyCache>			m_convexCache;
+	mutable std::unique_ptr<LazyCache>			m_meshCache;
+};
+
+struct CompoundInfo
+{
+	std::vector<PieceHandle>					PieceVec;
+	std::vector<std::set<int>>					CompoundBind;
+};
+
+struct Compound
+{
+	std::vector<PieceHandle>					PieceVec;
+};
+
+// Wall time of one pipeline stage, filled by PrepareFracture / DoFracture.
+struct FractureStage
+{
+	const char*									Name;
+	double										ElapsedMs;
+};
+
+struct FractureResult
+{
+	uint32_t									ICHFaceCnt = 0;
+	uint32_t									ICHDiscardedPointCnt = 0;
+	uint32_t									ACHEliminatedPlaneCnt = 0;
+	uint32_t									ACHErrorPointCnt = 0;
+	std::vector<FractureStage>					StageVec;
+};
+
+struct FractureStorage
+{
+	std::vector<VMACH::Polygon3D>				PartialFracturePattern;
+	std::vector<VMACH::Polygon3D>				GeneralFracturePattern;
+
+	// Sites of the pattern cells, in the same order.
+	std::vector<Vector3>						PartialFracturePatternSite;
+	std::vector<Vector3>						GeneralFracturePatternSite;
+
+	Vector3										BBCenter;
+	Vector3										MinBB;
+	Vector3										MaxBB;
+	float										MaxAxisScale = 0.0f;
+};
+
+// Fracture pipeline without any rendering or physics dependency.
+// Pieces of the returned compounds live in the piece store of the engine, until the caller releases them.
+class FractureEngine
+{
+public:
+
+	// Runs on the thread pool for each piece of the result, as soon as it is refitted.
+	// Waits on the pool go through parallel_for, parallel_map or wait, which keep the worker busy.
+	typedef std::function<void(const Piece* piece)>										PieceTask;
+
+	FractureEngine();
+	~FractureEngine() = default;
+
+	FractureEngine(FractureEngine const&) = delete;
+	FractureEngine& operator= (FractureEngine const&) = delete;
+
+	// Unit sphere point cloud, scaled by ImpactRadius at fracture time.
+	void							SetSpherePointCloud(_In_ const std::vector<Vector3>& spherePointCloud);
+
+	Compound						PrepareFracture(_In_ const std::vector<Vector3>& vertices, _In_ const std::vector<uint32_t>& indices);
+	// Each cell streams its pieces through the out of impact test, the convex islands and the refitting on its own.
+	// Only the compound of the pieces out of the impact waits for all of the cells.
+	// Pieces of the target out of the impact are kept by the result, release the target with PieceStore::ReleaseReplaced.
+	std::vector<Compound>			DoFracture(_In_ const Compound& targetCompound, _In_opt_ const PieceTask& pieceTask = nullptr);
+
+	FractureArgs&					GetArgs() { return m_fractureArgs; }
+	const FractureArgs&				GetArgs() const { return m_fractureArgs; }
+	const FractureResult&			GetResult() const { return m_fractureResult; }
+	const FractureStorage&			GetStorage() const { return m_fractureStorage; }
+	PieceStore&						GetPieceStore() { return m_pieceStore; }
+
+	// Discarded points are the ones dropped by the exact hull prefilter, 0 if it is skipped.
+	std::vector<Vector3>			GenerateICHNormal(_In_ const std::vector<Vector3>& vertices, _In_ const int ichIncludePointLimit,
+													  _In_opt_ dp::thread_pool<>* threadPool = nullptr, _Out_opt_ uint32_t* discardedPointCnt = nullptr) const;
+	std::vector<Vector3>			GenerateICHNormal(_In_ const Poly::Polyhedron& polyhedron, _In_ const int ichIncludePointLimit) const;
+
+private:
+
+	// Runs on the thread pool with the pieces of a cell, once all of them are cut. Same rule as PieceTask.
+	typedef std::function<void(const int cell, const std::vector<PieceHandle>& cellPieceVec)>	CellTask;
+
+	// Exact hull prefilter runs if the ICH point limit times this ratio exceeds the point count.
+	static constexpr size_t			ICHExactHullRatio = 64;
+
+	// Voronoi cells per thread pool task of GenerateVoronoi and of the VoroWall convex fracture.
+	static constexpr int			VoronoiTaskCellCnt = 64;
+
+	// Cells are in the box [-0.5, 0.5], site of each cell is written to cellSiteVec if given.
+	std::vector<VMACH::Polygon3D>	GenerateVoronoi(_In_ const int cellCount, _In_opt_ dp::thread_pool<>* threadPool = nullptr,
+													_Out_opt_ std::vector<Vector3>* cellSiteVec = nullptr) const;
+	std::vector<VMACH::Polygon3D>	GenerateVoronoi(_In_ const std::vector<Vector3>& cellPointVec, _In_opt_ dp::thread_pool<>* threadPool = nullptr,
+													_Out_opt_ std::vector<Vector3>* cellSiteVec = nullptr) const;
+	std::vector<VMACH::Polygon3D>	GenerateFracturePattern(_In_ const int cellCount, _In_ const double mean, _In_opt_ dp::thread_pool<>* threadPool = nullptr,
+															_Out_opt_ std::vector<Vector3>* cellSiteVec = nullptr) const;
+
+	// Cells are placed at patternScale * (cell in the unit box) + patternCenter.
+	// Sites are in the unit box, only used by ConvexFractureMode::VoroWall.
+	CompoundInfo					ApplyFracture(_In_ const Compound& compound,
+												  _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
+												  _In_ const std::vector<Vector3>& cellSiteVec,
+												  _In_ const Vector3& patternScale,
+												  _In_ const Vector3& patternCenter,
+												  _In_ const std::vector<Vector3>& spherePointCloud,
+												  _In_ bool partial = false,
+												  _In_opt_ const CellTask& cellTask = nullptr) const;
+
+	// Pieces of one piece in the given cells, with ConvexFractureMode::VoroWall or RecursiveSplit.
+	// Returns the cell of each new piece.
+	std::vector<std::pair<int, PieceHandle>>	FracturePiece(_In_ const Piece* piece,
+															  _In_ const std::vector<int>& cellIndexVec,
+															  _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
+															  _In_ const std::vector<Vector3>& cellSiteVec,
+															  _In_ const Vector3& patternScale,
+															  _In_ const Vector3& patternCenter) const;
+
+	// Convex parts of the piece in the given cells, out of one voro++ container walled by its convex planes.
+	std::vector<Poly::Polyhedron>	CutConvexWithVoroWall(_In_ const Piece* piece,
+														  _In_ const std::vector<int>& cellIndexVec,
+														  _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
+														  _In_ const std::vector<Vector3>& cellSiteVec,
+														  _In_ const Vector3& patternScale,
+														  _In_ const Vector3& patternCenter) const;
+
+	// Mesh islands become separate pieces sharing the convex.
+	void							AppendPiece(_In_ Poly::Polyhedron&& convex, _In_ Poly::Polyhedron&& mesh, _Inout_ std::vector<PieceHandle>& pieceVec) const;
+
+	void							_MeshIslandLoop(const int index, const Poly::Polyhedron& mesh, std::set<int>& group) const;
+	std::vector<std::set<int>>		CheckMeshIsland(_In_ const Poly::Polyhedron& polyhedron) const;
+
+	// Bind is left with the first island, the others are returned.
+	std::vector<std::set<int>>		HandleConvexIsland(_In_ const std::vector<PieceHandle>& pieceVec, _Inout_ std::set<int>& localBind) const;
+
+	// Pieces out of the impact are taken out of the bind and returned, to be merged into one compound.
+	std::set<int>					MergeOutOfImpact(_In_ const std::vector<PieceHandle>& pieceVec, _Inout_ std::set<int>& localBind,
+													 _In_ const std::vector<Vector3>& spherePointCloud) const;
+
+	void							Refitting(_In_ const std::vector<PieceHandle>& targetPieceVec, _In_opt_ const PieceTask& pieceTask = nullptr) const;
+
+	bool							ConvexOutOfSphere(_In_ const Piece* piece,
+													  _In_ const std::vector<Vector3>& spherePointCloud,
+													  _In_ const Vector3 origin,
+													  _In_ const float radius) const;
+
+	std::function<void(Piece* piece)>																												m_refittingTask;
+	std::function<std::vector<PieceHandle>(const VMACH::Polygon3D& voroPoly, const std::vector<const Piece*>& targetPieceVec, const std::vector<int>& pieceIndexVec)>	m_fractureTask;
+
+	FractureArgs									m_fractureArgs;
+	FractureResult									m_fractureResult;
+	FractureStorage									m_fractureStorage;
+	std::vector<Vector3>							m_spherePointCloud;
+
+	// Thread safe, the const stages create their pieces in it.
+	mutable PieceStore								m_pieceStore;
+};
+
+}
+
+#endif
@@ -2,10 +2,11 @@
 #define KDOP_H
 
 #include "Mesh.h"
+#include "thread_pool.h"
 
 // Forward declaration
-namespace VMACH { struct Polygon3D; }
-namespace Poly { struct Vertex; typedef std::vector<Poly::Vertex> Polyhedron; }
+namespace VMACH { struct Polygon3D; struct ClipDebugSink; }
+namespace Poly { struct Polyhedron; }
 
 namespace Kdop
 {
@@ -30,14 +31,79 @@ struct KdopContainer
 {
 	std::vector<KdopElement> ElementVec;
 
-	KdopContainer(const std::vector<Vector3>& normalVec);
+	// Normals dropped by the constructor, each one is two planes less.
+	int MergedNormalCnt = 0;
 
-	void				Calc(const std::vector<Vector3>& vertices, const double& maxAxisScale, const float& planeGapInv);
+	// Normals within angularTolerance (radian) of a kept normal, or of its opposite, are merged into it.
+	KdopContainer(const std::vector<Vector3>& normalVec, const float angularTolerance = 0.0f);
+
+	// Chunks of large meshes are projected on the thread pool, if given.
+	void				Calc(const std::vector<Vector3>& vertices, const double& maxAxisScale, const float& planeGapInv, dp::thread_pool<>* threadPool = nullptr);
 	void				Calc(const VMACH::Polygon3D& mesh);
 	void				Calc(const Poly::Polyhedron& mesh);
-	VMACH::Polygon3D	ClipWithPolygon(const VMACH::Polygon3D& polygon, int doTest = -1) const;
-	Poly::Polyhedron	ClipWithPolyhedron(const Poly::Polyhedron& polyhedron);
+	VMACH::Polygon3D	ClipWithPolygon(const VMACH::Polygon3D& polygon, int doTest = -1, VMACH::ClipDebugSink* debugSink = nullptr) const;
+
+	// Eliminated planes are the merged normals and the duplicated planes, which are not clipped.
+	Poly::Polyhedron	ClipWithPolyhedron(const Poly::Polyhedron& polyhedron, int* eliminatedPlaneCnt = nullptr) const;
+
+	// Min / max planes of the elements, without the duplicated ones.
+	std::vector<Plane>	CollectPlanes() const;
 	void				Render(std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData);
+
+private:
+	// Extreme projections onto one normal, within a chunk. Index is -1 if none.
+	struct Extent
+	{
+		float	MinDist = INFINITY;
+		float	MaxDist = -INFINITY;
+		int		MinIndex = -1;
+		int		MaxIndex = -1;
+	};
+
+	// Plane normalized and rounded to PlaneQuantum, equal keys are the same plane.
+	struct PlaneKey
+	{
+		int64_t	X, Y, Z, W;
+
+		bool operator==(const PlaneKey&) const = default;
+	};
+
+	struct PlaneKeyHash
+	{
+		size_t operator()(const PlaneKey& key) const;
+	};
+
+	typedef std::unordered_set<PlaneKey, PlaneKeyHash> PlaneKeySet;
+
+	static constexpr int ChunkVertexCnt = 8192;
+	static constexpr float PlaneQuantum = 1e-4f;
+
+	static PlaneKey		QuantizePlane(const Plane& plane);
+
+	static void			ProjectChunk(const std::vector<KdopElement>& elementVec, const float* px, const float* py, const float* pz,
+									 const int begin, const int end, Extent* extentVec);
+	static void			CalcExtent(std::vector<KdopElement>& elementVec, const float* px, const float* py, const float* pz,
+								   const int count, dp::thread_pool<>* threadPool);
+};
+
+// k-DOP with a direction set fixed at compile time. No convex hull is needed to find the normals.
+// 6 (box), 14 (box + corners), 18 (box + edges) and 26 (all of them) are instantiated in Kdop.cpp.
+template <int K>
+class FixedKdop
+{
+public:
+	static_assert(K == 6 || K == 14 || K == 18 || K == 26, "FixedKdop is defined for 6, 14, 18 and 26 directions.");
+
+	static constexpr int AxisCnt = K / 2;
+
+	void						Calc(const Poly::Polyhedron& mesh);
+	Poly::Polyhedron			ClipWithPolyhedron(const Poly::Polyhedron& polyhedron) const;
+
+	// Outward min / max plane pair of each axis, valid after Calc.
+	const std::array<Plane, K>&	GetPlanes() const { return m_planes; }
+
+private:
+	std::array<Plane, K>		m_planes;
 };
 
 }
@@ -12,6 +12,7 @@ struct VertexNormalColor
 							   const DirectX::XMFLOAT3 color = DirectX::XMFLOAT3(0.25f, 0.25f, 0.25f)) : Position(position), Normal(normal), Color(color) {}
 };
 
+#ifndef SURTR_HEADLESS
 struct MeshBase
 {
 	enum RenderOptionType
@@ -207,4 +208,6 @@ struct DynamicMesh : public MeshBase
 	}
 };
 
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef PIECE_STORE_H
+#define PIECE_STORE_H
+
+// Forward declaration
+namespace Poly { struct Polyhedron; }
+
+namespace Fracture
+{
+
+class Piece;
+struct Compound;
+
+// Piece of a PieceStore. The slot of a released piece is reused with a new generation, so old handles resolve to nullptr.
+struct PieceHandle
+{
+	uint32_t									Index = 0;
+	uint32_t									Generation = 0;		// Odd while the piece is alive.
+
+	bool										operator==(const PieceHandle& rhs) const = default;
+};
+
+struct PieceStoreStats
+{
+	size_t										LivePieceCnt = 0;
+	size_t										SlotCnt = 0;
+
+	// Live pieces with their polyhedra and cached data.
+	size_t										LiveBytes = 0;
+	// Slabs including the free slots, and the polyhedra and cached data of the live pieces.
+	size_t										TotalBytes = 0;
+};
+
+// Pieces are placed in slabs of fixed slots, which are never moved or freed until the store is destroyed.
+// Each thread takes its free slots a slab at a time, creating a piece only locks when the slots of the thread run out.
+// Slots a thread has not used go back to the store when it exits.
+// Released slots go back to the store and are handed out again, so repeated fractures do not grow the slabs.
+class PieceStore
+{
+public:
+
+	PieceStore();
+	// Destroys the pieces which are still alive.
+	~PieceStore();
+
+	PieceStore(PieceStore const&) = delete;
+	PieceStore& operator= (PieceStore const&) = delete;
+
+	// Thread safe.
+	PieceHandle									Create(const Poly::Polyhedron& convex, const Poly::Polyhedron& mesh);
+	PieceHandle									Create(Poly::Polyhedron&& convex, Poly::Polyhedron&& mesh);
+
+	// Thread safe, nullptr if the piece is released.
+	Piece*										Get(const PieceHandle handle) const;
+
+	// Thread safe, as long as the piece is not used at the same time. Released handles are ignored.
+	void										Release(const PieceHandle handle);
+	void										Release(const Compound& compound);
+	// Pieces of a compound which are not kept by the compounds replacing it, such as the ones out of the impact.
+	void										ReleaseReplaced(const Compound& replaced, const std::vector<Compound>& replacementVec);
+
+	// Walks every slot, call it while no piece is created, changed or released.
+	PieceStoreStats								GetStats() const;
+
+private:
+
+	static constexpr uint32_t					c_slabSlotCnt = 256;
+	static constexpr uint32_t					c_maxSlabCnt = 16384;
+
+	struct Slot;
+	struct Slab;
+	struct ThreadCache;
+
+	static thread_local ThreadCache				t_threadCache;
+
+	// Slot out of the free slots of the calling thread.
+	uint32_t									AcquireSlot();
+	PieceHandle									Publish(const uint32_t index);
+	// False if the piece is already released.
+	bool										Destroy(const PieceHandle handle);
+
+	// Live generation within the slabs, the slot may still be of another generation.
+	bool										IsInRange(const PieceHandle handle) const;
+	Slot&										GetSlot(const uint32_t index) const;
+
+	// Tells the slots of this store apart in the thread caches, never reused.
+	const uint64_t								m_storeID;
+
+	// Published by m_slabCnt, only appended under m_mutex.
+	std::unique_ptr<std::atomic<Slab*>[]>		m_slabArr;
+	std::atomic<uint32_t>						m_slabCnt = 0;
+
+	std::mutex									m_mutex;
+	std::vector<uint32_t>						m_freeSlotVec;
+};
+
+}
+
+#endif
@@ -12,34 +12,79 @@ namespace Poly
 using DirectX::SimpleMath::Vector3;
 using DirectX::SimpleMath::Plane;
 
-struct Vertex
+// Packed polyhedron.
+// Positions are stored per axis, adjacency is stored as offsets into a flat index array.
+// Neighbors of vertex i are NeighborIndex[NeighborOffset[i], NeighborOffset[i + 1]), ordered along the face loops.
+struct Polyhedron
 {
-	Vector3						Position;
-	std::vector<int>			NeighborVertexVec;
-	int							comp;
-	mutable int					ID;
-
-	Vertex();
-	Vertex(const Vector3& pos);
-	Vertex(const Vector3& pos, const int c);
-	Vertex(const Vertex& rhs);
-
-	Vertex& operator=(const Vertex& rhs);
-	bool    operator==(const Vertex& rhs) const;
+	std::vector<float>			X;
+	std::vector<float>			Y;
+	std::vector<float>			Z;
+	std::vector<int>			NeighborOffset = { 0 };
+	std::vector<int>			NeighborIndex;
+
+	size_t						size() const { return X.size(); }
+	bool						empty() const { return X.empty(); }
+	void						clear();
+	void						reserve(const size_t vertexCount, const size_t neighborCount);
+
+	Vector3						Position(const int i) const { return Vector3(X[i], Y[i], Z[i]); }
+	void						SetPosition(const int i, const Vector3& pos) { X[i] = pos.x; Y[i] = pos.y; Z[i] = pos.z; }
+
+	std::span<const int>		Neighbors(const int i) const { return { NeighborIndex.data() + NeighborOffset[i], NeighborIndex.data() + NeighborOffset[i + 1] }; }
+	std::span<int>				Neighbors(const int i) { return { NeighborIndex.data() + NeighborOffset[i], NeighborIndex.data() + NeighborOffset[i + 1] }; }
+
+	// Append vertex. Neighbor indices are not validated.
+	int							AddVertex(const Vector3& pos, std::span<const int> neighbors);
 };
 
-typedef	std::vector<Poly::Vertex> Polyhedron;
-typedef std::vector<std::vector<int>> Extract;
+// Face lists of a polyhedron, packed in the same way.
+// Vertices of face f are FaceIndex[FaceOffset[f], FaceOffset[f + 1]).
+struct Extract
+{
+	std::vector<int>			FaceOffset = { 0 };
+	std::vector<int>			FaceIndex;
+
+	size_t						size() const { return FaceOffset.size() - 1; }
+	bool						empty() const { return FaceOffset.size() <= 1; }
+	std::span<const int>		operator[](const size_t f) const { return { FaceIndex.data() + FaceOffset[f], FaceIndex.data() + FaceOffset[f + 1] }; }
+
+	void						AddFace(std::span<const int> face);
+
+	struct Iterator
+	{
+		const Extract*			Owner;
+		size_t					Face;
+
+		std::span<const int>	operator*() const { return (*Owner)[Face]; }
+		Iterator&				operator++() { ++Face; return *this; }
+		bool					operator!=(const Iterator& rhs) const { return Face != rhs.Face; }
+	};
+
+	Iterator					begin() const { return { this, 0 }; }
+	Iterator					end() const { return { this, size() }; }
+};
 
 // Manipulating Polyhedron.
 void							InitPolyhedron(Polyhedron& polyhedron, const std::vector<Vector3>& positionVec, const std::vector<std::vector<int>>& neighborVec);
+// Faces are counter clockwise from outside. Returns false if they do not close around every vertex.
+bool							InitPolyhedron(Polyhedron& polyhedron, const std::vector<Vector3>& positionVec, const Extract& faces);
 void							Moments(double& zerothMoment, Vector3& firstMoment, const Polyhedron& polyhedron);
-Extract*						ExtractFaces(const Polyhedron& polyhedron);
+void							Moments(double& zerothMoment, Vector3& firstMoment, const Polyhedron& polyhedron, const Extract& faces);
+Extract							ExtractFaces(const Polyhedron& polyhedron);
 std::vector<std::vector<int>>	ExtractNeighborFromMesh(std::vector<Vector3>& vertices, std::vector<int>& indices);
 
-void							ClipPolyhedron(Polyhedron& polyhedron, const std::vector<Plane>& planes);
+void							ClipPolyhedron(Polyhedron& polyhedron, std::span<const Plane> planes);
 Polyhedron						ClipPolyhedron(const Polyhedron& polyhedron, const VMACH::Polygon3D& polygon3D);
 
+// Inside is the part ClipPolyhedron keeps, outside is the rest.
+// Each edge crossing the plane is intersected once, both parts share the new vertices.
+void							SplitPolyhedron(const Polyhedron& polyhedron, const Plane& plane, Polyhedron& inside, Polyhedron& outside);
+
+// Parts of the polyhedron in the convex cells cellVec[cellIndexVec[i]], which must not overlap, like Voronoi cells.
+// Splits by one face plane at a time and hands each side to the cells on it, so a face shared by two cells is cut once.
+std::vector<Polyhedron>			PartitionPolyhedron(const Polyhedron& polyhedron, const std::vector<VMACH::Polygon3D>& cellVec, std::span<const int> cellIndexVec);
+
 void							Translate(Polyhedron& polyhedron, const Vector3& v);
 void							Scale(Polyhedron& polyhedron, const Vector3& v);
 void							Transform(Polyhedron& polyhedron, const DirectX::XMMATRIX& matrix);
@@ -56,24 +101,31 @@ void							RenderPolyhedronNormal(std::vector<VertexNormalColor>& vertexData,
 void							RenderPolyhedronNormal(std::vector<VertexNormalColor>& vertexData,
 													   std::vector<uint32_t>& indexData,
 													   const Polyhedron& poly,
-													   const Extract* extract,
+													   const Extract& extract,
 													   bool isConvex,
 													   Vector3 color = Vector3(0.25f, 0.25f, 0.25f));
 
 void							RenderPolyhedron(std::vector<VertexNormalColor>& vertexData, 
 												 std::vector<uint32_t>& indexData, 
 												 const Polyhedron& poly, 
-												 const Extract* extract, 
+												 const Extract& extract, 
 												 bool isConvex = true,
 												 Vector3 color = Vector3(0.25f, 0.25f, 0.25f));
 
 int								ComparePlanePoint(const Plane& plane, const Vector3& point);
 int								ComparePlaneBB(const Plane& plane, const double xmin, const double ymin, const double zmin, const double xmax, const double ymax, const double zmax);
-Vector3							PlaneLineIntersection(const typename Vector3& a, const typename Vector3& b, const Plane& plane);
+int								ComparePlaneBB(const float minDist, const float maxDist);
+Vector3							PlaneLineIntersection(const Vector3& a, const Vector3& b, const Plane& plane);
+
+// Vectorized plane tests.
+// PlaneBBDistance gives the signed distance range of the box corners for each plane.
+// ComparePlanePoints fills ComparePlanePoint of every vertex, returns -1 if none is kept, 1 if none is clipped, 0 otherwise.
+void							PlaneBBDistance(const Plane* planes, const size_t count, const float* bbMin, const float* bbMax, float* minDist, float* maxDist);
+int								ComparePlanePoints(const Plane& plane, const Polyhedron& polyhedron, std::vector<int>& compVec);
 
 // Triangulization
-bool							IsCCW(const Polyhedron& polyhedron, const std::vector<int>& face, const Vector3& normal);
-std::vector<int>				EarClipping(const Polyhedron& polyhedron, const std::vector<int>& face);
+bool							IsCCW(const Polyhedron& polyhedron, std::span<const int> face, const Vector3& normal);
+std::vector<int>				EarClipping(const Polyhedron& polyhedron, std::span<const int> face);
 };
 
 #endif
@@ -0,0 +1,68 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped zones recorded per thread, written as a Chrome trace (chrome://tracing, Perfetto).
+// Zones are only recorded with SURTR_PROFILE, and while a capture runs. Without it, the macros are empty.
+//
+// PROFILE_SCOPE("Name") records the enclosing scope, PROFILE_SCOPE_ARG("Name", value) also records an integer,
+// such as the index of a cell or of a piece. Names must outlive the capture, string literals are expected.
+
+#ifdef SURTR_PROFILE
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) const Profiler::Zone PROFILE_CONCAT(_profileZone, __LINE__)(name)
+#define PROFILE_SCOPE_ARG(name, value) const Profiler::Zone PROFILE_CONCAT(_profileZone, __LINE__)(name, (int64_t)(value))
+
+namespace Profiler
+{
+
+// Drops the events of the previous capture and starts recording.
+void	BeginCapture();
+void	EndCapture();
+bool	IsCapturing();
+
+// Name of the calling thread in the trace. Threads are named by their order of first use otherwise.
+void	SetThreadName(_In_ const char* name);
+
+// Writes the events of the last capture. Call it after EndCapture, while no zone is recorded.
+bool	WriteChromeTrace(_In_ const std::string& fileName);
+
+class Zone
+{
+public:
+	explicit Zone(_In_ const char* name, _In_ const int64_t arg = INT64_MIN);
+	~Zone();
+
+	Zone(const Zone&) = delete;
+	Zone& operator=(const Zone&) = delete;
+
+private:
+	const char*	m_name;
+	int64_t		m_arg;
+	int64_t		m_beginNs;
+	bool		m_record;
+};
+
+}
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_SCOPE_ARG(name, value)
+
+namespace Profiler
+{
+
+inline void	BeginCapture() {}
+inline void	EndCapture() {}
+inline bool	IsCapturing() { return false; }
+inline void	SetThreadName(_In_ const char*) {}
+inline bool	WriteChromeTrace(_In_ const std::string&) { return false; }
+
+}
+
+#endif
+
+#endif
@@ -5,10 +5,7 @@
 #include "ShadowMap.h"
 #include "Mesh.h"
 
-#include "VMACH.h"
-#include "Poly.h"
-#include "Kdop.h"
-#include "thread_pool.h"
+#include "Fracture.h"
 
 using namespace DirectX;
 using DirectX::SimpleMath::Vector3;
@@ -86,72 +83,46 @@ private:
 		uint8_t		Padding[104];
 	};
 
-	struct FractureArgs
-	{
-		INT			ICHIncludePointLimit = 20;
-		FLOAT		ACHPlaneGapInverse = 2000.0f;
-		INT			RefittingPointLimit = 4;
-
-		INT			Seed = 46354;
-
-		XMFLOAT3	ImpactPosition;
-		FLOAT		ImpactRadius = 1.0f;
-
-		bool		RadialMode = true;
-		bool		PartialFracture = true;
-		FLOAT		PartialFracturePatternDist = 0.01f;
-		FLOAT		GeneralFracturePatternDist = 1.0f;
+	typedef Fracture::Piece		Piece;
+	typedef Fracture::PieceHandle	PieceHandle;
+	typedef Fracture::Compound	Compound;
+	typedef Fracture::Extract	Extract;
 
-		INT			InitialDecomposeCellCnt = 64;
-		INT			PartialFracturePatternCellCnt = 128;
-		INT			GeneralFracturePatternCellCnt = 1024;
-
-		FLOAT		TargetAdder = 0.01f;
-	};
-
-	// Always allocated at heap.
-	struct Piece
+	struct FractureStorage
 	{
-		Poly::Polyhedron	Convex;
-		Poly::Polyhedron	Mesh;
-
-		Piece(const Poly::Polyhedron& convex, const Poly::Polyhedron& mesh) : Convex(convex), Mesh(mesh) {}
+		std::vector<Compound>						CompoundVec;
+		std::vector<physx::PxRigidDynamic*>			RigidDynamicVec;
+		std::vector<std::vector<DynamicMesh*>>		CompoundMeshVec;
 	};
 
-	typedef std::vector<std::vector<int>> Extract;
-
-	struct CompoundInfo
+	// Cooked convex and render data of a piece. Only the mesh buffers are left to the main thread.
+	struct PreparedPiece
 	{
-		std::vector<Piece*>							PieceVec;
-		std::vector<Extract*>						PieceExtractedConvex;
-		std::vector<std::set<int>>					CompoundBind;
+		physx::PxConvexMeshGeometry					Geometry;
+		std::vector<VertexNormalColor>				VertexData;
+		std::vector<uint32_t>						IndexData;
 	};
 
-	struct Compound
+	struct PreparedCompound
 	{
-		std::vector<Piece*>							PieceVec;
-		std::vector<Extract*>						PieceExtractedConvex;
+		Compound									Fractured;
+		std::vector<PreparedPiece>					PieceVec;
 	};
 
-	struct FractureResult
+	// Body to fracture, as it was when the job was submitted.
+	struct FractureTarget
 	{
-		UINT										ICHFaceCnt = 0;
-		UINT										ACHErrorPointCnt = 0;
+		physx::PxRigidActor*						RigidBody;
+		physx::PxTransform							Pose;
+		XMMATRIX									WorldMatrix;
+		Compound									Target;
 	};
 
-	struct FractureStorage
+	// Fracture running off the main thread. The target bodies keep simulating until the result is committed.
+	struct FractureJob
 	{
-		std::vector<Compound>						CompoundVec;
-		std::vector<physx::PxRigidDynamic*>			RigidDynamicVec;
-		std::vector<std::vector<DynamicMesh*>>		CompoundMeshVec;
-
-		std::vector<VMACH::Polygon3D>			PartialFracturePattern;
-		std::vector<VMACH::Polygon3D>			GeneralFracturePattern;
-
-		Vector3									BBCenter;
-		Vector3									MinBB;
-		Vector3									MaxBB;
-		float									MaxAxisScale;
+		std::vector<FractureTarget>							TargetVec;
+		std::future<std::vector<std::vector<PreparedCompound>>>	Result;		// Per target.
 	};
 
 	void Update(DX::StepTimer const& timer);
@@ -170,47 +141,23 @@ private:
 	void OnDeviceLost();
 
 	// Core feature functions
-	Compound						PrepareFracture(_In_ const std::vector<VertexNormalColor>& visualMeshVertices,
-													_In_ const std::vector<uint32_t>& visualMeshIndices);
-	
-	void							ExecuteFractureRoutine(physx::PxRigidActor* targetRididBody);
-	std::vector<Compound>			DoFracture(const Compound& targetCompound);
-
-	std::vector<Vector3>			GenerateICHNormal(_In_ const std::vector<Vector3>& vertices, _In_ const int ichIncludePointLimit) const;
-	std::vector<Vector3>			GenerateICHNormal(_In_ const Poly::Polyhedron& polyhedron, _In_ const int ichIncludePointLimit) const;
-
-	std::vector<VMACH::Polygon3D>	GenerateVoronoi(_In_ const int cellCount) const;
-	std::vector<VMACH::Polygon3D>	GenerateVoronoi(_In_ const std::vector<Vector3>& cellPointVec) const;
-	std::vector<VMACH::Polygon3D>	GenerateFracturePattern(_In_ const int cellCount, _In_ const double mean) const;
-
-	CompoundInfo					ApplyFracture(_In_ const Compound& compound,
-												  _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec, 
-												  _In_ const std::vector<Vector3>& spherePointCloud, 
-												  _In_ bool partial = false) const;
-
-	void							SetExtract(_Inout_ CompoundInfo& preResult) const;
-
-	void							_MeshIslandLoop(const int index, const Poly::Polyhedron& mesh, std::set<int>& group) const;
-	std::vector<std::set<int>>		CheckMeshIsland(_In_ const Poly::Polyhedron& polyhedron) const;
-
-	void							HandleConvexIsland(_Inout_ CompoundInfo& compoundInfo) const;
-	void							MergeOutOfImpact(_Inout_ CompoundInfo& compoundInfo, _In_ const std::vector<Vector3>& spherePointCloud) const;
-	void							Refitting(_Inout_ std::vector<Piece*>& targetPieceVec) const;
+	// Submit runs the fracture of the bodies as a job, commit swaps the result in at the start of a frame.
+	// Only one job runs at a time, the engine belongs to it until it is committed.
+	void							SubmitFractureJob(const std::vector<physx::PxRigidActor*>& targetRigidBodyVec);
+	void							CommitFractureJob();
 
 	// Utility
-	bool							ConvexOutOfSphere(_In_ const Poly::Polyhedron& polyhedron,
-													  _In_ const Extract* extract,
-													  _In_ const std::vector<Vector3>& spherePointCloud,
-													  _In_ const Vector3 origin,
-													  _In_ const float radius) const;
-
 	bool							ConvexRayIntersection(_In_ const VMACH::Polygon3D& convex,
 														  _In_ const Ray ray,
 														  _Out_ float& dist) const;
 
+	// Runs on the thread pool.
+	std::vector<PreparedPiece>		PrepareCompound(const Compound& compound, bool renderConvex);
+
 	void							InitCompound(const Compound& compound, bool renderConvex, const physx::PxVec3 translate = physx::PxVec3(0, 0, 0));
-	physx::PxConvexMeshGeometry		CookingConvex(const Piece* piece, const Extract* extract);
-	physx::PxConvexMeshGeometry		CookingConvexManual(const Poly::Polyhedron& polyhedron, const std::vector<std::vector<int>>& extract);
+	void							InitCompound(const Compound& compound, std::vector<PreparedPiece>&& preparedPieceVec, const physx::PxTransform& pose);
+	physx::PxConvexMeshGeometry		CookingConvex(const Piece* piece);
+	physx::PxConvexMeshGeometry		CookingConvexManual(const Poly::Polyhedron& polyhedron, const Extract& extract);
 
 	void							SetRigidBodyDebugValue(physx::PxRigidActor* rigidBody, const uint32_t debugValue);
 
@@ -267,9 +214,7 @@ private:
 	static constexpr UINT								c_nSBCnt				= 5000;
 	static constexpr UINT								c_nDynamicMeshPoolCnt	= 500;
 
-	std::function<std::pair<physx::PxConvexMeshGeometry, DynamicMesh*>(const Piece* piece, const Extract* extract, bool renderConvex)>				m_initCompoundTask;
-	std::function<void(Piece* piece)>																												m_refittingTask;
-	std::function<std::vector<Piece*>(const VMACH::Polygon3D& voroPoly, const std::vector<Piece*>& targetPieceVec, const std::set<int>& outside)>	m_fractureTask;
+	std::function<PreparedPiece(const Piece* piece, bool renderConvex)>										m_initCompoundTask;
 
 	// Memory Pools
 	std::queue<DynamicMesh*>							m_dynamicMeshPool;
@@ -341,7 +286,6 @@ private:
 
 	// Meshes
 	UINT                                                m_modelIndex;
-	std::vector<Vector3>								m_spherePointCloud;
 	std::vector<MeshSB>									m_structuredBufferData;
 	std::vector<physx::PxRigidActor*>					m_affectRigidBodyVec;
 
@@ -365,9 +309,20 @@ private:
 	bool												m_lightRotation;
 
 	// Feature parameters
-	FractureArgs										m_fractureArgs;
-	FractureResult										m_fractureResult;
+	// Arguments and results are copied to / from the engine only while no job runs.
+	Fracture::FractureEngine							m_fractureEngine;
+	Fracture::FractureArgs								m_fractureArgs;
+	Fracture::FractureResult							m_fractureResult;
+	Fracture::PieceStoreStats							m_pieceStoreStats;
 	FractureStorage										m_fractureStorage;
+	FractureJob											m_fractureJob;
+
+	// Thread pool options, applied only while no job runs. 0 threads is the hardware concurrency.
+	int													m_threadCnt = 0;
+	bool												m_pinThreads = false;
+
+	// Profiler trace of the next fracture job.
+	bool												m_captureTrace = false;
 
 	// WVP matrices
 	XMMATRIX											m_viewMatrix;
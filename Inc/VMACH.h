@@ -2,6 +2,7 @@
 #define VMACH_H
 
 #include "Mesh.h"
+#include "thread_pool.h"
 
 namespace VMACH
 {
@@ -13,6 +14,21 @@ struct PolygonEdge
 	std::vector<Vector3> VertexVec;
 };
 
+// Debug capture of clipping, opt-in through ClipContext.
+// Collects the points of convex faces which are clipped on more than two points.
+struct ClipDebugSink
+{
+	std::vector<PolygonEdge> EdgeVec;
+	std::vector<Vector3>     PointVec;
+};
+
+// State of one clipping call chain. Use one per thread, never share it.
+struct ClipContext
+{
+	ClipDebugSink*           DebugSink = nullptr;
+	std::vector<PolygonEdge> EdgeVec = {};	// Clipped edges of the current plane, reused between planes.
+};
+
 // If convex is not guranteed, face plane is NOT automatically generated.
 struct PolygonFace
 {
@@ -51,10 +67,9 @@ struct PolygonFace
 	void Rewind();
 	void __Reorder();
 
-	static PolygonFace ClipWithPlane(const PolygonFace& inFace, const Plane& clippingPlane,
-									 std::vector<PolygonEdge>& edgeVec);
-	static PolygonFace ClipWithFace(const PolygonFace& inFace, const PolygonFace& clippingFace,
-									std::vector<PolygonEdge>& edgeVec);
+	// Clipped edge is pushed to context.EdgeVec.
+	static PolygonFace ClipWithPlane(const PolygonFace& inFace, const Plane& clippingPlane, ClipContext& context);
+	static PolygonFace ClipWithFace(const PolygonFace& inFace, const PolygonFace& clippingFace, ClipContext& context);
 };
 
 struct Polygon3D
@@ -80,9 +95,18 @@ struct Polygon3D
 	void Scale(const float& scalar);
 	void Scale(const Vector3& vector);
 
+	static Polygon3D ClipWithPlane(const Polygon3D& inPolygon, const Plane& clippingPlane, ClipContext& context, int doTest = -1);
+	static Polygon3D ClipWithFace(const Polygon3D& inPolygon, const PolygonFace& clippingFace, ClipContext& context, int doTest = 0);
+	static Polygon3D ClipWithPolygon(const Polygon3D& inPolygon, const Polygon3D& clippingPolygon, ClipContext& context);
+
+	// Same as above, with a local context and no debug capture.
 	static Polygon3D ClipWithPlane(const Polygon3D& inPolygon, const Plane& clippingPlane, int doTest = -1);
 	static Polygon3D ClipWithFace(const Polygon3D& inPolygon, const PolygonFace& clippingFace, int doTest = 0);
 	static Polygon3D ClipWithPolygon(const Polygon3D& inPolygon, const Polygon3D& clippingPolygon);
+
+	// Clips the polygons on the thread pool. Results and debug captures keep the input order.
+	static std::vector<Polygon3D> ClipWithPolygon(const std::vector<Polygon3D>& inPolygonVec, const Polygon3D& clippingPolygon,
+												  dp::thread_pool<>& threadPool, ClipDebugSink* debugSink = nullptr);
 };
 
 struct ConvexHullVertex : public Vector3
@@ -95,40 +119,76 @@ struct ConvexHullVertex : public Vector3
 	ConvexHullVertex(const Vector3& v3) : Vector3(v3), Processed(false) {}
 };
 
+// Vertices are copied from the point cloud, VertexID is the index into it.
 struct ConvexHullFace
 {
 	bool             Visible;
+	int              VertexID[3];
+	int              EdgeID[3];
 	ConvexHullVertex Vertices[3];
 
 	ConvexHullFace(const ConvexHullVertex& p1, const ConvexHullVertex& p2, const ConvexHullVertex& p3);
+	ConvexHullFace(const std::vector<ConvexHullVertex>& pointCloud, int p1, int p2, int p3);
 
 	void  Rewind();
 	float CalcArea();
 };
 
+// Face1 and Face2 are indices into the face array, -1 if not linked.
 struct ConvexHullEdge
 {
 	bool             Remove;
-	ConvexHullFace* Face1;
-	ConvexHullFace* Face2;
+	int              Face1;
+	int              Face2;
+	int              EndPointID[2];
 	ConvexHullVertex EndPoints[2];
 
-	ConvexHullEdge(const ConvexHullVertex& p1, const ConvexHullVertex& p2);
+	ConvexHullEdge(const std::vector<ConvexHullVertex>& pointCloud, int p1, int p2);
+
+	void LinkFace(int face);
+	void EraseFace(int face);
+};
+
+// Open addressing table from an unordered vertex ID pair to an edge index.
+// Linear probing, erased slots are back-shifted so no tombstone is left.
+class ConvexHullEdgeMap
+{
+public:
+	int  Find(int p1, int p2) const;
+	void Insert(int p1, int p2, int edge);
+	void Erase(int p1, int p2);
+	void Reserve(size_t count);
+
+private:
+	static constexpr uint64_t EmptyKey = UINT64_MAX;
+
+	struct Slot
+	{
+		uint64_t Key = EmptyKey;
+		int      Edge = -1;
+	};
 
-	void LinkFace(ConvexHullFace* face);
-	void EraseFace(ConvexHullFace* face);
+	static uint64_t MakeKey(int p1, int p2);
+	size_t          Home(uint64_t key) const;
+
+	std::vector<Slot> m_slotVec = {};
+	size_t            m_count = 0;
 };
 
+// Incremental hull, inserting the point that maximizes the added volume first.
+// Each unprocessed point keeps the faces it can see (conflict graph),
+// so only the points around the removed faces are re-evaluated per insertion.
 class ConvexHull
 {
 public:
-	ConvexHull(const std::vector<ConvexHullVertex>& pointCloud, uint32_t limitCnt);
-	ConvexHull(const std::vector<Vector3>& pointCloud, uint32_t limitCnt);
+	// Conflicts of large clouds are collected on the thread pool, if given.
+	ConvexHull(const std::vector<ConvexHullVertex>& pointCloud, uint32_t limitCnt, dp::thread_pool<>* threadPool = nullptr);
+	ConvexHull(const std::vector<Vector3>& pointCloud, uint32_t limitCnt, dp::thread_pool<>* threadPool = nullptr);
 	~ConvexHull() = default;
 
-	bool                            Contains(const ConvexHullVertex& point) const;
-	const std::list<ConvexHullFace> GetFaces() const;
-	const std::list<ConvexHullEdge> GetEdges() const;
+	bool                              Contains(const ConvexHullVertex& point) const;
+	const std::vector<ConvexHullFace> GetFaces() const;
+	const std::vector<ConvexHullEdge> GetEdges() const;
 
 	void Render(std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData,
 				DirectX::SimpleMath::Vector3 color = { 0.25f, 0.25f, 0.25f }) const;
@@ -137,31 +197,139 @@ public:
 	static float Volume(const ConvexHullFace& face, const ConvexHullVertex& point);
 
 private:
-	static size_t           Key2Edge(const ConvexHullVertex& p1, const ConvexHullVertex& p2);
-	static ConvexHullVertex FindInnerPoint(const ConvexHullFace* face, const ConvexHullEdge& edge);
+	// Unprocessed point which sees the face, with its visible volume. (always positive)
+	struct Conflict
+	{
+		int   ID;
+		float Volume;
+	};
 
-	void CreateFace(const ConvexHullVertex& p1, const ConvexHullVertex& p2, const ConvexHullVertex& p3,
-					const ConvexHullVertex& innerPoint);
-	void CreateEdge(const ConvexHullVertex& p1, const ConvexHullVertex& p2, ConvexHullFace& newFace);
+	struct ConflictNode
+	{
+		int Face;
+		int Next;
+	};
+
+	// Max heap of point volumes. Ties go to the lower index, same as std::max_element.
+	struct VolumeEntry
+	{
+		float Volume;
+		int   Point;
 
-	void AddPointToHull(const ConvexHullVertex& point);
+		bool operator<(const VolumeEntry& rhs) const
+		{
+			return Volume < rhs.Volume || (Volume == rhs.Volume && Point > rhs.Point);
+		}
+	};
+
+	// Below this many candidate points per insertion, thread pool overhead is not paid back.
+	static constexpr size_t ParallelCandidateCnt = 8192;
+
+	// Heap is used if the point limit times this ratio exceeds the point count.
+	static constexpr size_t VolumeHeapRatio = 16;
+
+	static bool   SameWinding(const ConvexHullFace& face, const ConvexHullEdge& edge);
+
+	int  CreateFace(int p1, int p2, int p3, bool rewind);
+	int  CreateEdge(int p1, int p2, int newFace);
+
+	void LinkConflict(int face, const Conflict& conflict);
+	void MarkChanged(int point);
+	void CollectConflict(int newFace, int face1, int face2);
+	void UpdateAddedFaceConflict();
+	void BuildVolumeHeap();
+	bool PopMaxVolumePoint(int& point);
+	void AddPointToHull(int point);
 	bool BuildFirstHull();
 	void CreateConvexHull();
 
 	void CleanUp();
 
-	std::vector<ConvexHullFace*> m_visibleFaceVec = {};
-	std::vector<ConvexHullFace*> m_addedFaceVec = {};
+	std::vector<int>                 m_visibleFaceVec = {};
+	std::vector<int>                 m_addedFaceVec = {};
+	std::vector<std::pair<int, int>> m_addedFaceSourceVec = {};	// Surviving and removed face at the horizon edge, -1 for the first hull.
+	std::vector<int>                 m_horizonEdgeVec = {};
+	std::vector<int>                 m_changedPointVec = {};
 
-	uint32_t m_limitCnt = 0;
-	uint32_t m_processedPointCnt = 0;
+	uint32_t           m_limitCnt = 0;
+	uint32_t           m_processedPointCnt = 0;
+	dp::thread_pool<>* m_threadPool = nullptr;
 
 	std::vector<ConvexHullVertex> m_pointCloud = {};
 	std::vector<float>            m_pointVolume = {};
 
-	std::list<ConvexHullFace>                    m_faceList = {};
-	std::list<ConvexHullEdge>                    m_edgeList = {};
-	std::unordered_map<size_t, ConvexHullEdge*> m_edgeMap = {};
+	// Removed faces and edges stay in place, flagged by Visible / Remove.
+	std::vector<ConvexHullFace>         m_faceVec = {};
+	std::vector<ConvexHullEdge>         m_edgeVec = {};
+	ConvexHullEdgeMap                   m_edgeMap = {};
+
+	std::vector<std::vector<Conflict>>  m_faceConflictVec = {};
+	// Faces seen by each point, as linked lists in one pool. Removed faces are not unlinked.
+	std::vector<ConflictNode>           m_pointConflictPool = {};
+	std::vector<int>                    m_pointConflictHead = {};
+	std::vector<int>                    m_pointConflictCnt = {};	// Removed faces excluded.
+	std::vector<int>                    m_pointMark = {};	// Insertion count of the last change.
+
+	std::priority_queue<VolumeEntry>    m_volumeHeap = {};
+	bool                                m_useVolumeHeap = false;	// Otherwise, m_pointVolume is searched linearly.
+};
+
+// Exact hull by quickhull, only to find which points are hull vertices.
+// Points inside the hull, or on it within the tolerance, are discarded.
+// If the cloud is flat or the hull breaks down numerically, nothing is discarded.
+class QuickHull
+{
+public:
+	QuickHull(const std::vector<Vector3>& pointCloud);
+	~QuickHull() = default;
+
+	// Ascending, so the order of the point cloud is kept.
+	const std::vector<int>& GetHullPointIDs() const { return m_hullPointIDVec; }
+	size_t                  GetDiscardedCnt() const { return m_pointCnt - m_hullPointIDVec.size(); }
+
+private:
+	// Counter clockwise seen from outside. AdjFace[i] is across the edge VertexID[i] -> VertexID[(i + 1) % 3].
+	struct Face
+	{
+		bool    Remove;
+		int     VertexID[3];
+		int     AdjFace[3];
+		Vector3 Normal;
+		float   Offset;
+
+		// Points outside of the face, as a linked list through m_outsideNext.
+		int     OutsideHead;
+		int     FurthestPoint;
+		float   FurthestDist;
+	};
+
+	float Distance(const Face& face, int point) const;
+	int   FindMaxDotPoint(const Vector3& direction) const;
+
+	int  CreateFace(int p1, int p2, int p3);
+	void AssignPoint(const std::vector<int>& faceVec, int point);
+	bool BuildFirstHull();
+	bool AddPointToHull(int face);
+	bool CreateQuickHull();
+
+	size_t m_pointCnt = 0;
+	float  m_epsilon = 0.0f;
+
+	// Point cloud as SoA, for the extreme point search.
+	std::vector<float> m_X = {};
+	std::vector<float> m_Y = {};
+	std::vector<float> m_Z = {};
+
+	std::vector<Face> m_faceVec = {};	// Removed faces stay in place, flagged by Remove.
+	std::vector<int>  m_pendingFaceVec = {};
+	std::vector<int>  m_outsideNext = {};
+
+	std::vector<int> m_visibleFaceVec = {};
+	std::vector<int> m_addedFaceVec = {};
+	std::vector<int> m_faceMark = {};	// Eye point which visited the face last.
+	std::vector<int> m_coneFace = {};	// Added face starting at the horizon vertex, -1 if none.
+
+	std::vector<int> m_hullPointIDVec = {};
 };
 
 struct Triangle
@@ -194,7 +362,7 @@ bool      OnYourRight(const Vector3& a, const Vector3& b, const Vector3& c, cons
 double    CalcDistanceToPoint(const Vector3& point, const Plane& plane);
 bool      GetIntersectionPoint(const Vector3& p1, const Vector3& p2, const Plane& plane, Vector3& intersection);
 
-void RenderEdge(std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData);
+void RenderEdge(const ClipDebugSink& debugSink, std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData);
 }; // namespace VMACH
 
 #endif
@@ -1,5 +1,8 @@
 #pragma once
 
+// SURTR_HEADLESS builds only the fracture engine (Poly, VMACH, Kdop, Fracture).
+// No Win32, D3D12, imgui or assimp headers are pulled in.
+#ifndef SURTR_HEADLESS
 #include <winsdkver.h>
 #ifndef _WIN32_WINNT
 	#define _WIN32_WINNT 0x0A00
@@ -14,9 +17,11 @@
 #define NOSERVICE
 #define NOHELP
 #define WIN32_LEAN_AND_MEAN
+#endif
 
 #define EPSILON 1e-12
 
+#ifndef SURTR_HEADLESS
 #include <Windows.h>
 
 #include <wrl/client.h>
@@ -27,12 +32,18 @@
 #include "shellapi.h"
 
 #include <dxgi1_4.h>
+#endif
 
 #include <DirectXMath.h>
+#ifndef SURTR_HEADLESS
 #include <DirectXColors.h>
+#endif
 #include <DirectXCollision.h>
 
 #include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -54,6 +65,10 @@
 #include <numeric>
 #include <format>
 #include <queue>
+#include <span>
+#include <mutex>
+#include <atomic>
+#ifndef SURTR_HEADLESS
 #include <windowsx.h>
 
 #ifdef _DEBUG
@@ -64,8 +79,10 @@
 #include "StepTimer.h"
 #include "DDSTextureLoader12.h"
 #include "ReadData.h"
+#endif
 #include "SimpleMath.h"
 
+#ifndef SURTR_HEADLESS
 // imgui
 #include "imgui/imgui_impl_win32.h"
 #include "imgui/imgui_impl_dx12.h"
@@ -76,9 +93,11 @@
 #include <postprocess.h>
 
 #pragma warning(disable : 4061)
+#endif
 
 #include <stdarg.h>
 
+#ifndef SURTR_HEADLESS
 namespace DX
 {
     inline void ThrowIfFailed(HRESULT hr)
@@ -99,6 +118,38 @@ static void _DebugOut(const wchar_t* fmt, ...)
 	va_end(argp);
 	OutputDebugString(dbg_out);
 }
+#else
+#include <cstdio>
+#include <cwchar>
+
+#ifndef TRUE
+	#define TRUE 1
+#endif
+#ifndef FALSE
+	#define FALSE 0
+#endif
+
+// SAL annotations come with sal.h on Windows.
+#ifndef _In_
+	#define _In_
+	#define _In_opt_
+	#define _Out_
+	#define _Out_opt_
+	#define _Inout_
+#endif
+
+#define OutputDebugStringW(str) std::fputws(str, stderr)
+
+static void _DebugOut(const wchar_t* fmt, ...)
+{
+	va_list argp;
+	va_start(argp, fmt);
+	std::vfwprintf(stderr, fmt, argp);
+	va_end(argp);
+}
+
+#define OutputDebugStringWFormat(fmt, ...) _DebugOut(fmt __VA_OPT__(,) __VA_ARGS__);
+#endif
 
 template <typename T>
 static void UniqueVector(const std::vector<T>& dupVec, std::vector<T>& uniqueVec)
@@ -117,25 +168,6 @@ static size_t CombineHash(size_t lhs, size_t rhs)
     return lhs;
 }
 
+#ifndef SURTR_HEADLESS
 #define OutputDebugStringWFormat(fmt, ...) _DebugOut(fmt, __VA_ARGS__);
-
-#define TIMER_INIT \
-    LARGE_INTEGER freq; \
-    LARGE_INTEGER st,en; \
-    double el; \
-    QueryPerformanceFrequency(&freq)
-
-#define TIMER_START QueryPerformanceCounter(&st)
-
-#define TIMER_START_NAME(name) \
-OutputDebugStringW(name); \
-QueryPerformanceCounter(&st)
-
-#define TIMER_STOP \
-    QueryPerformanceCounter(&en); \
-    el=(float)(en.QuadPart-st.QuadPart)/freq.QuadPart
-
-#define TIMER_STOP_PRINT \
-    QueryPerformanceCounter(&en); \
-    el=(float)(en.QuadPart-st.QuadPart)/freq.QuadPart; \
-    OutputDebugStringWFormat(L"%f\n", el*1000)
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,1409 @@
+#include "pch.h"
+#include "Fracture.h"
+#include "DT3D.h"
+#include "Profiler.h"
+
+#include "voro++.hh"
+
+using namespace DirectX;
+using namespace SimpleMath;
+
+dp::thread_pool<> g_threadPool;
+
+static double ElapsedMs(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void PushStage(std::vector<Fracture::FractureStage>& stageVec, const char* name, std::chrono::steady_clock::time_point& start)
+{
+	stageVec.push_back(Fracture::FractureStage(name, ElapsedMs(start)));
+	start = std::chrono::steady_clock::now();
+}
+
+template <typename T>
+static size_t CapacityBytes(const std::vector<T>& vec)
+{
+	return vec.capacity() * sizeof(T);
+}
+
+static size_t PolyhedronHeapSize(const Poly::Polyhedron& polyhedron)
+{
+	return CapacityBytes(polyhedron.X) + CapacityBytes(polyhedron.Y) + CapacityBytes(polyhedron.Z) +
+		CapacityBytes(polyhedron.NeighborOffset) + CapacityBytes(polyhedron.NeighborIndex);
+}
+
+// Convex clipped by the fixed direction k-DOP of the mesh.
+template <int K>
+static Poly::Polyhedron RefitFixedKdop(const Poly::Polyhedron& mesh, const Poly::Polyhedron& convex)
+{
+	if (mesh.empty())
+		return convex;
+
+	Kdop::FixedKdop<K> kdop;
+	kdop.Calc(mesh);
+
+	return kdop.ClipWithPolyhedron(convex);
+}
+
+// Uniform grid over axis aligned boxes, used to find the pattern cells a piece can touch.
+// Box indices are bucketed per voxel and stored as offsets into one flat array.
+class BoxGrid
+{
+public:
+
+	BoxGrid(const std::vector<Vector3>& minVec, const std::vector<Vector3>& maxVec) : m_minVec(minVec), m_maxVec(maxVec)
+	{
+		const int count = minVec.size();
+		if (count == 0)
+			return;
+
+		// 1. Grid bounds, about one box per voxel.
+		m_min = minVec[0];
+		m_max = maxVec[0];
+		for (int i = 1; i < count; i++)
+		{
+			m_min = Vector3::Min(m_min, minVec[i]);
+			m_max = Vector3::Max(m_max, maxVec[i]);
+		}
+
+		m_res = std::max(1, (int)std::ceil(std::cbrt((double)count)));
+		const Vector3 extent = m_max - m_min;
+		m_invVoxel = Vector3(extent.x > 0 ? m_res / extent.x : 0, extent.y > 0 ? m_res / extent.y : 0, extent.z > 0 ? m_res / extent.z : 0);
+
+		// 2. Count, then fill the voxel buckets.
+		m_offset.assign(m_res * m_res * m_res + 1, 0);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			std::vector<int> cursor;
+			if (pass == 1)
+			{
+				std::partial_sum(m_offset.begin(), m_offset.end(), m_offset.begin());
+				m_index.resize(m_offset.back());
+				cursor.assign(m_offset.begin(), std::prev(m_offset.end()));
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				int lo[3], hi[3];
+				VoxelRange(minVec[i], maxVec[i], lo, hi);
+
+				for (int z = lo[2]; z <= hi[2]; z++)
+					for (int y = lo[1]; y <= hi[1]; y++)
+						for (int x = lo[0]; x <= hi[0]; x++)
+						{
+							const int voxel = (z * m_res + y) * m_res + x;
+							if (pass == 0)
+								m_offset[voxel + 1]++;
+							else
+								m_index[cursor[voxel]++] = i;
+						}
+			}
+		}
+	}
+
+	// Indices of boxes overlapping [minBB, maxBB], in ascending order.
+	void Query(const Vector3& minBB, const Vector3& maxBB, std::vector<int>& result) const
+	{
+		result.clear();
+		if (m_index.empty() ||
+			maxBB.x < m_min.x || maxBB.y < m_min.y || maxBB.z < m_min.z ||
+			minBB.x > m_max.x || minBB.y > m_max.y || minBB.z > m_max.z)
+			return;
+
+		int lo[3], hi[3];
+		VoxelRange(minBB, maxBB, lo, hi);
+
+		for (int z = lo[2]; z <= hi[2]; z++)
+			for (int y = lo[1]; y <= hi[1]; y++)
+				for (int x = lo[0]; x <= hi[0]; x++)
+				{
+					const int voxel = (z * m_res + y) * m_res + x;
+					for (int k = m_offset[voxel]; k < m_offset[voxel + 1]; k++)
+					{
+						const int i = m_index[k];
+						if (m_maxVec[i].x < minBB.x || m_maxVec[i].y < minBB.y || m_maxVec[i].z < minBB.z ||
+							m_minVec[i].x > maxBB.x || m_minVec[i].y > maxBB.y || m_minVec[i].z > maxBB.z)
+							continue;
+
+						result.push_back(i);
+					}
+				}
+
+		// Boxes spanning several voxels are found more than once.
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+	}
+
+private:
+
+	void VoxelRange(const Vector3& minBB, const Vector3& maxBB, int* lo, int* hi) const
+	{
+		const auto toVoxel = [this](const float v, const float origin, const float inv)
+		{
+			return std::clamp((int)std::floor((v - origin) * inv), 0, m_res - 1);
+		};
+
+		lo[0] = toVoxel(minBB.x, m_min.x, m_invVoxel.x);	hi[0] = toVoxel(maxBB.x, m_min.x, m_invVoxel.x);
+		lo[1] = toVoxel(minBB.y, m_min.y, m_invVoxel.y);	hi[1] = toVoxel(maxBB.y, m_min.y, m_invVoxel.y);
+		lo[2] = toVoxel(minBB.z, m_min.z, m_invVoxel.z);	hi[2] = toVoxel(maxBB.z, m_min.z, m_invVoxel.z);
+	}
+
+	const std::vector<Vector3>&	m_minVec;
+	const std::vector<Vector3>&	m_maxVec;
+
+	Vector3						m_min;
+	Vector3						m_max;
+	Vector3						m_invVoxel;
+	int							m_res = 0;
+
+	std::vector<int>			m_offset;
+	std::vector<int>			m_index;
+};
+
+Fracture::Piece::Piece(const Poly::Polyhedron& convex, const Poly::Polyhedron& mesh)
+	: m_convex(convex), m_mesh(mesh), m_convexCache(std::make_unique<LazyCache>()), m_meshCache(std::make_unique<LazyCache>())
+{
+}
+
+Fracture::Piece::Piece(Poly::Polyhedron&& convex, Poly::Polyhedron&& mesh)
+	: m_convex(std::move(convex)), m_mesh(std::move(mesh)), m_convexCache(std::make_unique<LazyCache>()), m_meshCache(std::make_unique<LazyCache>())
+{
+}
+
+const Fracture::PolyhedronCache& Fracture::Piece::GetConvexCache() const
+{
+	return Resolve(*m_convexCache, m_convex);
+}
+
+const Fracture::PolyhedronCache& Fracture::Piece::GetMeshCache() const
+{
+	return Resolve(*m_meshCache, m_mesh);
+}
+
+void Fracture::Piece::SetConvex(Poly::Polyhedron&& convex)
+{
+	m_convex = std::move(convex);
+	m_convexCache = std::make_unique<LazyCache>();
+}
+
+void Fracture::Piece::Transform(const DirectX::XMMATRIX& matrix)
+{
+	Poly::Transform(m_convex, matrix);
+	Poly::Transform(m_mesh, matrix);
+
+	m_convexCache = std::make_unique<LazyCache>();
+	m_meshCache = std::make_unique<LazyCache>();
+}
+
+size_t Fracture::Piece::GetHeapSize() const
+{
+	size_t size = PolyhedronHeapSize(m_convex) + PolyhedronHeapSize(m_mesh);
+
+	for (const LazyCache* cache : { m_convexCache.get(), m_meshCache.get() })
+	{
+		size += sizeof(LazyCache);
+		size += CapacityBytes(cache->Data.Faces.FaceOffset) + CapacityBytes(cache->Data.Faces.FaceIndex) + CapacityBytes(cache->Data.FacePlanes);
+	}
+
+	return size;
+}
+
+const Fracture::PolyhedronCache& Fracture::Piece::Resolve(LazyCache& cache, const Poly::Polyhedron& polyhedron)
+{
+	std::call_once(cache.Flag, [&cache, &polyhedron]()
+	{
+		PolyhedronCache& data = cache.Data;
+		if (polyhedron.empty())
+			return;
+
+		// 1. Faces and outward face planes.
+		data.Faces = Poly::ExtractFaces(polyhedron);
+		data.FacePlanes.reserve(data.Faces.size());
+		for (const auto f : data.Faces)
+		{
+			const Vector3 p0 = polyhedron.Position(f[0]);
+			Vector3 normal = (polyhedron.Position(f[1]) - p0).Cross(polyhedron.Position(f[2]) - p0);
+			normal.Normalize();
+
+			data.FacePlanes.push_back(Plane(p0, normal));
+		}
+
+		// 2. Bounding box and bounding sphere around its center.
+		const auto x = std::minmax_element(polyhedron.X.begin(), polyhedron.X.end());
+		const auto y = std::minmax_element(polyhedron.Y.begin(), polyhedron.Y.end());
+		const auto z = std::minmax_element(polyhedron.Z.begin(), polyhedron.Z.end());
+		data.MinBB = Vector3(*x.first, *y.first, *z.first);
+		data.MaxBB = Vector3(*x.second, *y.second, *z.second);
+
+		data.SphereCenter = (data.MinBB + data.MaxBB) * 0.5f;
+		for (int v = 0; v < polyhedron.size(); v++)
+			data.SphereRadius = std::max(data.SphereRadius, (polyhedron.Position(v) - data.SphereCenter).Length());
+
+		// 3. Volume and centroid.
+		Poly::Moments(data.Volume, data.Centroid, polyhedron, data.Faces);
+	});
+
+	return cache.Data;
+}
+
+Fracture::FractureEngine::FractureEngine()
+{
+	m_refittingTask = [this](Piece* piece) -> void
+	{
+		PROFILE_SCOPE("Refit");
+
+		const Poly::Polyhedron& mesh = piece->GetMesh();
+
+		switch (m_fractureArgs.Refitting)
+		{
+		case RefittingMode::Kdop6:	piece->SetConvex(RefitFixedKdop<6>(mesh, piece->GetConvex())); return;
+		case RefittingMode::Kdop14:	piece->SetConvex(RefitFixedKdop<14>(mesh, piece->GetConvex())); return;
+		case RefittingMode::Kdop18:	piece->SetConvex(RefitFixedKdop<18>(mesh, piece->GetConvex())); return;
+		case RefittingMode::Kdop26:	piece->SetConvex(RefitFixedKdop<26>(mesh, piece->GetConvex())); return;
+		default:					break;
+		}
+
+		Kdop::KdopContainer kdop(GenerateICHNormal(mesh, std::min((int)mesh.size(), m_fractureArgs.RefittingPointLimit)), m_fractureArgs.KdopNormalTolerance);
+		kdop.Calc(mesh);
+
+		piece->SetConvex(kdop.ClipWithPolyhedron(piece->GetConvex()));
+	};
+
+	m_fractureTask = [this](const VMACH::Polygon3D& voroPoly, const std::vector<const Piece*>& targetPieceVec, const std::vector<int>& pieceIndexVec) -> std::vector<PieceHandle>
+	{
+		std::vector<PieceHandle> localDecompose;
+
+		for (const int c : pieceIndexVec)
+		{
+			Poly::Polyhedron convex = Poly::ClipPolyhedron(targetPieceVec[c]->GetConvex(), voroPoly);
+			if (convex.empty())
+				continue;
+
+			Poly::Polyhedron mesh = Poly::ClipPolyhedron(targetPieceVec[c]->GetMesh(), voroPoly);
+			if (mesh.empty())
+				continue;
+
+			AppendPiece(std::move(convex), std::move(mesh), localDecompose);
+		}
+
+		return localDecompose;
+	};
+}
+
+void Fracture::FractureEngine::SetSpherePointCloud(_In_ const std::vector<Vector3>& spherePointCloud)
+{
+	m_spherePointCloud = spherePointCloud;
+}
+
+Fracture::Compound Fracture::FractureEngine::PrepareFracture(_In_ const std::vector<Vector3>& vertices, _In_ const std::vector<uint32_t>& indices)
+{
+	PROFILE_SCOPE("PrepareFracture");
+
+	m_fractureResult.StageVec.clear();
+	auto stageStart = std::chrono::steady_clock::now();
+
+	// 1. Create intermediate convex hull with limit count.
+	// 2. Collect ICH face normals.
+	// Full model is large, and PrepareFracture is not running on the thread pool.
+	std::vector<Vector3> ichFaceNormalVec = GenerateICHNormal(vertices, m_fractureArgs.ICHIncludePointLimit, &g_threadPool, &m_fractureResult.ICHDiscardedPointCnt);
+	m_fractureResult.ICHFaceCnt = ichFaceNormalVec.size();
+
+	PushStage(m_fractureResult.StageVec, "ICH", stageStart);
+
+	// 3. Calculate bounding box.
+	double minX, maxX, minY, maxY, minZ, maxZ;
+	{
+		const auto x = std::minmax_element(vertices.begin(), vertices.end(), [](const Vector3& p1, const Vector3& p2) { return p1.x < p2.x; });
+		const auto y = std::minmax_element(vertices.begin(), vertices.end(), [](const Vector3& p1, const Vector3& p2) { return p1.y < p2.y; });
+		const auto z = std::minmax_element(vertices.begin(), vertices.end(), [](const Vector3& p1, const Vector3& p2) { return p1.z < p2.z; });
+
+		minX = (*x.first).x;    maxX = (*x.second).x;
+		minY = (*y.first).y;    maxY = (*y.second).y;
+		minZ = (*z.first).z;    maxZ = (*z.second).z;
+	}
+
+	m_fractureStorage.BBCenter = Vector3((maxX + minX) / 2.0, (maxY + minY) / 2.0, (maxZ + minZ) / 2.0);
+	m_fractureStorage.MinBB = Vector3(minX, minY, minZ);
+	m_fractureStorage.MaxBB = Vector3(maxX, maxY, maxZ);
+	m_fractureStorage.MaxAxisScale = std::max(std::max(maxX - minX, maxY - minY), maxZ - minZ);
+
+	// 4. Calculate min/max plane for k-DOP generation.
+	Kdop::KdopContainer achKdop(ichFaceNormalVec, m_fractureArgs.KdopNormalTolerance);
+	achKdop.Calc(vertices, m_fractureStorage.MaxAxisScale, m_fractureArgs.ACHPlaneGapInverse, &g_threadPool);
+
+	// 5. Init bounding box polygon.
+	Poly::Polyhedron achPolyhedron = Poly::GetBB();
+	Poly::Scale(achPolyhedron, Vector3((maxX - minX), (maxY - minY), (maxZ - minZ)));
+	Poly::Scale(achPolyhedron, Vector3(2.0, 2.0, 2.0));
+	Poly::Translate(achPolyhedron, m_fractureStorage.BBCenter);
+
+	// 6. Clip ACH polygon with clipping faces.
+	int eliminatedPlaneCnt = 0;
+	achPolyhedron = achKdop.ClipWithPolyhedron(achPolyhedron, &eliminatedPlaneCnt);
+	m_fractureResult.ACHEliminatedPlaneCnt = eliminatedPlaneCnt;
+
+	PushStage(m_fractureResult.StageVec, "ACH", stageStart);
+
+	// 7. Init Mesh Polygon.
+	Poly::Polyhedron meshPolyhedron;
+	{
+		std::vector<Vector3> meshVertices = vertices;
+		std::vector<int> meshIndices(indices.size());
+		std::transform(indices.begin(), indices.end(), meshIndices.begin(), [](const uint32_t i) { return (int)i; });
+
+		const std::vector<std::vector<int>> nei = Poly::ExtractNeighborFromMesh(meshVertices, meshIndices);
+		Poly::InitPolyhedron(meshPolyhedron, meshVertices, nei);
+	}
+
+	// 8. Voronoi diagram generation for initial decomposition.
+	std::vector<Vector3> voroSiteVec;
+	std::vector<VMACH::Polygon3D> voroPolyVec = GenerateVoronoi(m_fractureArgs.InitialDecomposeCellCnt, &g_threadPool, &voroSiteVec);
+	const Vector3 voroScale((maxX - minX), (maxY - minY), (maxZ - minZ));
+	for (VMACH::Polygon3D& voro : voroPolyVec)
+	{
+		voro.Scale(voroScale);
+		voro.Translate(m_fractureStorage.BBCenter);
+	}
+
+	// 9. Generate Fracture Pattern.
+	m_fractureStorage.PartialFracturePattern = GenerateFracturePattern(m_fractureArgs.PartialFracturePatternCellCnt, m_fractureArgs.PartialFracturePatternDist,
+																	   &g_threadPool, &m_fractureStorage.PartialFracturePatternSite);
+	m_fractureStorage.GeneralFracturePattern = GenerateFracturePattern(m_fractureArgs.GeneralFracturePatternCellCnt, m_fractureArgs.GeneralFracturePatternDist,
+																	   &g_threadPool, &m_fractureStorage.GeneralFracturePatternSite);
+
+	PushStage(m_fractureResult.StageVec, "Voronoi", stageStart);
+
+	// 10. Generate initial pieces.
+	Compound preCompound = Compound({ m_pieceStore.Create(std::move(achPolyhedron), std::move(meshPolyhedron)) });
+	//     Pieces of a cell are refitted as soon as the cell is done.
+	CompoundInfo initial = ApplyFracture(preCompound, voroPolyVec, voroSiteVec, voroScale, m_fractureStorage.BBCenter, m_spherePointCloud, false,
+										 [this](const int /*cell*/, const std::vector<PieceHandle>& cellPieceVec)
+										 {
+											 for (const PieceHandle piece : cellPieceVec)
+												 m_refittingTask(m_pieceStore.Get(piece));
+										 });
+
+	//     ACH piece itself is not kept by the cells.
+	m_pieceStore.Release(preCompound);
+
+	PushStage(m_fractureResult.StageVec, "ApplyFracture", stageStart);
+
+	Compound result;
+	for (const auto& iComp : initial.CompoundBind)
+	{
+		for (const int iPiece : iComp)
+			result.PieceVec.push_back(initial.PieceVec[iPiece]);
+	}
+
+	return result;
+}
+
+
+std::vector<Fracture::Compound> Fracture::FractureEngine::DoFracture(_In_ const Compound& targetCompound, _In_opt_ const PieceTask& pieceTask)
+{
+	PROFILE_SCOPE("DoFracture");
+
+	std::vector<VMACH::Polygon3D> localFracturePattern = m_fractureArgs.PartialFracture ? m_fractureStorage.PartialFracturePattern : m_fractureStorage.GeneralFracturePattern;
+	const std::vector<Vector3>& patternSiteVec = m_fractureArgs.PartialFracture ? m_fractureStorage.PartialFracturePatternSite : m_fractureStorage.GeneralFracturePatternSite;
+	std::vector<Vector3> localSpherePointCloud = m_spherePointCloud;
+
+	// Scale.
+	const Vector3 patternScale = Vector3(m_fractureStorage.MaxAxisScale, m_fractureStorage.MaxAxisScale, m_fractureStorage.MaxAxisScale) * 2;
+	for (VMACH::Polygon3D& voro : localFracturePattern)
+		voro.Scale(patternScale);
+
+	// Alignment.
+	for (VMACH::Polygon3D& voro : localFracturePattern)
+		voro.Translate(m_fractureArgs.ImpactPosition);
+
+	// Align sphere point cloud.
+	for (auto& v : localSpherePointCloud)
+	{
+		v *= m_fractureArgs.ImpactRadius;
+		v += m_fractureArgs.ImpactPosition;
+	}
+
+	m_fractureResult.StageVec.clear();
+	auto stageStart = std::chrono::steady_clock::now();
+
+	// Bind of a cell, indexed into the pieces of the cell.
+	struct CellStream
+	{
+		std::set<int>				Bind;
+		std::set<int>				Outside;
+		std::vector<std::set<int>>	IslandVec;
+	};
+
+	std::vector<CellStream> cellStreamVec(localFracturePattern.size());
+
+	// 11. Apply fracture pattern.
+	//     Each cell goes through merging, island split, refitting and the piece task on its own.
+	//     Pieces moved out of the impact are left for the join below, since they are bound together.
+	CompoundInfo second = ApplyFracture(targetCompound, localFracturePattern, patternSiteVec, patternScale, m_fractureArgs.ImpactPosition,
+										localSpherePointCloud, m_fractureArgs.PartialFracture,
+										[&](const int cell, const std::vector<PieceHandle>& cellPieceVec)
+										{
+											PROFILE_SCOPE_ARG("CellStream", cell);
+
+											CellStream& stream = cellStreamVec[cell];
+											for (int c = 0; c < cellPieceVec.size(); c++)
+												stream.Bind.insert(c);
+
+											if (TRUE == m_fractureArgs.PartialFracture)
+												stream.Outside = MergeOutOfImpact(cellPieceVec, stream.Bind, localSpherePointCloud);
+
+											stream.IslandVec = HandleConvexIsland(cellPieceVec, stream.Bind);
+
+											for (int c = 0; c < cellPieceVec.size(); c++)
+											{
+												if (TRUE == stream.Outside.contains(c))
+													continue;
+
+												Piece* piece = m_pieceStore.Get(cellPieceVec[c]);
+												m_refittingTask(piece);
+												if (pieceTask)
+													pieceTask(piece);
+											}
+										});
+
+	PushStage(m_fractureResult.StageVec, "ApplyFracture", stageStart);
+
+	// 12. Join pieces out of the impact.
+	//     Cells are laid out after the outside target pieces, in cell order.
+	std::vector<std::set<int>>& bind = second.CompoundBind;
+	std::set<int> outsideBind = bind[0];
+
+	int offset = (int)outsideBind.size();
+	std::vector<int> cellOffsetVec(cellStreamVec.size());
+	for (int cell = 0; cell < cellStreamVec.size(); cell++)
+	{
+		const CellStream& stream = cellStreamVec[cell];
+		cellOffsetVec[cell] = offset;
+		offset += (int)(stream.Bind.size() + stream.Outside.size());
+		for (const std::set<int>& island : stream.IslandVec)
+			offset += (int)island.size();
+
+		for (const int c : stream.Outside)
+			outsideBind.insert(cellOffsetVec[cell] + c);
+	}
+
+	const std::vector<std::set<int>> outsideIslandVec = HandleConvexIsland(second.PieceVec, outsideBind);
+
+	std::vector<PieceHandle> outsidePieceVec;
+	for (const int c : outsideBind)
+		outsidePieceVec.push_back(second.PieceVec[c]);
+	for (const std::set<int>& island : outsideIslandVec)
+		for (const int c : island)
+			outsidePieceVec.push_back(second.PieceVec[c]);
+
+	Refitting(outsidePieceVec, pieceTask);
+
+	PushStage(m_fractureResult.StageVec, "Join", stageStart);
+
+	// 13. Same order as the stages run one by one.
+	//     Out of impact, cells, then the islands split from them.
+	const auto toGlobal = [](const std::set<int>& local, const int cellOffset)
+	{
+		std::set<int> global;
+		for (const int c : local)
+			global.insert(cellOffset + c);
+
+		return global;
+	};
+
+	bind.clear();
+	bind.push_back(outsideBind);
+	for (int cell = 0; cell < cellStreamVec.size(); cell++)
+	{
+		if (FALSE == cellStreamVec[cell].Bind.empty())
+			bind.push_back(toGlobal(cellStreamVec[cell].Bind, cellOffsetVec[cell]));
+	}
+
+	bind.insert(bind.end(), outsideIslandVec.begin(), outsideIslandVec.end());
+	for (int cell = 0; cell < cellStreamVec.size(); cell++)
+	{
+		for (const std::set<int>& island : cellStreamVec[cell].IslandVec)
+			bind.push_back(toGlobal(island, cellOffsetVec[cell]));
+	}
+
+	std::vector<Compound> result;
+	for (const auto& iComp : second.CompoundBind)
+	{
+		std::vector<PieceHandle> pieceVec;
+		for (const int iPiece : iComp)
+			pieceVec.push_back(second.PieceVec[iPiece]);
+
+		result.push_back(Compound(pieceVec));
+	}
+
+	return result;
+}
+
+std::vector<Fracture::Vector3> Fracture::FractureEngine::GenerateICHNormal(_In_ const std::vector<Vector3>& vertices, _In_ const int ichIncludePointLimit,
+																		 _In_opt_ dp::thread_pool<>* threadPool, _Out_opt_ uint32_t* discardedPointCnt) const
+{
+	// Only the exact hull vertices can maximize the added volume, so the rest is dropped first.
+	// Up to 4 points, only the first hull is built. Short runs are also cheaper than the exact hull.
+	const bool exactHullPrefilter = ichIncludePointLimit == 0 ||
+		(ichIncludePointLimit > 4 && (size_t)ichIncludePointLimit * ICHExactHullRatio > vertices.size());
+
+	std::vector<Vector3> hullPointVec;
+	if (exactHullPrefilter)
+	{
+		// Point IDs are ascending, so ties in the greedy step are broken the same way.
+		VMACH::QuickHull exactHull(vertices);
+		hullPointVec.reserve(exactHull.GetHullPointIDs().size());
+		for (int i : exactHull.GetHullPointIDs())
+			hullPointVec.push_back(vertices[i]);
+	}
+
+	if (discardedPointCnt != nullptr)
+		*discardedPointCnt = exactHullPrefilter ? (uint32_t)(vertices.size() - hullPointVec.size()) : 0;
+
+	VMACH::ConvexHull ich(exactHullPrefilter ? hullPointVec : vertices, ichIncludePointLimit, threadPool);
+
+	std::vector<Vector3> ichFaceNormalVec;
+	for (const VMACH::ConvexHullFace& f : ich.GetFaces())
+	{
+		Vector3 normal = (f.Vertices[1] - f.Vertices[0]).Cross(f.Vertices[2] - f.Vertices[0]);
+		normal.Normalize();
+		ichFaceNormalVec.push_back(normal);
+	}
+
+	return ichFaceNormalVec;
+}
+
+std::vector<Fracture::Vector3> Fracture::FractureEngine::GenerateICHNormal(_In_ const Poly::Polyhedron& polyhedron, _In_ const int ichIncludePointLimit) const
+{
+	std::vector<Vector3> vertices(polyhedron.size());
+	for (int i = 0; i < polyhedron.size(); i++)
+		vertices[i] = polyhedron.Position(i);
+
+	return GenerateICHNormal(vertices, ichIncludePointLimit);
+}
+
+std::vector<VMACH::Polygon3D> Fracture::FractureEngine::GenerateVoronoi(_In_ const int cellCount, _In_opt_ dp::thread_pool<>* threadPool,
+																		_Out_opt_ std::vector<Vector3>* cellSiteVec) const
+{
+	std::vector<Vector3> cellPointVec;
+
+	std::mt19937 gen(m_fractureArgs.Seed);
+	std::uniform_real_distribution<double> uniformDist(-0.5, 0.5);
+
+	double x, y, z;
+	for (int i = 0; i < cellCount; i++)
+	{
+		x = uniformDist(gen);
+		y = uniformDist(gen);
+		z = uniformDist(gen);
+		cellPointVec.emplace_back(x, y, z);
+	}
+
+	return GenerateVoronoi(cellPointVec, threadPool, cellSiteVec);
+}
+
+std::vector<VMACH::Polygon3D> Fracture::FractureEngine::GenerateVoronoi(_In_ const std::vector<Vector3>& cellPointVec, _In_opt_ dp::thread_pool<>* threadPool,
+																		_Out_opt_ std::vector<Vector3>* cellSiteVec) const
+{
+	PROFILE_SCOPE("GenerateVoronoi");
+
+	if (cellSiteVec != nullptr)
+		cellSiteVec->clear();
+
+	if (m_fractureArgs.Voronoi == VoronoiMode::DelaunayDual)
+	{
+		// Cells are in the order of the sites in the box.
+		if (cellSiteVec != nullptr)
+		{
+			std::copy_if(cellPointVec.begin(), cellPointVec.end(), std::back_inserter(*cellSiteVec), [](const Vector3& p)
+						 {
+							 return std::abs(p.x) <= 0.5f && std::abs(p.y) <= 0.5f && std::abs(p.z) <= 0.5f;
+						 });
+		}
+
+		return DT3D::VoronoiCells(cellPointVec, Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f));
+	}
+
+	// 1. About 5 cells per block.
+	const int blockCnt = std::max(1, (int)std::round(std::cbrt(cellPointVec.size() / 5.0)));
+
+	// 2. Container is not thread safe, so each task fills its own one,
+	//    and computes the cells at every taskCnt-th position of the loop.
+	const int taskCnt = threadPool == nullptr ? 1 : std::clamp((int)cellPointVec.size() / VoronoiTaskCellCnt, 1, (int)threadPool->size());
+
+	// Cell which failed to compute is left empty.
+	typedef std::pair<Vector3, VMACH::Polygon3D> SiteCell;
+	const auto computeCells = [&cellPointVec, blockCnt, taskCnt](const int task) -> std::vector<SiteCell>
+	{
+		PROFILE_SCOPE_ARG("VoronoiTask", task);
+
+		voro::container voroCon(
+			-0.5, +0.5,
+			-0.5, +0.5,
+			-0.5, +0.5,
+			blockCnt, blockCnt, blockCnt, false, false, false, 8);
+
+		for (int i = 0; i < cellPointVec.size(); i++)
+			voroCon.put(i, cellPointVec[i].x, cellPointVec[i].y, cellPointVec[i].z);
+
+		voro::voronoicell_neighbor voroCell;
+		std::vector<int> cellFaceVec;
+		std::vector<double> cellVertices;
+		std::vector<SiteCell> cellVec;
+
+		double x, y, z;
+		int position = 0;
+
+		voro::c_loop_all cl(voroCon);
+		if (cl.start()) do
+		{
+			if (position++ % taskCnt != task)
+				continue;
+
+			cl.pos(x, y, z);
+
+			VMACH::Polygon3D& voroPoly = cellVec.emplace_back(Vector3(x, y, z), VMACH::Polygon3D(true)).second;
+			if (FALSE == voroCon.compute_cell(voroCell, cl))
+				continue;
+
+			voroCell.face_vertices(cellFaceVec);
+			voroCell.vertices(x, y, z, cellVertices);
+
+			// Face vertices of voro++ are clockwise from outside, read them backward.
+			voroPoly.FaceVec.reserve(voroCell.number_of_faces());
+			for (int cur = 0; cur < cellFaceVec.size(); cur += cellFaceVec[cur] + 1)
+			{
+				const int cnt = cellFaceVec[cur];
+
+				std::vector<Vector3> faceVertices(cnt);
+				for (int i = 0; i < cnt; i++)
+				{
+					const int vertIndex = cellFaceVec[cur + cnt - i];
+					faceVertices[i] = Vector3(cellVertices[3 * vertIndex], cellVertices[3 * vertIndex + 1], cellVertices[3 * vertIndex + 2]);
+				}
+
+				voroPoly.FaceVec.emplace_back(true, std::move(faceVertices));
+			}
+		} while (cl.inc());
+
+		return cellVec;
+	};
+
+	std::vector<std::vector<SiteCell>> taskCellVec;
+	if (taskCnt == 1)
+		taskCellVec.push_back(computeCells(0));
+	else
+		taskCellVec = threadPool->parallel_map(0, taskCnt, [&computeCells](const size_t task) { return computeCells((int)task); }, 1);
+
+	// 3. Back to the loop order.
+	std::vector<VMACH::Polygon3D> voroPolyVec;
+	for (int position = 0; position / taskCnt < taskCellVec[position % taskCnt].size(); position++)
+	{
+		auto& [site, voroPoly] = taskCellVec[position % taskCnt][position / taskCnt];
+		if (voroPoly.FaceVec.empty())
+			continue;
+
+		voroPolyVec.push_back(std::move(voroPoly));
+		if (cellSiteVec != nullptr)
+			cellSiteVec->push_back(site);
+	}
+
+	return voroPolyVec;
+}
+
+std::vector<VMACH::Polygon3D> Fracture::FractureEngine::GenerateFracturePattern(_In_ const int cellCount, _In_ const double mean, _In_opt_ dp::thread_pool<>* threadPool,
+																				_Out_opt_ std::vector<Vector3>* cellSiteVec) const
+{
+	std::vector<Vector3> cellPointVec;
+
+	std::mt19937 gen(m_fractureArgs.Seed);
+	std::uniform_real_distribution<double> directionUniformDist(-1.0, 1.0);
+	std::exponential_distribution<double> lengthExpDist(1.0 / mean);
+
+	for (int i = 0; i < cellCount; i++)
+	{
+		double len = std::max(std::min(lengthExpDist(gen), 0.5), 1e-12);
+
+		double x = directionUniformDist(gen);
+		double y = directionUniformDist(gen);
+		double z = directionUniformDist(gen);
+
+		Vector3 v = Vector3(x, y, z);
+		v.Normalize();
+		v *= len;
+
+		cellPointVec.push_back(v);
+	}
+
+	return GenerateVoronoi(cellPointVec, threadPool, cellSiteVec);
+}
+
+Fracture::CompoundInfo Fracture::FractureEngine::ApplyFracture(_In_ const Compound& compound,
+															   _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
+															   _In_ const std::vector<Vector3>& cellSiteVec,
+															   _In_ const Vector3& patternScale,
+															   _In_ const Vector3& patternCenter,
+															   _In_ const std::vector<Vector3>& spherePointCloud,
+															   _In_ bool partial,
+															   _In_opt_ const CellTask& cellTask) const
+{
+	PROFILE_SCOPE("ApplyFracture");
+
+	std::vector<PieceHandle> decompose;
+	std::vector<std::set<int>> bind;
+
+	std::vector<const Piece*> targetPieceVec(compound.PieceVec.size());
+	std::transform(compound.PieceVec.begin(), compound.PieceVec.end(), targetPieceVec.begin(), [this](const PieceHandle piece) { return m_pieceStore.Get(piece); });
+
+	// Check convex located at outside or not.
+	std::set<int> outside;
+	std::set<int> outsideBind;
+	if (TRUE == partial)
+	{
+		for (int c = 0; c < targetPieceVec.size(); c++)
+		{
+			if (TRUE == ConvexOutOfSphere(targetPieceVec[c], spherePointCloud, m_fractureArgs.ImpactPosition, m_fractureArgs.ImpactRadius))
+			{
+				outside.insert(c);
+
+				outsideBind.insert(decompose.size());
+				decompose.push_back(compound.PieceVec[c]);
+			}
+		}
+	}
+
+	// 0-th element is reserved.
+	bind.push_back(outsideBind);
+
+	// Bounds of pattern cells.
+	std::vector<Vector3> cellMinVec(voroPolyVec.size(), Vector3(FLT_MAX, FLT_MAX, FLT_MAX));
+	std::vector<Vector3> cellMaxVec(voroPolyVec.size(), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+	for (int i = 0; i < voroPolyVec.size(); i++)
+	{
+		for (const VMACH::PolygonFace& face : voroPolyVec[i].FaceVec)
+		{
+			for (const Vector3& v : face.VertexVec)
+			{
+				cellMinVec[i] = Vector3::Min(cellMinVec[i], v);
+				cellMaxVec[i] = Vector3::Max(cellMaxVec[i], v);
+			}
+		}
+	}
+
+	// Pieces to clip per cell. A cell can only cut a piece when their bounds overlap.
+	const BoxGrid cellGrid(cellMinVec, cellMaxVec);
+	std::vector<std::vector<int>> cellPieceVec(voroPolyVec.size());
+	std::vector<int> touchedCellVec;
+	for (int c = 0; c < targetPieceVec.size(); c++)
+	{
+		if (TRUE == outside.contains(c) || targetPieceVec[c]->GetConvex().empty())
+			continue;
+
+		const PolyhedronCache& cache = targetPieceVec[c]->GetConvexCache();
+		cellGrid.Query(cache.MinBB, cache.MaxBB, touchedCellVec);
+
+		for (const int cell : touchedCellVec)
+			cellPieceVec[cell].push_back(c);
+	}
+
+	// Pieces of each cell, bound into one compound below.
+	std::vector<std::vector<PieceHandle>> cellDecomposeVec;
+	if (m_fractureArgs.ConvexFracture == ConvexFractureMode::VoroWall || TRUE == m_fractureArgs.RecursiveSplit)
+	{
+		// Cells per piece, split into tasks of up to VoronoiTaskCellCnt cells.
+		std::vector<std::vector<int>> pieceCellVec(targetPieceVec.size());
+		for (int i = 0; i < voroPolyVec.size(); i++)
+			for (const int c : cellPieceVec[i])
+				pieceCellVec[c].push_back(i);
+
+		// Each task writes its pieces of a cell to its own slot, so the cell keeps the order of the clipping mode.
+		// The last task to finish a cell gathers the slots, so the cell goes on without waiting for the others.
+		std::vector<std::vector<std::vector<PieceHandle>>> cellSlotVec(voroPolyVec.size());
+		std::vector<std::atomic<int>> cellPendingVec(voroPolyVec.size());
+		cellDecomposeVec.resize(voroPolyVec.size());
+
+		// Slots are all taken before any task runs, a cell is not gathered before its last task.
+		struct PieceTaskDesc
+		{
+			int					PieceIndex;
+			std::vector<int>	CellIndexVec;
+			std::vector<int>	SlotVec;
+		};
+
+		std::vector<PieceTaskDesc> taskDescVec;
+		for (int c = 0; c < targetPieceVec.size(); c++)
+		{
+			for (int begin = 0; begin < pieceCellVec[c].size(); begin += VoronoiTaskCellCnt)
+			{
+				const int end = std::min(begin + VoronoiTaskCellCnt, (int)pieceCellVec[c].size());
+
+				PieceTaskDesc& desc = taskDescVec.emplace_back(c, std::vector<int>(pieceCellVec[c].begin() + begin, pieceCellVec[c].begin() + end));
+				for (const int cell : desc.CellIndexVec)
+				{
+					desc.SlotVec.push_back(cellSlotVec[cell].size());
+					cellSlotVec[cell].emplace_back();
+					cellPendingVec[cell]++;
+				}
+			}
+		}
+
+		// A task already holds up to VoronoiTaskCellCnt cells, one per chunk.
+		g_threadPool.parallel_for(0, taskDescVec.size(), [&](const size_t t)
+								  {
+									  const PieceTaskDesc& desc = taskDescVec[t];
+									  PROFILE_SCOPE_ARG("FracturePiece", desc.PieceIndex);
+
+									  std::vector<std::pair<int, PieceHandle>> cellPiecePairVec =
+										  FracturePiece(targetPieceVec[desc.PieceIndex], desc.CellIndexVec, voroPolyVec, cellSiteVec, patternScale, patternCenter);
+
+									  // Pairs are in the order of the cells of the task.
+									  auto pair = cellPiecePairVec.begin();
+									  for (int i = 0; i < desc.CellIndexVec.size(); i++)
+									  {
+										  const int cell = desc.CellIndexVec[i];
+										  for (; pair != cellPiecePairVec.end() && pair->first == cell; ++pair)
+											  cellSlotVec[cell][desc.SlotVec[i]].push_back(pair->second);
+
+										  if (cellPendingVec[cell].fetch_sub(1) != 1)
+											  continue;
+
+										  for (const std::vector<PieceHandle>& slot : cellSlotVec[cell])
+											  cellDecomposeVec[cell].insert(cellDecomposeVec[cell].end(), slot.begin(), slot.end());
+
+										  if (cellTask && FALSE == cellDecomposeVec[cell].empty())
+											  cellTask(cell, cellDecomposeVec[cell]);
+									  }
+								  }, 1);
+	}
+	else
+	{
+		// Cells without any piece are left empty.
+		cellDecomposeVec = g_threadPool.parallel_map(0, voroPolyVec.size(), [&](const size_t i)
+													 {
+														 std::vector<PieceHandle> localDecompose;
+														 if (TRUE == cellPieceVec[i].empty())
+															 return localDecompose;
+
+														 PROFILE_SCOPE_ARG("ClipCell", i);
+
+														 localDecompose = m_fractureTask(voroPolyVec[i], targetPieceVec, cellPieceVec[i]);
+														 if (cellTask && FALSE == localDecompose.empty())
+															 cellTask((int)i, localDecompose);
+
+														 return localDecompose;
+													 });
+	}
+
+	for (const std::vector<PieceHandle>& localDecompose : cellDecomposeVec)
+	{
+		int offset = decompose.size();
+		decompose.insert(decompose.end(), localDecompose.begin(), localDecompose.end());
+		
+		std::set<int> localBind;
+		for (int x = offset; x < offset + localDecompose.size(); x++)
+			localBind.insert(x);
+
+		if (FALSE == localBind.empty())
+			bind.push_back(localBind);
+	}
+
+	return CompoundInfo(decompose, bind);
+}
+
+std::vector<std::pair<int, Fracture::PieceHandle>> Fracture::FractureEngine::FracturePiece(_In_ const Piece* piece,
+																					  _In_ const std::vector<int>& cellIndexVec,
+																					  _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
+																					  _In_ const std::vector<Vector3>& cellSiteVec,
+																					  _In_ const Vector3& patternScale,
+																					  _In_ const Vector3& patternCenter) const
+{
+	// 1. Convex, without the voro++ walls it is only split by the cells with RecursiveSplit.
+	std::vector<Poly::Polyhedron> convexVec = m_fractureArgs.ConvexFracture == ConvexFractureMode::VoroWall ?
+		CutConvexWithVoroWall(piece, cellIndexVec, voroPolyVec, cellSiteVec, patternScale, patternCenter) :
+		Poly::PartitionPolyhedron(piece->GetConvex(), voroPolyVec, cellIndexVec);
+
+	// 2. Mesh is not convex, it is split or clipped by the cell planes.
+	std::vector<Poly::Polyhedron> meshVec;
+	if (TRUE == m_fractureArgs.RecursiveSplit)
+		meshVec = Poly::PartitionPolyhedron(piece->GetMesh(), voroPolyVec, cellIndexVec);
+
+	std::vector<std::pair<int, PieceHandle>> localDecompose;
+	std::vector<PieceHandle> pieceVec;
+	for (int k = 0; k < cellIndexVec.size(); k++)
+	{
+		if (convexVec[k].empty())
+			continue;
+
+		Poly::Polyhedron mesh = TRUE == m_fractureArgs.RecursiveSplit ? std::move(meshVec[k]) : Poly::ClipPolyhedron(piece->GetMesh(), voroPolyVec[cellIndexVec[k]]);
+		if (mesh.empty())
+			continue;
+
+		pieceVec.clear();
+		AppendPiece(std::move(convexVec[k]), std::move(mesh), pieceVec);
+
+		for (const PieceHandle newPiece : pieceVec)
+			localDecompose.emplace_back(cellIndexVec[k], newPiece);
+	}
+
+	return localDecompose;
+}
+
+std::vector<Poly::Polyhedron> Fracture::FractureEngine::CutConvexWithVoroWall(_In_ const Piece* piece,
+																			 _In_ const std::vector<int>& cellIndexVec,
+																			 _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
+																			 _In_ const std::vector<Vector3>& cellSiteVec,
+																			 _In_ const Vector3& patternScale,
+																			 _In_ const Vector3& patternCenter) const
+{
+	const Poly::Polyhedron& pieceConvex = piece->GetConvex();
+	const PolyhedronCache& cache = piece->GetConvexCache();
+
+	// 1. Convex planes in the unit box of the pattern, where the sites are.
+	//    Newell normal of each face, offset to the farthest vertex. Small faces left by clipping have a noisy normal,
+	//    but a supporting plane never cuts into the convex.
+	//    World position is s * u + t, so n.p < a becomes (n * s).u < a - n.t. voro++ keeps the side of xc * x + yc * y + zc * z < ac.
+	std::vector<voro::wall_plane> wallVec;
+	wallVec.reserve(cache.Faces.size());
+	for (const auto f : cache.Faces)
+	{
+		double nx = 0.0, ny = 0.0, nz = 0.0;
+		for (int i = 0; i < f.size(); i++)
+		{
+			const Vector3 a = pieceConvex.Position(f[i]);
+			const Vector3 b = pieceConvex.Position(f[(i + 1) % f.size()]);
+			nx += ((double)a.y - b.y) * ((double)a.z + b.z);
+			ny += ((double)a.z - b.z) * ((double)a.x + b.x);
+			nz += ((double)a.x - b.x) * ((double)a.y + b.y);
+		}
+
+		const double ux = nx * patternScale.x, uy = ny * patternScale.y, uz = nz * patternScale.z;
+		const double length = std::sqrt(ux * ux + uy * uy + uz * uz);
+		if (length < EPSILON)
+			continue;
+
+		double maxDist = -DBL_MAX;
+		for (int v = 0; v < pieceConvex.size(); v++)
+			maxDist = std::max(maxDist, nx * pieceConvex.X[v] + ny * pieceConvex.Y[v] + nz * pieceConvex.Z[v]);
+
+		const double offset = maxDist - (nx * patternCenter.x + ny * patternCenter.y + nz * patternCenter.z);
+		wallVec.emplace_back(ux / length, uy / length, uz / length, offset / length);
+	}
+
+	// 2. voro++ only bounds the cells of the sites inside the walls.
+	//    Cells whose site lies out of the convex are clipped as in the clipping mode.
+	std::vector<Poly::Polyhedron> convexVec(cellIndexVec.size());
+	std::vector<int> wallCellVec;
+	for (int k = 0; k < cellIndexVec.size(); k++)
+	{
+		const Vector3& site = cellSiteVec[cellIndexVec[k]];
+		const bool inside = std::all_of(wallVec.begin(), wallVec.end(), [&site](voro::wall_plane& wall) { return wall.point_inside(site.x, site.y, site.z); });
+
+		if (TRUE == inside)
+			wallCellVec.push_back(k);
+		else
+			convexVec[k] = Poly::ClipPolyhedron(pieceConvex, voroPolyVec[cellIndexVec[k]]);
+	}
+
+	if (FALSE == wallCellVec.empty())
+	{
+		// 3. Every site is put, the neighbors out of the piece still bound the cells.
+		const int blockCnt = std::max(1, (int)std::round(std::cbrt(cellSiteVec.size() / 5.0)));
+
+		voro::container voroCon(
+			-0.5, +0.5,
+			-0.5, +0.5,
+			-0.5, +0.5,
+			blockCnt, blockCnt, blockCnt, false, false, false, 8);
+
+		for (int i = 0; i < cellSiteVec.size(); i++)
+			voroCon.put(i, cellSiteVec[i].x, cellSiteVec[i].y, cellSiteVec[i].z);
+
+		for (voro::wall_plane& wall : wallVec)
+			voroCon.add_wall(wall);
+
+		// Slot of each site in cellIndexVec, -1 if it is not computed.
+		std::vector<int> slotVec(cellSiteVec.size(), -1);
+		for (const int k : wallCellVec)
+			slotVec[cellIndexVec[k]] = k;
+
+		// 4. Only the given cells are computed, each one is already restricted to the convex.
+		//    A cell voro++ fails on, or whose faces do not close, is clipped instead.
+		voro::voronoicell voroCell;
+		std::vector<int> cellFaceVec;
+		std::vector<double> cellVertices;
+		std::vector<Vector3> positionVec;
+		std::vector<int> face;
+		Extract faces;
+
+		double x, y, z;
+
+		voro::c_loop_all cl(voroCon);
+		if (cl.start()) do
+		{
+			if (slotVec[cl.pid()] == -1)
+				continue;
+
+			Poly::Polyhedron& convex = convexVec[slotVec[cl.pid()]];
+			if (FALSE == voroCon.compute_cell(voroCell, cl))
+			{
+				convex = Poly::ClipPolyhedron(pieceConvex, voroPolyVec[cl.pid()]);
+				continue;
+			}
+
+			cl.pos(x, y, z);
+			voroCell.face_vertices(cellFaceVec);
+			voroCell.vertices(x, y, z, cellVertices);
+
+			positionVec.resize(cellVertices.size() / 3);
+			for (int i = 0; i < positionVec.size(); i++)
+				positionVec[i] = Vector3(cellVertices[3 * i], cellVertices[3 * i + 1], cellVertices[3 * i + 2]) * patternScale + patternCenter;
+
+			// Face vertices of voro++ are clockwise from outside, read them backward.
+			faces = Extract();
+			for (int cur = 0; cur < cellFaceVec.size(); cur += cellFaceVec[cur] + 1)
+			{
+				const int cnt = cellFaceVec[cur];
+
+				face.resize(cnt);
+				for (int i = 0; i < cnt; i++)
+					face[i] = cellFaceVec[cur + cnt - i];
+
+				faces.AddFace(face);
+			}
+
+			if (FALSE == Poly::InitPolyhedron(convex, positionVec, faces))
+				convex = Poly::ClipPolyhedron(pieceConvex, voroPolyVec[cl.pid()]);
+		} while (cl.inc());
+	}
+
+	return convexVec;
+}
+
+void Fracture::FractureEngine::AppendPiece(_In_ Poly::Polyhedron&& convex, _In_ Poly::Polyhedron&& mesh, _Inout_ std::vector<PieceHandle>& pieceVec) const
+{
+	const auto groupVec = CheckMeshIsland(mesh);
+	if (groupVec.size() < 2)
+	{
+		pieceVec.push_back(m_pieceStore.Create(std::move(convex), std::move(mesh)));
+		return;
+	}
+
+	for (const auto& group : groupVec)
+	{
+		Poly::Polyhedron island;
+		std::unordered_map<int, int> mapping;
+
+		for (const int iVert : group)
+		{
+			int oldIndex = island.size();
+			mapping[iVert] = oldIndex;
+
+			island.AddVertex(mesh.Position(iVert), mesh.Neighbors(iVert));
+		}
+
+		for (int& iAdj : island.NeighborIndex)
+			iAdj = mapping[iAdj];
+
+		pieceVec.push_back(m_pieceStore.Create(convex, std::move(island)));
+	}
+}
+
+void Fracture::FractureEngine::_MeshIslandLoop(const int index, const Poly::Polyhedron& mesh, std::set<int>& group) const
+{
+	std::vector<int> search;
+	for (const int iAdj : mesh.Neighbors(index))
+	{
+		const auto res = group.insert(iAdj);
+		if (TRUE == res.second)
+			search.push_back(iAdj);
+	}
+
+	for (const int iSearch : search)
+		_MeshIslandLoop(iSearch, mesh, group);
+}
+
+std::vector<std::set<int>> Fracture::FractureEngine::CheckMeshIsland(_In_ const Poly::Polyhedron& polyhedron) const
+{
+	std::vector<std::set<int>> groupVec;
+	std::set<int> exclude;
+
+	int iArbitPoint = 0;
+	while (TRUE)
+	{
+		std::set<int> group;
+		_MeshIslandLoop(iArbitPoint, polyhedron, group);
+
+		groupVec.push_back(group);
+		exclude.insert(group.begin(), group.end());
+
+		bool remain = false;
+		for (int v = 0; v < polyhedron.size(); v++)
+		{
+			if (FALSE == exclude.contains(v))
+			{
+				remain = true;
+				iArbitPoint = v;
+				break;
+			}
+		}
+
+		if (FALSE == remain)
+			break;
+	}
+
+	return groupVec;
+}
+
+std::vector<std::set<int>> Fracture::FractureEngine::HandleConvexIsland(_In_ const std::vector<PieceHandle>& pieceVec, _Inout_ std::set<int>& localBind) const
+{
+	PROFILE_SCOPE("HandleConvexIsland");
+
+	// FaceNode struct is only needed for this function.
+	struct FaceNode
+	{
+		int						CID;
+		double					AbsD;
+		Plane					FacePlane;
+		std::vector<Vector3>	FacePoints;
+	};
+
+	std::vector<std::set<int>> newBind;
+
+	if (localBind.size() <= 1)
+		return newBind;
+
+	std::vector<FaceNode> nodes;
+	for (const int cid : localBind)
+	{
+		const Piece* piece = m_pieceStore.Get(pieceVec[cid]);
+		const Poly::Polyhedron& convex = piece->GetConvex();
+		const PolyhedronCache& cache = piece->GetConvexCache();
+		for (int f = 0; f < cache.Faces.size(); f++)
+		{
+			const auto poly = cache.Faces[f];
+
+			std::vector<Vector3> points(poly.size());
+			std::transform(poly.begin(), poly.end(), points.begin(), [&](const int v) { return convex.Position(v); });
+
+			const Plane& p = cache.FacePlanes[f];
+			nodes.push_back(FaceNode(cid, std::abs(p.D()), p, points));
+		}
+	}
+
+	std::sort(nodes.begin(), nodes.end(), [](const FaceNode& a, const FaceNode& b) { return a.AbsD < b.AbsD; });
+
+	std::unordered_map<int, std::set<int>> nei;
+	for (const int cid : localBind)
+		nei[cid] = std::set<int>();
+
+	for (int i = 0; i < nodes.size() - 1; i++)
+	{
+		bool lowerBoundFound = false;
+		for (int j = i + 1; j < nodes.size(); j++)
+		{
+			if (TRUE == lowerBoundFound && (nodes[i].AbsD > nodes[j].AbsD))
+				break;
+
+			// Approximatly check planes are equal or not.
+			if (std::abs(nodes[i].AbsD - nodes[j].AbsD) > 1e-3)
+				continue;
+
+			lowerBoundFound = true;
+
+			Vector3 in = nodes[i].FacePlane.Normal();
+			Vector3 jn = nodes[j].FacePlane.Normal();
+			in.Normalize(); jn.Normalize();
+
+			// Normals should be opposite.
+			bool oppositeNormal = std::abs(1 + in.Dot(jn)) < 1e-4;
+			if (FALSE == oppositeNormal)
+				continue;
+
+			// Check two faces are intersect or not.
+			bool atLeastOnePointIncluded = false;
+
+			// First, check vertex of i node is contained by j node.
+			int nJPoint = nodes[j].FacePoints.size();
+			for (const Vector3& iPoint : nodes[i].FacePoints)
+			{
+				bool pointIncluded = true;
+				for (int v = 0; v < nJPoint; v++)
+				{
+					const Vector3& a = nodes[j].FacePoints[v];
+					const Vector3& b = nodes[j].FacePoints[(v + 1) % nJPoint];
+
+					if (FALSE == VMACH::OnYourRight(a, b, iPoint, jn))
+					{
+						pointIncluded = false;
+						break;
+					}
+				}
+
+				if (TRUE == pointIncluded)
+				{
+					atLeastOnePointIncluded = true;
+					break;
+				}
+			}
+
+			// Give me one more chance.
+			if (FALSE == atLeastOnePointIncluded)
+			{
+				// If no point included, check vertex of j node is contained by i node.
+				int nIPoint = nodes[i].FacePoints.size();
+				for (const Vector3& jPoint : nodes[j].FacePoints)
+				{
+					bool pointIncluded = true;
+					for (int v = 0; v < nIPoint; v++)
+					{
+						const Vector3& a = nodes[i].FacePoints[v];
+						const Vector3& b = nodes[i].FacePoints[(v + 1) % nIPoint];
+
+						if (FALSE == VMACH::OnYourRight(a, b, jPoint, in))
+						{
+							pointIncluded = false;
+							break;
+						}
+					}
+
+					if (TRUE == pointIncluded)
+					{
+						atLeastOnePointIncluded = true;
+						break;
+					}
+				}
+			}
+
+			// If all condition met, they are neighbors.
+			if (TRUE == atLeastOnePointIncluded)
+			{
+				nei[nodes[i].CID].insert(nodes[j].CID);
+				nei[nodes[j].CID].insert(nodes[i].CID);
+			}
+		}
+	}
+
+	// Flood fill.
+	std::set<int> remain;
+	remain.insert(localBind.begin(), localBind.end());
+
+	std::vector<std::set<int>> splitGroup;
+
+	while (remain.size() != 0)
+	{
+		std::set<int> split;
+
+		std::queue<int> fillQueue;
+		fillQueue.push(*remain.begin());
+
+		while (FALSE == fillQueue.empty())
+		{
+			int curr = fillQueue.front();
+			fillQueue.pop();
+
+			if (TRUE == remain.contains(curr))
+			{
+				split.insert(curr);
+				remain.erase(curr);
+
+				for (const int iAdj : nei[curr])
+					fillQueue.push(iAdj);
+			}
+		}
+
+		splitGroup.push_back(split);
+	}
+
+	if (splitGroup.size() >= 2)
+	{
+		localBind = splitGroup[0];
+		newBind.insert(newBind.end(), std::next(splitGroup.begin()), splitGroup.end());
+	}
+
+	return newBind;
+}
+
+std::set<int> Fracture::FractureEngine::MergeOutOfImpact(_In_ const std::vector<PieceHandle>& pieceVec, _Inout_ std::set<int>& localBind,
+														 _In_ const std::vector<Vector3>& spherePointCloud) const
+{
+	std::set<int> outside;
+	for (const int c : localBind)
+	{
+		if (TRUE == ConvexOutOfSphere(m_pieceStore.Get(pieceVec[c]), spherePointCloud, m_fractureArgs.ImpactPosition, m_fractureArgs.ImpactRadius))
+			outside.insert(c);
+	}
+
+	if (FALSE == outside.empty())
+	{
+		std::set<int> tempLocal;
+		std::set_difference(localBind.begin(), localBind.end(), outside.begin(), outside.end(), std::inserter(tempLocal, tempLocal.end()));
+		localBind.swap(tempLocal);
+	}
+
+	return outside;
+}
+
+void Fracture::FractureEngine::Refitting(_In_ const std::vector<PieceHandle>& targetPieceVec, _In_opt_ const PieceTask& pieceTask) const
+{
+	PROFILE_SCOPE("Refitting");
+
+	g_threadPool.parallel_for(0, targetPieceVec.size(), [&](const size_t i)
+							  {
+								  Piece* piece = m_pieceStore.Get(targetPieceVec[i]);
+								  m_refittingTask(piece);
+								  if (pieceTask)
+									  pieceTask(piece);
+							  });
+}
+
+bool Fracture::FractureEngine::ConvexOutOfSphere(_In_ const Piece* piece,
+												 _In_ const std::vector<Vector3>& spherePointCloud,
+												 _In_ const Vector3 origin,
+												 _In_ const float radius) const
+{
+	const Poly::Polyhedron& polyhedron = piece->GetConvex();
+	const PolyhedronCache& cache = piece->GetConvexCache();
+
+	// Approximate.
+	// Skip the vertex loop when the bounding sphere is out of reach.
+	bool noVertexInsideSphere = true;
+	if ((origin - cache.SphereCenter).Length() - cache.SphereRadius < radius)
+	{
+		for (int v = 0; v < polyhedron.size(); v++)
+		{
+			if ((origin - polyhedron.Position(v)).Length() < radius)
+			{
+				noVertexInsideSphere = false;
+				break;
+			}
+		}
+	}
+
+	if (FALSE == noVertexInsideSphere)
+		return false;
+
+	for (const auto& po : spherePointCloud)
+	{
+		// Point outside of the bounding box can not be contained.
+		if (po.x < cache.MinBB.x || po.y < cache.MinBB.y || po.z < cache.MinBB.z ||
+			po.x > cache.MaxBB.x || po.y > cache.MaxBB.y || po.z > cache.MaxBB.z)
+			continue;
+
+		bool contain = true;
+		for (const Plane& plane : cache.FacePlanes)
+		{
+			float dist = plane.Normal().Dot(po) + plane.D();
+			if (dist > 0)
+			{
+				contain = false;
+				break;
+			}
+		}
+
+		if (TRUE == contain)
+			return false;
+	}
+
+	return true;
+}
@@ -4,38 +4,48 @@
 #include "VMACH.h"
 #include "Poly.h"
 
+// Projection kernel uses 4 lanes with SSE, scalar otherwise.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define KDOP_USE_SSE
+	#include <immintrin.h>
+#endif
+
 using DirectX::SimpleMath::Vector3;
 using DirectX::SimpleMath::Plane;
 
-Kdop::KdopContainer::KdopContainer(const std::vector<Vector3>& normalVec)
+Kdop::KdopContainer::KdopContainer(const std::vector<Vector3>& normalVec, const float angularTolerance)
 {
-	std::transform(normalVec.begin(), normalVec.end(), std::back_inserter(ElementVec), [](const Vector3& normal) { return KdopElement(normal); });
-}
+	// Opposite normals make the same slab, so only the absolute cosine counts.
+	const float minAbsDot = std::cos(angularTolerance);
 
-void Kdop::KdopContainer::Calc(const std::vector<Vector3>& vertices, const double& maxAxisScale, const float& planeGapInv)
-{
-	for (const Vector3& vert : vertices)
+	for (const Vector3& normal : normalVec)
 	{
-		for (KdopElement& kdopElement : ElementVec)
+		const bool merged =
+			ElementVec.end() != std::find_if(ElementVec.begin(), ElementVec.end(),
+											 [&](const KdopElement& e) { return std::abs(e.Normal.Dot(normal)) >= minAbsDot; });
+
+		if (TRUE == merged)
 		{
-			float t = vert.Dot(kdopElement.Normal);
+			MergedNormalCnt++;
+			continue;
+		}
 
-			if (kdopElement.MinDist > t)
-			{
-				kdopElement.MinDist = t;
-				kdopElement.MinPlane = Plane(vert, -kdopElement.Normal);
-				kdopElement.MinVertex = vert;
-			}
+		ElementVec.push_back(KdopElement(normal));
+	}
+}
 
-			if (kdopElement.MaxDist < t)
-			{
-				kdopElement.MaxDist = t;
-				kdopElement.MaxPlane = Plane(vert, kdopElement.Normal);
-				kdopElement.MaxVertex = vert;
-			}
-		}
+void Kdop::KdopContainer::Calc(const std::vector<Vector3>& vertices, const double& maxAxisScale, const float& planeGapInv, dp::thread_pool<>* threadPool)
+{
+	std::vector<float> X(vertices.size()), Y(vertices.size()), Z(vertices.size());
+	for (int i = 0; i < vertices.size(); i++)
+	{
+		X[i] = vertices[i].x;
+		Y[i] = vertices[i].y;
+		Z[i] = vertices[i].z;
 	}
 
+	CalcExtent(ElementVec, X.data(), Y.data(), Z.data(), (int)vertices.size(), threadPool);
+
 	for (KdopElement& kdopElement : ElementVec)
 	{
 		Vector3 minPlaneNormal = kdopElement.MinPlane.Normal();
@@ -52,31 +62,19 @@ void Kdop::KdopContainer::Calc(const std::vector<Vector3>& vertices, const doubl
 
 void Kdop::KdopContainer::Calc(const VMACH::Polygon3D& mesh)
 {
+	std::vector<float> X, Y, Z;
 	for (const VMACH::PolygonFace& face : mesh.FaceVec)
 	{
 		for (const Vector3& vert : face.VertexVec)
 		{
-			for (KdopElement& kdopElement : ElementVec)
-			{
-				float t = vert.Dot(kdopElement.Normal);
-
-				if (kdopElement.MinDist > t)
-				{
-					kdopElement.MinDist = t;
-					kdopElement.MinPlane = Plane(vert, -kdopElement.Normal);
-					kdopElement.MinVertex = vert;
-				}
-
-				if (kdopElement.MaxDist < t)
-				{
-					kdopElement.MaxDist = t;
-					kdopElement.MaxPlane = Plane(vert, kdopElement.Normal);
-					kdopElement.MaxVertex = vert;
-				}
-			}
+			X.push_back(vert.x);
+			Y.push_back(vert.y);
+			Z.push_back(vert.z);
 		}
 	}
 
+	CalcExtent(ElementVec, X.data(), Y.data(), Z.data(), (int)X.size(), nullptr);
+
 	for (KdopElement& kdopElement : ElementVec)
 	{
 		Vector3 minPlaneNormal = kdopElement.MinPlane.Normal();
@@ -91,86 +89,187 @@ void Kdop::KdopContainer::Calc(const VMACH::Polygon3D& mesh)
 
 void Kdop::KdopContainer::Calc(const Poly::Polyhedron& mesh)
 {
-	for (const Poly::Vertex& vert : mesh)
+	CalcExtent(ElementVec, mesh.X.data(), mesh.Y.data(), mesh.Z.data(), (int)mesh.size(), nullptr);
+}
+
+void Kdop::KdopContainer::ProjectChunk(const std::vector<KdopElement>& elementVec, const float* px, const float* py, const float* pz,
+									   const int begin, const int end, Extent* extentVec)
+{
+	// Ties keep the first vertex, same as testing vertex by vertex.
+	// Dot product is summed as (x + y) + z, same as Vector3::Dot.
+	for (int e = 0; e < elementVec.size(); e++)
 	{
-		for (KdopElement& kdopElement : ElementVec)
+		const Vector3& n = elementVec[e].Normal;
+		Extent&        extent = extentVec[e];
+		int            i = begin;
+
+#ifdef KDOP_USE_SSE
+		if (end - begin >= 4)
 		{
-			float t = vert.Position.Dot(kdopElement.Normal);
+			const __m128  vnx = _mm_set1_ps(n.x), vny = _mm_set1_ps(n.y), vnz = _mm_set1_ps(n.z);
+			const __m128i four = _mm_set1_epi32(4);
+			__m128        laneMin = _mm_set1_ps(INFINITY), laneMax = _mm_set1_ps(-INFINITY);
+			__m128i       laneMinIndex = _mm_set1_epi32(-1), laneMaxIndex = _mm_set1_epi32(-1);
+			__m128i       index = _mm_setr_epi32(begin, begin + 1, begin + 2, begin + 3);
+			for (; i + 4 <= end; i += 4)
+			{
+				const __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vnx, _mm_loadu_ps(px + i)), _mm_mul_ps(vny, _mm_loadu_ps(py + i))),
+											_mm_mul_ps(vnz, _mm_loadu_ps(pz + i)));
+
+				const __m128 less = _mm_cmplt_ps(t, laneMin);
+				laneMin = _mm_or_ps(_mm_and_ps(less, t), _mm_andnot_ps(less, laneMin));
+				laneMinIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(less), index), _mm_andnot_si128(_mm_castps_si128(less), laneMinIndex));
 
-			if (kdopElement.MinDist > t)
+				const __m128 greater = _mm_cmpgt_ps(t, laneMax);
+				laneMax = _mm_or_ps(_mm_and_ps(greater, t), _mm_andnot_ps(greater, laneMax));
+				laneMaxIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(greater), index), _mm_andnot_si128(_mm_castps_si128(greater), laneMaxIndex));
+
+				index = _mm_add_epi32(index, four);
+			}
+
+			float mins[4], maxs[4];
+			int   minIndices[4], maxIndices[4];
+			_mm_storeu_ps(mins, laneMin);
+			_mm_storeu_ps(maxs, laneMax);
+			_mm_storeu_si128((__m128i*)minIndices, laneMinIndex);
+			_mm_storeu_si128((__m128i*)maxIndices, laneMaxIndex);
+
+			// Lanes hold different vertices, ties go to the lower index.
+			for (int l = 0; l < 4; l++)
+			{
+				if (minIndices[l] != -1 && (extent.MinIndex == -1 || mins[l] < extent.MinDist || (mins[l] == extent.MinDist && minIndices[l] < extent.MinIndex)))
+				{
+					extent.MinDist = mins[l];
+					extent.MinIndex = minIndices[l];
+				}
+
+				if (maxIndices[l] != -1 && (extent.MaxIndex == -1 || maxs[l] > extent.MaxDist || (maxs[l] == extent.MaxDist && maxIndices[l] < extent.MaxIndex)))
+				{
+					extent.MaxDist = maxs[l];
+					extent.MaxIndex = maxIndices[l];
+				}
+			}
+		}
+#endif
+
+		for (; i < end; i++)
+		{
+			const float t = (n.x * px[i] + n.y * py[i]) + n.z * pz[i];
+
+			if (t < extent.MinDist)
 			{
-				kdopElement.MinDist = t;
-				kdopElement.MinPlane = Plane(vert.Position, -kdopElement.Normal);
-				kdopElement.MinVertex = vert.Position;
+				extent.MinDist = t;
+				extent.MinIndex = i;
 			}
 
-			if (kdopElement.MaxDist < t)
+			if (t > extent.MaxDist)
 			{
-				kdopElement.MaxDist = t;
-				kdopElement.MaxPlane = Plane(vert.Position, kdopElement.Normal);
-				kdopElement.MaxVertex = vert.Position;
+				extent.MaxDist = t;
+				extent.MaxIndex = i;
 			}
 		}
 	}
 }
 
-VMACH::Polygon3D Kdop::KdopContainer::ClipWithPolygon(const VMACH::Polygon3D& polygon, int doTest) const
+void Kdop::KdopContainer::CalcExtent(std::vector<KdopElement>& elementVec, const float* px, const float* py, const float* pz,
+									 const int count, dp::thread_pool<>* threadPool)
 {
-	VMACH::Polygon3D outPolygon = polygon;
+	// 1. Extents per chunk of vertices. Large meshes are split over the thread pool.
+	const int chunkCnt = (count + ChunkVertexCnt - 1) / ChunkVertexCnt;
+	const int elementCnt = (int)elementVec.size();
 
-	for (int i = 0; i < ElementVec.size(); i++)
+	std::vector<Extent> extentVec(chunkCnt * elementCnt);
+
+	auto projectChunk = [&](int c)
 	{
-		Vector3 n = ElementVec[i].MinPlane.Normal();
-		n.Normalize();
+		ProjectChunk(elementVec, px, py, pz, c * ChunkVertexCnt, std::min(count, (c + 1) * ChunkVertexCnt), extentVec.data() + c * elementCnt);
+	};
 
-		bool exist =
-			polygon.FaceVec.end() != std::find_if(
-				polygon.FaceVec.begin(),
-				polygon.FaceVec.end(),
-				[&](const VMACH::PolygonFace& f)
-				{
-					Vector3 fn = f.GetNormal();
-					return (1 - fn.Dot(n)) < 1e-4 && std::abs(f.FacePlane.w - ElementVec[i].MinPlane.w) < 1e-4;
-				});
+	if (threadPool != nullptr && chunkCnt > 1)
+	{
+		threadPool->parallel_for(0, chunkCnt, [&](const size_t c) { projectChunk((int)c); }, 1);
+	}
+	else
+	{
+		for (int c = 0; c < chunkCnt; c++)
+			projectChunk(c);
+	}
 
-		if (TRUE == exist)
-			continue;
+	// 2. Merge in chunk order, as if the vertices were tested one by one after the previous Calc.
+	//    Planes are built once per element, at the extreme vertex.
+	for (int e = 0; e < elementCnt; e++)
+	{
+		KdopElement& kdopElement = elementVec[e];
+		int          minIndex = -1;
+		int          maxIndex = -1;
+
+		for (int c = 0; c < chunkCnt; c++)
+		{
+			const Extent& extent = extentVec[c * elementCnt + e];
+
+			if (extent.MinIndex != -1 && kdopElement.MinDist > extent.MinDist)
+			{
+				kdopElement.MinDist = extent.MinDist;
+				minIndex = extent.MinIndex;
+			}
 
-		outPolygon = VMACH::Polygon3D::ClipWithPlane(outPolygon, ElementVec[i].MinPlane, (doTest == 1 && i == 5) ? 1 : -1);
+			if (extent.MaxIndex != -1 && kdopElement.MaxDist < extent.MaxDist)
+			{
+				kdopElement.MaxDist = extent.MaxDist;
+				maxIndex = extent.MaxIndex;
+			}
+		}
+
+		if (minIndex != -1)
+		{
+			kdopElement.MinVertex = Vector3(px[minIndex], py[minIndex], pz[minIndex]);
+			kdopElement.MinPlane = Plane(kdopElement.MinVertex, -kdopElement.Normal);
+		}
+
+		if (maxIndex != -1)
+		{
+			kdopElement.MaxVertex = Vector3(px[maxIndex], py[maxIndex], pz[maxIndex]);
+			kdopElement.MaxPlane = Plane(kdopElement.MaxVertex, kdopElement.Normal);
+		}
 	}
+}
+
+VMACH::Polygon3D Kdop::KdopContainer::ClipWithPolygon(const VMACH::Polygon3D& polygon, int doTest, VMACH::ClipDebugSink* debugSink) const
+{
+	VMACH::ClipContext context;
+	context.DebugSink = debugSink;
+
+	VMACH::Polygon3D outPolygon = polygon;
+
+	// Planes already on the polygon faces, or clipped once, are skipped.
+	PlaneKeySet planeKeySet;
+	for (const VMACH::PolygonFace& face : polygon.FaceVec)
+		planeKeySet.insert(QuantizePlane(face.FacePlane));
 
 	for (int i = 0; i < ElementVec.size(); i++)
 	{
-		Vector3 n = ElementVec[i].MaxPlane.Normal();
-		n.Normalize();
+		if (FALSE == planeKeySet.insert(QuantizePlane(ElementVec[i].MinPlane)).second)
+			continue;
 
-		bool exist =
-			polygon.FaceVec.end() != std::find_if(
-				polygon.FaceVec.begin(),
-				polygon.FaceVec.end(),
-				[&](const VMACH::PolygonFace& f)
-				{
-					Vector3 fn = f.GetNormal();
-					return (1 - fn.Dot(n)) < 1e-4 && std::abs(f.FacePlane.w - ElementVec[i].MaxPlane.w) < 1e-4;
-				});
+		outPolygon = VMACH::Polygon3D::ClipWithPlane(outPolygon, ElementVec[i].MinPlane, context, (doTest == 1 && i == 5) ? 1 : -1);
+	}
 
-		if (TRUE == exist)
+	for (int i = 0; i < ElementVec.size(); i++)
+	{
+		if (FALSE == planeKeySet.insert(QuantizePlane(ElementVec[i].MaxPlane)).second)
 			continue;
 
-		outPolygon = VMACH::Polygon3D::ClipWithPlane(outPolygon, ElementVec[i].MaxPlane);
+		outPolygon = VMACH::Polygon3D::ClipWithPlane(outPolygon, ElementVec[i].MaxPlane, context);
 	}
 
 	return outPolygon;
 }
 
-Poly::Polyhedron Kdop::KdopContainer::ClipWithPolyhedron(const Poly::Polyhedron& polyhedron)
+Poly::Polyhedron Kdop::KdopContainer::ClipWithPolyhedron(const Poly::Polyhedron& polyhedron, int* eliminatedPlaneCnt) const
 {
-	std::vector<Plane> planes;
-	for (int x = 0; x < ElementVec.size(); x++)
-	{
-		planes.push_back(ElementVec[x].MinPlane);
-		planes.push_back(ElementVec[x].MaxPlane);
-	}
+	const std::vector<Plane> planes = CollectPlanes();
+	if (eliminatedPlaneCnt != nullptr)
+		*eliminatedPlaneCnt = MergedNormalCnt * 2 + (int)(ElementVec.size() * 2 - planes.size());
 
 	Poly::Polyhedron res = polyhedron;
 	Poly::ClipPolyhedron(res, planes);
@@ -178,6 +277,41 @@ Poly::Polyhedron Kdop::KdopContainer::ClipWithPolyhedron(const Poly::Polyhedron&
 	return res;
 }
 
+std::vector<Plane> Kdop::KdopContainer::CollectPlanes() const
+{
+	std::vector<Plane> planes;
+	planes.reserve(ElementVec.size() * 2);
+
+	PlaneKeySet planeKeySet;
+	planeKeySet.reserve(ElementVec.size() * 2);
+
+	for (const KdopElement& kdopElement : ElementVec)
+	{
+		if (TRUE == planeKeySet.insert(QuantizePlane(kdopElement.MinPlane)).second)
+			planes.push_back(kdopElement.MinPlane);
+
+		if (TRUE == planeKeySet.insert(QuantizePlane(kdopElement.MaxPlane)).second)
+			planes.push_back(kdopElement.MaxPlane);
+	}
+
+	return planes;
+}
+
+Kdop::KdopContainer::PlaneKey Kdop::KdopContainer::QuantizePlane(const Plane& plane)
+{
+	const float scale = 1.0f / (plane.Normal().Length() * PlaneQuantum);
+
+	return { std::llround(plane.x * scale), std::llround(plane.y * scale), std::llround(plane.z * scale), std::llround(plane.w * scale) };
+}
+
+size_t Kdop::KdopContainer::PlaneKeyHash::operator()(const PlaneKey& key) const
+{
+	size_t seed = std::hash<int64_t>()(key.X);
+	seed = CombineHash(seed, std::hash<int64_t>()(key.Y));
+	seed = CombineHash(seed, std::hash<int64_t>()(key.Z));
+	return CombineHash(seed, std::hash<int64_t>()(key.W));
+}
+
 void Kdop::KdopContainer::Render(std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData)
 {
 	const auto collectPolygonFaces = [&](Plane p, Vector3 x)
@@ -220,4 +354,100 @@ void Kdop::KdopContainer::Render(std::vector<VertexNormalColor>& vertexData, std
 		f1.Render(vertexData, indexData);
 		f2.Render(vertexData, indexData);
 	}
-}
\ No newline at end of file
+}
+
+// Axes of FixedKdop, not normalized. 3 face axes, 4 corner axes and 6 edge axes.
+static constexpr int c_fixedKdopAxis[13][3] =
+{
+	{ 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 },
+	{ 1, 1, 1 }, { 1, -1, 1 }, { 1, 1, -1 }, { 1, -1, -1 },
+	{ 1, 1, 0 }, { 1, -1, 0 }, { 1, 0, 1 }, { 1, 0, -1 }, { 0, 1, 1 }, { 0, 1, -1 },
+};
+
+// Inverse axis length, by the count of non-zero components.
+static constexpr float c_fixedKdopInvLength[4] = { 0.0f, 1.0f, 0.70710678f, 0.57735027f };
+
+// Axes of c_fixedKdopAxis used by each FixedKdop.
+template <int K> static constexpr std::array<int, K / 2> c_fixedKdopAxisIndex = {};
+template <> constexpr std::array<int, 3> c_fixedKdopAxisIndex<6> = { 0, 1, 2 };
+template <> constexpr std::array<int, 7> c_fixedKdopAxisIndex<14> = { 0, 1, 2, 3, 4, 5, 6 };
+template <> constexpr std::array<int, 9> c_fixedKdopAxisIndex<18> = { 0, 1, 2, 7, 8, 9, 10, 11, 12 };
+template <> constexpr std::array<int, 13> c_fixedKdopAxisIndex<26> = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+
+// Projection onto the axis, only additions and subtractions.
+// Starts from -0, which is the identity of the addition and is folded away.
+template <int I>
+static float ProjectFixedAxis(const float x, const float y, const float z)
+{
+	constexpr const int* axis = c_fixedKdopAxis[I];
+
+	float dist = -0.0f;
+	if constexpr (axis[0] > 0)		dist += x;
+	else if constexpr (axis[0] < 0)	dist -= x;
+	if constexpr (axis[1] > 0)		dist += y;
+	else if constexpr (axis[1] < 0)	dist -= y;
+	if constexpr (axis[2] > 0)		dist += z;
+	else if constexpr (axis[2] < 0)	dist -= z;
+
+	return dist;
+}
+
+template <int K>
+void Kdop::FixedKdop<K>::Calc(const Poly::Polyhedron& mesh)
+{
+	const float* px = mesh.X.data();
+	const float* py = mesh.Y.data();
+	const float* pz = mesh.Z.data();
+	const int count = (int)mesh.size();
+
+	std::array<float, AxisCnt> minDist;
+	std::array<float, AxisCnt> maxDist;
+	minDist.fill(INFINITY);
+	maxDist.fill(-INFINITY);
+
+	// 1. Extents, unrolled over the axes.
+	[&]<int... A>(std::integer_sequence<int, A...>)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const float x = px[i];
+			const float y = py[i];
+			const float z = pz[i];
+
+			([&]
+			{
+				const float dist = ProjectFixedAxis<c_fixedKdopAxisIndex<K>[A]>(x, y, z);
+				minDist[A] = std::min(minDist[A], dist);
+				maxDist[A] = std::max(maxDist[A], dist);
+			}(), ...);
+		}
+	}(std::make_integer_sequence<int, AxisCnt>());
+
+	// 2. Planes, with the normalized axis.
+	[&]<int... A>(std::integer_sequence<int, A...>)
+	{
+		([&]
+		{
+			constexpr const int* axis = c_fixedKdopAxis[c_fixedKdopAxisIndex<K>[A]];
+			constexpr float invLength = c_fixedKdopInvLength[(axis[0] != 0) + (axis[1] != 0) + (axis[2] != 0)];
+
+			const Vector3 normal(axis[0] * invLength, axis[1] * invLength, axis[2] * invLength);
+			m_planes[2 * A] = Plane(-normal, minDist[A] * invLength);
+			m_planes[2 * A + 1] = Plane(normal, -maxDist[A] * invLength);
+		}(), ...);
+	}(std::make_integer_sequence<int, AxisCnt>());
+}
+
+template <int K>
+Poly::Polyhedron Kdop::FixedKdop<K>::ClipWithPolyhedron(const Poly::Polyhedron& polyhedron) const
+{
+	Poly::Polyhedron res = polyhedron;
+	Poly::ClipPolyhedron(res, m_planes);
+
+	return res;
+}
+
+template class Kdop::FixedKdop<6>;
+template class Kdop::FixedKdop<14>;
+template class Kdop::FixedKdop<18>;
+template class Kdop::FixedKdop<26>;
@@ -0,0 +1,264 @@
+#include "pch.h"
+#include "PieceStore.h"
+#include "Fracture.h"
+
+namespace
+{
+
+// Stores which are alive. A thread gives its slots back on exit only to these, it may outlive a store.
+struct StoreRegistry
+{
+	std::mutex											Mutex;
+	std::unordered_map<uint64_t, Fracture::PieceStore*>	StoreMap;
+};
+
+// Never destroyed, threads may exit after the static destructors.
+StoreRegistry& GetStoreRegistry()
+{
+	static StoreRegistry* registry = new StoreRegistry();
+	return *registry;
+}
+
+std::atomic<uint64_t> g_nextStoreID = 0;
+
+}
+
+// Free slots taken by the thread, per store.
+struct Fracture::PieceStore::ThreadCache
+{
+	struct ThreadSlab
+	{
+		uint64_t				StoreID;
+		std::vector<uint32_t>	FreeSlotVec;
+	};
+
+	std::vector<ThreadSlab>		SlabVec;
+
+	// Slots go back to the stores which are still alive, so a short lived thread does not keep them.
+	~ThreadCache()
+	{
+		StoreRegistry& registry = GetStoreRegistry();
+		std::lock_guard<std::mutex> registryLock(registry.Mutex);
+
+		for (ThreadSlab& slab : SlabVec)
+		{
+			auto store = registry.StoreMap.find(slab.StoreID);
+			if (store == registry.StoreMap.end() || TRUE == slab.FreeSlotVec.empty())
+				continue;
+
+			std::lock_guard<std::mutex> lock(store->second->m_mutex);
+			store->second->m_freeSlotVec.insert(store->second->m_freeSlotVec.end(), slab.FreeSlotVec.begin(), slab.FreeSlotVec.end());
+		}
+	}
+};
+
+thread_local Fracture::PieceStore::ThreadCache Fracture::PieceStore::t_threadCache;
+
+struct Fracture::PieceStore::Slot
+{
+	std::atomic<uint32_t>				Generation = 0;
+	alignas(Piece) unsigned char		Storage[sizeof(Piece)];
+
+	Piece*								GetPiece() { return std::launder(reinterpret_cast<Piece*>(Storage)); }
+};
+
+struct Fracture::PieceStore::Slab
+{
+	Slot								SlotArr[c_slabSlotCnt];
+};
+
+Fracture::PieceStore::PieceStore()
+	: m_storeID(g_nextStoreID.fetch_add(1, std::memory_order_relaxed)), m_slabArr(std::make_unique<std::atomic<Slab*>[]>(c_maxSlabCnt))
+{
+	StoreRegistry& registry = GetStoreRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	registry.StoreMap[m_storeID] = this;
+}
+
+Fracture::PieceStore::~PieceStore()
+{
+	// Exiting threads wait for it, or skip the store.
+	{
+		StoreRegistry& registry = GetStoreRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		registry.StoreMap.erase(m_storeID);
+	}
+
+	const uint32_t slabCnt = m_slabCnt.load(std::memory_order_acquire);
+	for (uint32_t s = 0; s < slabCnt; s++)
+	{
+		Slab* slab = m_slabArr[s].load(std::memory_order_relaxed);
+		for (Slot& slot : slab->SlotArr)
+		{
+			if (slot.Generation.load(std::memory_order_relaxed) & 1)
+				std::destroy_at(slot.GetPiece());
+		}
+
+		delete slab;
+	}
+}
+
+Fracture::PieceHandle Fracture::PieceStore::Create(const Poly::Polyhedron& convex, const Poly::Polyhedron& mesh)
+{
+	const uint32_t index = AcquireSlot();
+	new (GetSlot(index).Storage) Piece(convex, mesh);
+
+	return Publish(index);
+}
+
+Fracture::PieceHandle Fracture::PieceStore::Create(Poly::Polyhedron&& convex, Poly::Polyhedron&& mesh)
+{
+	const uint32_t index = AcquireSlot();
+	new (GetSlot(index).Storage) Piece(std::move(convex), std::move(mesh));
+
+	return Publish(index);
+}
+
+Fracture::Piece* Fracture::PieceStore::Get(const PieceHandle handle) const
+{
+	if (FALSE == IsInRange(handle))
+		return nullptr;
+
+	Slot& slot = GetSlot(handle.Index);
+	return slot.Generation.load(std::memory_order_acquire) == handle.Generation ? slot.GetPiece() : nullptr;
+}
+
+void Fracture::PieceStore::Release(const PieceHandle handle)
+{
+	if (FALSE == Destroy(handle))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeSlotVec.push_back(handle.Index);
+}
+
+void Fracture::PieceStore::Release(const Compound& compound)
+{
+	std::vector<uint32_t> releasedVec;
+	for (const PieceHandle handle : compound.PieceVec)
+	{
+		if (TRUE == Destroy(handle))
+			releasedVec.push_back(handle.Index);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeSlotVec.insert(m_freeSlotVec.end(), releasedVec.begin(), releasedVec.end());
+}
+
+void Fracture::PieceStore::ReleaseReplaced(const Compound& replaced, const std::vector<Compound>& replacementVec)
+{
+	std::unordered_set<uint32_t> keptSet;
+	for (const Compound& compound : replacementVec)
+		for (const PieceHandle handle : compound.PieceVec)
+			keptSet.insert(handle.Index);
+
+	std::vector<uint32_t> releasedVec;
+	for (const PieceHandle handle : replaced.PieceVec)
+	{
+		if (FALSE == keptSet.contains(handle.Index) && TRUE == Destroy(handle))
+			releasedVec.push_back(handle.Index);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeSlotVec.insert(m_freeSlotVec.end(), releasedVec.begin(), releasedVec.end());
+}
+
+Fracture::PieceStoreStats Fracture::PieceStore::GetStats() const
+{
+	PieceStoreStats stats;
+
+	const uint32_t slabCnt = m_slabCnt.load(std::memory_order_acquire);
+	stats.SlotCnt = (size_t)slabCnt * c_slabSlotCnt;
+
+	size_t heapSize = 0;
+	for (uint32_t s = 0; s < slabCnt; s++)
+	{
+		for (Slot& slot : m_slabArr[s].load(std::memory_order_acquire)->SlotArr)
+		{
+			if ((slot.Generation.load(std::memory_order_acquire) & 1) == 0)
+				continue;
+
+			stats.LivePieceCnt++;
+			heapSize += slot.GetPiece()->GetHeapSize();
+		}
+	}
+
+	stats.LiveBytes = stats.LivePieceCnt * sizeof(Piece) + heapSize;
+	stats.TotalBytes = slabCnt * sizeof(Slab) + heapSize;
+
+	return stats;
+}
+
+uint32_t Fracture::PieceStore::AcquireSlot()
+{
+	std::vector<ThreadCache::ThreadSlab>& slabVec = t_threadCache.SlabVec;
+	auto threadSlab = std::find_if(slabVec.begin(), slabVec.end(), [this](const ThreadCache::ThreadSlab& s) { return s.StoreID == m_storeID; });
+	if (threadSlab == slabVec.end())
+		threadSlab = slabVec.insert(slabVec.end(), ThreadCache::ThreadSlab{ m_storeID, {} });
+
+	std::vector<uint32_t>& freeSlotVec = threadSlab->FreeSlotVec;
+	if (TRUE == freeSlotVec.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// 1. Released slots first, up to a slab of them.
+		if (FALSE == m_freeSlotVec.empty())
+		{
+			const size_t cnt = std::min(m_freeSlotVec.size(), (size_t)c_slabSlotCnt);
+			freeSlotVec.assign(m_freeSlotVec.end() - cnt, m_freeSlotVec.end());
+			m_freeSlotVec.resize(m_freeSlotVec.size() - cnt);
+		}
+		// 2. New slab otherwise.
+		else
+		{
+			const uint32_t s = m_slabCnt.load(std::memory_order_relaxed);
+			if (s == c_maxSlabCnt)
+				throw std::bad_alloc();
+
+			m_slabArr[s].store(new Slab(), std::memory_order_release);
+			m_slabCnt.store(s + 1, std::memory_order_release);
+
+			// Taken from the back, in slot order.
+			for (uint32_t i = c_slabSlotCnt; i > 0; i--)
+				freeSlotVec.push_back(s * c_slabSlotCnt + i - 1);
+		}
+	}
+
+	const uint32_t index = freeSlotVec.back();
+	freeSlotVec.pop_back();
+
+	return index;
+}
+
+Fracture::PieceHandle Fracture::PieceStore::Publish(const uint32_t index)
+{
+	// Generation turns odd once the piece is constructed.
+	const uint32_t generation = GetSlot(index).Generation.fetch_add(1, std::memory_order_release) + 1;
+
+	return PieceHandle(index, generation);
+}
+
+bool Fracture::PieceStore::Destroy(const PieceHandle handle)
+{
+	if (FALSE == IsInRange(handle))
+		return false;
+
+	// Only the first release of a handle turns the generation even.
+	Slot& slot = GetSlot(handle.Index);
+	uint32_t generation = handle.Generation;
+	if (FALSE == slot.Generation.compare_exchange_strong(generation, generation + 1, std::memory_order_acq_rel))
+		return false;
+
+	std::destroy_at(slot.GetPiece());
+	return true;
+}
+
+bool Fracture::PieceStore::IsInRange(const PieceHandle handle) const
+{
+	return (handle.Generation & 1) && handle.Index / c_slabSlotCnt < m_slabCnt.load(std::memory_order_acquire);
+}
+
+Fracture::PieceStore::Slot& Fracture::PieceStore::GetSlot(const uint32_t index) const
+{
+	return m_slabArr[index / c_slabSlotCnt].load(std::memory_order_acquire)->SlotArr[index % c_slabSlotCnt];
+}
@@ -3,56 +3,134 @@
 
 #include "VMACH.h"
 
-Poly::Vertex::Vertex(const Vertex& rhs)
-	: Position(rhs.Position), NeighborVertexVec(rhs.NeighborVertexVec), comp(rhs.comp), ID(rhs.ID)
+// Plane classification kernels use 8 lanes with AVX, 4 lanes with SSE, scalar otherwise.
+#if defined(__AVX__)
+	#define POLY_USE_AVX
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define POLY_USE_SSE
+	#include <immintrin.h>
+#endif
+
+// Same threshold as ComparePlanePoint. No float lies between 1e-10f and 1e-10, so comparing in float is exact.
+static constexpr float c_planeEpsilon = 1.0e-10f;
+
+void Poly::Polyhedron::clear()
 {
+	X.clear();
+	Y.clear();
+	Z.clear();
+	NeighborOffset.assign(1, 0);
+	NeighborIndex.clear();
 }
 
-Poly::Vertex::Vertex() : Position(Vector3(0, 0, 0)), comp(1), ID(-1) {}
-Poly::Vertex::Vertex(const Vector3& pos) : Position(pos), comp(1), ID(-1) {}
-Poly::Vertex::Vertex(const Vector3& pos, const int c) : Position(pos), comp(c), ID(-1) {}
+void Poly::Polyhedron::reserve(const size_t vertexCount, const size_t neighborCount)
+{
+	X.reserve(vertexCount);
+	Y.reserve(vertexCount);
+	Z.reserve(vertexCount);
+	NeighborOffset.reserve(vertexCount + 1);
+	NeighborIndex.reserve(neighborCount);
+}
 
-Poly::Vertex& Poly::Vertex::operator=(const Vertex& rhs)
+int Poly::Polyhedron::AddVertex(const Vector3& pos, std::span<const int> neighbors)
 {
-	Position = rhs.Position;
-	NeighborVertexVec = rhs.NeighborVertexVec;
-	comp = rhs.comp;
-	ID = rhs.ID;
+	X.push_back(pos.x);
+	Y.push_back(pos.y);
+	Z.push_back(pos.z);
+	NeighborIndex.insert(NeighborIndex.end(), neighbors.begin(), neighbors.end());
+	NeighborOffset.push_back(NeighborIndex.size());
 
-	return *this;
+	return X.size() - 1;
 }
 
-bool Poly::Vertex::operator==(const Vertex& rhs) const
+void Poly::Extract::AddFace(std::span<const int> face)
 {
-	return (Position == rhs.Position && NeighborVertexVec == rhs.NeighborVertexVec && comp == rhs.comp && ID == rhs.ID);
+	FaceIndex.insert(FaceIndex.end(), face.begin(), face.end());
+	FaceOffset.push_back(FaceIndex.size());
 }
 
 // Internal Functions.
 double sgn(const double x) { return (x >= 0.0 ? 1.0 : -1.0); }
 double sgn0(const double x) { return (x > 0.0 ? 1.0 : x < 0.0 ? -1.0 : 0.0); }
 template <typename Value> Value safeInv(const Value& x, const double fuzz = 1.0e-30) { return sgn(x) / std::max(fuzz, std::abs(x)); }
-int FaceLoop(const Poly::Vertex& v, const int vprev)
+
+// Returns the slot of the edge following (vprev -> v) on the same face loop.
+int FaceLoopSlot(const Poly::Polyhedron& polyhedron, const int v, const int vprev)
 {
-	const auto itr = std::find(v.NeighborVertexVec.begin(), v.NeighborVertexVec.end(), vprev);
-	if (itr == v.NeighborVertexVec.begin())
-		return v.NeighborVertexVec.back();
-	else
-		return *(itr - 1);
+	const int begin = polyhedron.NeighborOffset[v];
+	const int end = polyhedron.NeighborOffset[v + 1];
+
+	int slot = begin;
+	while (slot < end && polyhedron.NeighborIndex[slot] != vprev)
+		++slot;
+
+	return slot == begin ? end - 1 : slot - 1;
 }
 
 void Poly::InitPolyhedron(Polyhedron& polyhedron, const std::vector<Vector3>& positionVec,
 						  const std::vector<std::vector<int>>& neighborVec)
 {
-	polyhedron.resize(positionVec.size());
+	size_t neighborCount = 0;
+	for (const auto& nei : neighborVec)
+		neighborCount += nei.size();
+
+	polyhedron.clear();
+	polyhedron.reserve(positionVec.size(), neighborCount);
 
 	for (int i = 0; i < positionVec.size(); i++)
+		polyhedron.AddVertex(positionVec[i], neighborVec[i]);
+}
+
+bool Poly::InitPolyhedron(Polyhedron& polyhedron, const std::vector<Vector3>& positionVec, const Extract& faces)
+{
+	// Face loops are counter clockwise from outside, as ExtractFaces gives them.
+	// Around vertex v, the neighbor following q is p for every face loop (p -> v -> q).
+	std::vector<std::vector<std::pair<int, int>>> loopVec(positionVec.size());
+	for (const std::span<const int> face : faces)
 	{
-		polyhedron[i].Position = positionVec[i];
-		polyhedron[i].NeighborVertexVec = neighborVec[i];
+		for (int i = 0; i < face.size(); i++)
+			loopVec[face[i]].emplace_back(face[(i + 1) % face.size()], face[(i + face.size() - 1) % face.size()]);
 	}
+
+	// Faces around each vertex must close into a single loop.
+	std::vector<std::vector<int>> neighborVec(positionVec.size());
+	for (int v = 0; v < positionVec.size(); v++)
+	{
+		const auto& loop = loopVec[v];
+		if (loop.empty())
+			continue;
+
+		int cur = loop[0].first;
+		for (int k = 0; k < loop.size(); k++)
+		{
+			if (k > 0 && cur == loop[0].first)
+				return false;
+
+			neighborVec[v].push_back(cur);
+
+			const auto next = std::find_if(loop.begin(), loop.end(), [cur](const std::pair<int, int>& e) { return e.first == cur; });
+			if (next == loop.end())
+				return false;
+
+			cur = next->second;
+		}
+
+		if (cur != loop[0].first)
+			return false;
+	}
+
+	InitPolyhedron(polyhedron, positionVec, neighborVec);
+	return true;
 }
 
 void Poly::Moments(double& zerothMoment, Vector3& firstMoment, const Polyhedron& polyhedron)
+{
+	Moments(zerothMoment, firstMoment, polyhedron, ExtractFaces(polyhedron));
+}
+
+void Poly::Moments(double& zerothMoment, Vector3& firstMoment, const Polyhedron& polyhedron, const Extract& faces)
 {
 	// Clear the result for accumulation.
 	zerothMoment = 0.0;
@@ -60,20 +138,19 @@ void Poly::Moments(double& zerothMoment, Vector3& firstMoment, const Polyhedron&
 
 	if (polyhedron.size() > 3)
 	{
-		const auto origin = polyhedron[0].Position;
+		const auto origin = polyhedron.Position(0);
 
 		// Walk the facets
-		const auto facets = ExtractFaces(polyhedron);
-		for (const auto& facet : *facets)
+		for (const auto facet : faces)
 		{
 			const auto n = facet.size();
-			const auto p0 = polyhedron[facet[0]].Position - origin;
+			const auto p0 = polyhedron.Position(facet[0]) - origin;
 			for (auto k = 1u; k < n - 1; ++k)
 			{
 				const auto i = facet[k];
 				const auto j = facet[(k + 1) % n];
-				const auto p1 = polyhedron[i].Position - origin;
-				const auto p2 = polyhedron[j].Position - origin;
+				const auto p1 = polyhedron.Position(i) - origin;
+				const auto p2 = polyhedron.Position(j) - origin;
 				const auto dV = p0.Dot(p1.Cross(p2));
 				zerothMoment += dV;
 				firstMoment += (p0 + p1 + p2) * dV;
@@ -86,39 +163,39 @@ void Poly::Moments(double& zerothMoment, Vector3& firstMoment, const Polyhedron&
 	}
 }
 
-Poly::Extract* Poly::ExtractFaces(const Polyhedron& polyhedron)
+Poly::Extract Poly::ExtractFaces(const Polyhedron& polyhedron)
 {
-	Extract* faceVertices = new Extract();
-	std::set<std::pair<int, int>> visitedEdge;
+	Extract faceVertices;
+	faceVertices.FaceIndex.reserve(polyhedron.NeighborIndex.size());
+
+	// Every directed edge belongs to exactly one face, so visited flags are kept per neighbor slot.
+	std::vector<bool> visitedEdge(polyhedron.NeighborIndex.size(), false);
+	std::vector<int> face;
 
 	for (int i = 0; i < polyhedron.size(); i++)
 	{
-		const Vertex& vert = polyhedron[i];
-		if (vert.comp >= 0)
+		for (int startSlot = polyhedron.NeighborOffset[i]; startSlot < polyhedron.NeighborOffset[i + 1]; startSlot++)
 		{
-			for (const int adjIndex : vert.NeighborVertexVec)
-			{
-				if (visitedEdge.end() != visitedEdge.find(std::make_pair(i, adjIndex)))
-					continue;
+			if (TRUE == visitedEdge[startSlot])
+				continue;
 
-				std::vector<int> face(1, i);
-				int istart = i;
-				int iprev = i;
-				int inext = adjIndex;
-				int itmp = adjIndex;
+			face.assign(1, i);
+			int istart = i;
+			int iprev = i;
+			int inext = polyhedron.NeighborIndex[startSlot];
+			int slot = startSlot;
 
-				while (inext != istart)
-				{
-					visitedEdge.insert(std::make_pair(iprev, inext));
-					face.push_back(inext);
-					itmp = inext;
-					inext = FaceLoop(polyhedron[inext], iprev);
-					iprev = itmp;
-				}
-
-				visitedEdge.insert(std::make_pair(iprev, inext)); // Final edge connecting last->first vertex
-				faceVertices->push_back(face);
+			while (inext != istart)
+			{
+				visitedEdge[slot] = true;
+				face.push_back(inext);
+				slot = FaceLoopSlot(polyhedron, inext, iprev);
+				iprev = inext;
+				inext = polyhedron.NeighborIndex[slot];
 			}
+
+			visitedEdge[slot] = true; // Final edge connecting last->first vertex
+			faceVertices.AddFace(face);
 		}
 	}
 
@@ -262,293 +339,360 @@ std::vector<std::vector<int>> Poly::ExtractNeighborFromMesh(std::vector<Vector3>
 	return nei;
 }
 
-void Poly::ClipPolyhedron(Polyhedron& polyhedron, const std::vector<Plane>& planes)
+// Working state of ClipPolyhedron, reused between calls on the same thread.
+// While a plane cuts the polyhedron, each neighbor list lives in its own range of a flat buffer with some slack,
+// and is moved to the back of the buffer when it has to grow.
+struct ClipScratch
 {
-	bool updated;
-	int nverts0, nverts, nneigh, i, ii, j, k, jn, inew, iprev, inext, itmp;
-	std::vector<int>::iterator nitr;
-	const double nearlyZero = 1.0e-15;
+	std::vector<int>			Comp;
+	std::vector<int>			FlippedComp;
+	std::vector<int>			ID;
 
-	// Prepare to dump the input state if we hit an exception
-	std::string initial_state;
+	std::vector<float>			MinDist;
+	std::vector<float>			MaxDist;
+	std::vector<float>			Depth;
+	std::vector<int>			PlaneOrder;
 
-	// Find the bounding box of the polyhedron.
-	auto xmin = std::numeric_limits<double>::max(), xmax = std::numeric_limits<double>::lowest();
-	auto ymin = std::numeric_limits<double>::max(), ymax = std::numeric_limits<double>::lowest();
-	auto zmin = std::numeric_limits<double>::max(), zmax = std::numeric_limits<double>::lowest();
-	for (auto& v : polyhedron)
+	std::vector<int>			Start;
+	std::vector<int>			Count;
+	std::vector<int>			Capacity;
+	std::vector<int>			Neighbor;
+	std::vector<int>			OldNeighbor;
+
+	Poly::Polyhedron			Out;
+
+	// New vertices of SplitPolyhedron, by the edge they are on.
+	std::unordered_map<uint64_t, Poly::Vector3>	EdgePointMap;
+
+	int* Begin(const int v) { return Neighbor.data() + Start[v]; }
+	int* OldBegin(const int v) { return OldNeighbor.data() + Start[v]; }
+
+	int AddList(const int count, const int capacity)
 	{
-		xmin = std::min(xmin, (double)v.Position.x);
-		xmax = std::max(xmax, (double)v.Position.x);
-		ymin = std::min(ymin, (double)v.Position.y);
-		ymax = std::max(ymax, (double)v.Position.y);
-		zmin = std::min(zmin, (double)v.Position.z);
-		zmax = std::max(zmax, (double)v.Position.z);
+		Start.push_back(Neighbor.size());
+		Count.push_back(count);
+		Capacity.push_back(capacity);
+		Neighbor.resize(Neighbor.size() + capacity, -1);
+
+		return Start.size() - 1;
 	}
 
-	// Loop over the planes.
-	auto kplane = 0u;
-	const auto nplanes = planes.size();
-	while (kplane < nplanes && !polyhedron.empty())
+	int FaceLoop(const int v, const int vprev)
 	{
-		const auto& plane = planes[kplane++];
+		const int* nei = Begin(v);
+		int k = 0;
+		while (k < Count[v] && nei[k] != vprev)
+			++k;
 
-		// First check against the bounding box.
-		auto boxcomp = ComparePlaneBB(plane, xmin, ymin, zmin, xmax, ymax, zmax);
-		auto above = boxcomp == 1;
-		auto below = boxcomp == -1;
+		return k == 0 || k == Count[v] ? nei[Count[v] - 1] : nei[k - 1];
+	}
 
-		// Check the current set of vertices against this plane.
-		// Also keep track of any vertices that landed exactly in-plane.
-		if (!(above || below))
+	void Insert(const int v, const int offset, const int value, const int oldValue)
+	{
+		if (Count[v] == Capacity[v])
+		{
+			const int start = Neighbor.size();
+			Neighbor.resize(start + Capacity[v] * 2, -1);
+			OldNeighbor.resize(start + Capacity[v] * 2, -1);
+			std::copy_n(Neighbor.begin() + Start[v], Count[v], Neighbor.begin() + start);
+			std::copy_n(OldNeighbor.begin() + Start[v], Count[v], OldNeighbor.begin() + start);
+
+			Start[v] = start;
+			Capacity[v] *= 2;
+		}
+
+		int* nei = Begin(v);
+		int* old = OldBegin(v);
+		std::copy_backward(nei + offset, nei + Count[v], nei + Count[v] + 1);
+		std::copy_backward(old + offset, old + Count[v], old + Count[v] + 1);
+		nei[offset] = value;
+		old[offset] = oldValue;
+		Count[v]++;
+	}
+};
+
+static thread_local ClipScratch t_clipScratch;
+
+// Point of the plane on the edge (i, j). Shared by the cuts of the same polyhedron by the same plane, if the map is given.
+static Poly::Vector3 EdgePoint(const Poly::Polyhedron& polyhedron, const int i, const int j, const Poly::Plane& plane,
+							   std::unordered_map<uint64_t, Poly::Vector3>* edgePointMap)
+{
+	if (edgePointMap == nullptr)
+		return Poly::PlaneLineIntersection(polyhedron.Position(i), polyhedron.Position(j), plane);
+
+	const uint64_t key = ((uint64_t)std::min(i, j) << 32) | (uint32_t)std::max(i, j);
+	const auto res = edgePointMap->try_emplace(key);
+	if (TRUE == res.second)
+		res.first->second = Poly::PlaneLineIntersection(polyhedron.Position(i), polyhedron.Position(j), plane);
+
+	return res.first->second;
+}
+
+// Cuts the polyhedron by the plane, which passes through it. Vertices of comp -1 are removed, comp is extended by the new vertices.
+static void CutPolyhedron(Poly::Polyhedron& polyhedron, const Poly::Plane& plane, std::vector<int>& comp, ClipScratch& scratch,
+						  std::unordered_map<uint64_t, Poly::Vector3>* edgePointMap = nullptr)
+{
+	using Poly::Polyhedron;
+	using Poly::Vector3;
+
+	bool updated;
+	int nverts0, nverts, nneigh, i, ii, j, k, jn, inew, iprev, inext, itmp;
+
+	// Unpack the neighbor lists with slack for the insertions below.
+	nverts0 = polyhedron.size();
+
+	scratch.Start.clear();
+	scratch.Count.clear();
+	scratch.Capacity.clear();
+	scratch.Neighbor.clear();
+	for (i = 0; i < nverts0; ++i)
+	{
+		const auto nei = polyhedron.Neighbors(i);
+		scratch.AddList(nei.size(), std::max<int>(4, 2 * nei.size()));
+		std::copy(nei.begin(), nei.end(), scratch.Begin(i));
+	}
+
+	// Insert any new vertices.
+	for (i = 0; i < nverts0; ++i)
+	{ // Only check vertices before we start adding new ones.
+		if (comp[i] == -1)
 		{
-			above = true;
-			below = true;
-			for (auto& v : polyhedron)
+			// This vertex is clipped, scan it's neighbors for any that survive
+			nneigh = scratch.Count[i];
+			for (j = 0; j < nneigh; ++j)
 			{
-				v.comp = ComparePlanePoint(plane, v.Position);
-				if (v.comp == 1)
-				{
-					below = false;
-				}
-				else if (v.comp == -1)
+				jn = scratch.Begin(i)[j];
+				if (comp[jn] > 0)
 				{
-					above = false;
+					// This edge straddles the clip plane, so insert a new vertex.
+					inew = scratch.AddList(2, 4);
+					comp.push_back(2); // 2 indicates new vertex
+
+					const Vector3 pos = EdgePoint(polyhedron, i, jn, plane, edgePointMap);
+					polyhedron.X.push_back(pos.x);
+					polyhedron.Y.push_back(pos.y);
+					polyhedron.Z.push_back(pos.z);
+
+					scratch.Begin(inew)[0] = i;
+					scratch.Begin(inew)[1] = jn;
+
+					*std::find(scratch.Begin(jn), scratch.Begin(jn) + scratch.Count[jn], i) = inew;
+					scratch.Begin(i)[j] = inew;
 				}
 			}
 		}
-
-		// Did we get a simple case?
-		if (below)
+		else if (comp[i] == 0)
 		{
-			// The polyhedron is entirely below the clip plane, && is therefore entirely removed.
-			// No need to check any more clipping planes -- we're done.
-			polyhedron.clear();
+			// This vertex is exactly in plane.
 		}
-		else if (!above)
-		{
-			// This plane passes through the polyhedron.
-			// Insert any new vertices.
-			nverts0 = polyhedron.size();
-			for (i = 0; i < nverts0; ++i)
-			{ // Only check vertices before we start adding new ones.
-				if (polyhedron[i].comp == -1)
-				{
-					// This vertex is clipped, scan it's neighbors for any that survive
-					nneigh = polyhedron[i].NeighborVertexVec.size();
-					for (auto j = 0; j < nneigh; ++j)
-					{
-						jn = polyhedron[i].NeighborVertexVec[j];
-						if (polyhedron[jn].comp > 0)
-						{
-							// This edge straddles the clip plane, so insert a new vertex.
-							inew = polyhedron.size();
-							polyhedron.push_back(
-								Vertex(PlaneLineIntersection(polyhedron[i].Position, polyhedron[jn].Position, plane), 2)); // 2 indicates new vertex
-							polyhedron[inew].NeighborVertexVec = std::vector<int>({ i, jn });
+	}
+	nverts = scratch.Start.size();
 
-							nitr = find(polyhedron[jn].NeighborVertexVec.begin(),
-										polyhedron[jn].NeighborVertexVec.end(), i);
+	// Look for any topology links to clipped nodes we need to patch.
+	// We hit any new vertices first, && then any preexisting that happened to lie exactly in-plane.
+	scratch.OldNeighbor = scratch.Neighbor;
+	for (ii = 0; ii < nverts; ++ii)
+	{
+		i = (ii + nverts0) % nverts;
+		if (comp[i] == 0 || comp[i] == 2)
+		{
+			nneigh = scratch.Count[i];
 
-							*nitr = inew;
-							polyhedron[i].NeighborVertexVec[j] = inew;
-						}
-					}
-				}
-				else if (polyhedron[i].comp == 0)
-				{
-					// This vertex is exactly in plane.
-				}
-			}
-			nverts = polyhedron.size();
-
-			// Look for any topology links to clipped nodes we need to patch.
-			// We hit any new vertices first, && then any preexisting that happened to lie exactly in-plane.
-			std::vector<std::vector<int>> old_neighbors(nverts);
-			for (i = 0; i < nverts; ++i)
-				old_neighbors[i] = polyhedron[i].NeighborVertexVec;
-			for (ii = 0; ii < nverts; ++ii)
+			// Look for any neighbors of the vertex that are clipped.
+			for (j = 0; j < nneigh; ++j)
 			{
-				i = (ii + nverts0) % nverts;
-				if (polyhedron[i].comp == 0 || polyhedron[i].comp == 2)
+				jn = scratch.Begin(i)[j];
+				if (jn >= 0 && comp[jn] == -1)
 				{
-					nneigh = polyhedron[i].NeighborVertexVec.size();
+					// This neighbor is clipped, so look for the first unclipped vertex along this face loop.
+					iprev = i;
+					inext = jn;
+					itmp = inext;
 
-					// Look for any neighbors of the vertex that are clipped.
-					for (j = 0; j < nneigh; ++j)
+					k = 0;
+					while (comp[inext] == -1 && k++ < nverts)
 					{
-						jn = polyhedron[i].NeighborVertexVec[j];
-						if (polyhedron[jn].comp == -1)
-						{
-							// This neighbor is clipped, so look for the first unclipped vertex along this face loop.
-							iprev = i;
-							inext = jn;
-							itmp = inext;
-
-							k = 0;
-							while (polyhedron[inext].comp == -1 && k++ < nverts)
-							{
-								itmp = inext;
-								inext = FaceLoop(polyhedron[inext], iprev);
-								iprev = itmp;
-							}
-
-							if (polyhedron[i].NeighborVertexVec[(j + 1u) % polyhedron[i].NeighborVertexVec.size()] ==
-									inext ||
-								inext == i)
-							{
-								polyhedron[i].NeighborVertexVec[j] = -1; // mark to be removed
-							}
-							else
-							{
-								polyhedron[i].NeighborVertexVec[j] = inext;
-								if (polyhedron[inext].comp == 2)
-								{
-									polyhedron[inext].NeighborVertexVec.insert(
-										polyhedron[inext].NeighborVertexVec.begin(), i);
-									old_neighbors[inext].insert(old_neighbors[inext].begin(), -1);
-								}
-								else
-								{
-									size_t offset = std::distance(
-										old_neighbors[inext].begin(),
-										std::find(old_neighbors[inext].begin(), old_neighbors[inext].end(), iprev));
-
-									polyhedron[inext].NeighborVertexVec.insert(
-										polyhedron[inext].NeighborVertexVec.begin() + offset, i);
-									old_neighbors[inext].insert(old_neighbors[inext].begin() + offset, i);
-								}
-							}
-						}
+						itmp = inext;
+						inext = scratch.FaceLoop(inext, iprev);
+						iprev = itmp;
 					}
-				}
-			}
-			for (i = 0; i < nverts; ++i)
-			{
-				polyhedron[i].NeighborVertexVec.erase(
-					std::remove(polyhedron[i].NeighborVertexVec.begin(), polyhedron[i].NeighborVertexVec.end(), -1),
-					polyhedron[i].NeighborVertexVec.end());
-			}
 
-			// Check for any points with just two neighbors that are colinear
-			updated = true;
-			while (updated)
-			{
-				updated = false;
-				for (i = 0; i < nverts; ++i)
-				{
-					auto& v = polyhedron[i];
-					if (v.comp >= 0 && v.NeighborVertexVec.size() == 2)
+					if (scratch.Begin(i)[(j + 1) % scratch.Count[i]] == inext || inext == i)
 					{
-						updated = true;
-						iprev = v.NeighborVertexVec[0];
-						inext = v.NeighborVertexVec[1];
-						auto& vprev = polyhedron[iprev];
-						auto& vnext = polyhedron[inext];
-
-						k = 0;
-						while (k < vprev.NeighborVertexVec.size() && vprev.NeighborVertexVec[k] != i)
-							++k;
-
-						vprev.NeighborVertexVec[k] = inext;
-						k = 0;
-						while (k < vnext.NeighborVertexVec.size() && vnext.NeighborVertexVec[k] != i)
-							++k;
-
-						vnext.NeighborVertexVec[k] = iprev;
-						v.comp = -1; // Mark this vertex for removal
+						scratch.Begin(i)[j] = -1; // mark to be removed
 					}
-				}
-			}
-
-			// Remove the clipped vertices && collapse degenerates, compressing the polyhedron.
-			i = 0;
-			xmin = std::numeric_limits<double>::max(), xmax = std::numeric_limits<double>::lowest();
-			ymin = std::numeric_limits<double>::max(), ymax = std::numeric_limits<double>::lowest();
-			zmin = std::numeric_limits<double>::max(), zmax = std::numeric_limits<double>::lowest();
-			for (auto& v : polyhedron)
-			{
-				if (v.comp >= 0)
-				{
-					v.ID = i++;
-					xmin = std::min(xmin, (double)v.Position.x);
-					xmax = std::max(xmax, (double)v.Position.x);
-					ymin = std::min(ymin, (double)v.Position.y);
-					ymax = std::max(ymax, (double)v.Position.y);
-					zmin = std::min(zmin, (double)v.Position.z);
-					zmax = std::max(zmax, (double)v.Position.z);
-				}
-			}
-
-			// Renumber the neighbor links.
-			for (i = 0; i < nverts; ++i)
-			{
-				if (polyhedron[i].comp >= 0)
-				{
-					for (j = 0; j < int(polyhedron[i].NeighborVertexVec.size()); ++j)
+					else
 					{
-						polyhedron[i].NeighborVertexVec[j] = polyhedron[polyhedron[i].NeighborVertexVec[j]].ID;
+						scratch.Begin(i)[j] = inext;
+						if (comp[inext] == 2)
+						{
+							scratch.Insert(inext, 0, i, -1);
+						}
+						else
+						{
+							const int* old = scratch.OldBegin(inext);
+							const int offset = std::find(old, old + scratch.Count[inext], iprev) - old;
+
+							scratch.Insert(inext, offset, i, i);
+						}
 					}
 				}
 			}
-			polyhedron.erase(std::remove_if(polyhedron.begin(), polyhedron.end(), [](Vertex& v) { return v.comp < 0; }),
-							 polyhedron.end());
-
-			// Is the polyhedron gone?
-			if (polyhedron.size() < 4)
-				polyhedron.clear();
 		}
+	}
+	for (i = 0; i < nverts; ++i)
+	{
+		int* nei = scratch.Begin(i);
+		scratch.Count[i] = std::remove(nei, nei + scratch.Count[i], -1) - nei;
+	}
 
-		if (FALSE)
+	// Check for any points with just two neighbors that are colinear
+	updated = true;
+	while (updated)
+	{
+		updated = false;
+		for (i = 0; i < nverts; ++i)
 		{
-			auto faces = ExtractFaces(polyhedron);
-
-			std::vector<std::vector<int>> maintainFaces;
-			std::vector<std::vector<int>> capFaces;
-			for (const std::vector<int>& face : *faces)
+			if (comp[i] >= 0 && scratch.Count[i] == 2)
 			{
-				if (face.size() > 3)
-					capFaces.push_back(face);
-				else
-					maintainFaces.push_back(face);
+				updated = true;
+				iprev = scratch.Begin(i)[0];
+				inext = scratch.Begin(i)[1];
+
+				*std::find(scratch.Begin(iprev), scratch.Begin(iprev) + scratch.Count[iprev], i) = inext;
+				*std::find(scratch.Begin(inext), scratch.Begin(inext) + scratch.Count[inext], i) = iprev;
+				comp[i] = -1; // Mark this vertex for removal
 			}
+		}
+	}
 
-			for (const std::vector<int>& face : capFaces)
-			{
-				VMACH::PolygonFace polyFace = { false };
-				for (const int iVert : face)
-					polyFace.AddVertex(polyhedron[iVert].Position);
+	// Remove the clipped vertices && collapse degenerates, compressing the polyhedron.
+	scratch.ID.resize(nverts);
+	Polyhedron& out = scratch.Out;
+	out.clear();
+	for (i = 0; i < nverts; ++i)
+	{
+		if (comp[i] >= 0)
+			scratch.ID[i] = out.AddVertex(polyhedron.Position(i), std::span<const int>(scratch.Begin(i), scratch.Count[i]));
+	}
+
+	// Renumber the neighbor links.
+	for (int& iAdj : out.NeighborIndex)
+		iAdj = scratch.ID[iAdj];
+
+	// Keep the old buffers in the scratch for the next cut.
+	std::swap(polyhedron, out);
+}
+
+void Poly::ClipPolyhedron(Polyhedron& polyhedron, std::span<const Plane> planes)
+{
+	ClipScratch& scratch = t_clipScratch;
+
+	int k;
+
+	const auto computeBB = [&polyhedron](float* bbMin, float* bbMax)
+	{
+		const auto x = std::minmax_element(polyhedron.X.begin(), polyhedron.X.end());
+		const auto y = std::minmax_element(polyhedron.Y.begin(), polyhedron.Y.end());
+		const auto z = std::minmax_element(polyhedron.Z.begin(), polyhedron.Z.end());
+
+		bbMin[0] = *x.first;	bbMax[0] = *x.second;
+		bbMin[1] = *y.first;	bbMax[1] = *y.second;
+		bbMin[2] = *z.first;	bbMax[2] = *z.second;
+	};
+
+	if (polyhedron.empty())
+		return;
+
+	// Find the bounding box of the polyhedron.
+	float bbMin[3], bbMax[3];
+	computeBB(bbMin, bbMax);
+
+	// Check the whole plane set against the bounding box at once.
+	// Planes keeping the whole box never clip, a plane removing the whole box removes the polyhedron.
+	const int nplanes = planes.size();
+	scratch.MinDist.resize(nplanes);
+	scratch.MaxDist.resize(nplanes);
+	scratch.Depth.resize(nplanes);
+	PlaneBBDistance(planes.data(), nplanes, bbMin, bbMax, scratch.MinDist.data(), scratch.MaxDist.data());
+
+	scratch.PlaneOrder.clear();
+	for (k = 0; k < nplanes; ++k)
+	{
+		const int boxcomp = ComparePlaneBB(scratch.MinDist[k], scratch.MaxDist[k]);
+		if (boxcomp == -1)
+		{
+			polyhedron.clear();
+			return;
+		}
 
-				const Vector3 a = polyhedron[face[0]].Position;
-				const Vector3 b = polyhedron[face[1]].Position;
-				const Vector3 c = polyhedron[face[2]].Position;
+		if (boxcomp == 0)
+		{
+			// Part of the box lying beyond the plane.
+			scratch.Depth[k] = scratch.MaxDist[k] / (scratch.MaxDist[k] - scratch.MinDist[k]);
+			scratch.PlaneOrder.push_back(k);
+		}
+	}
 
-				Vector3 assumeNormal = (b - a).Cross(c - a);
-				assumeNormal.Normalize();
+	// Apply the planes cutting deepest into the box first, they are likely to discard the most vertices
+	// and leave less work for the rest.
+	std::stable_sort(scratch.PlaneOrder.begin(), scratch.PlaneOrder.end(),
+					 [&scratch](const int a, const int b) { return scratch.Depth[a] > scratch.Depth[b]; });
+
+	// Loop over the planes.
+	bool boxShrunk = false;
+	for (const int kplane : scratch.PlaneOrder)
+	{
+		if (polyhedron.empty())
+			break;
 
-				if (TRUE == polyFace.IsCCW(assumeNormal))
-					assumeNormal = -assumeNormal;
+		const auto& plane = planes[kplane];
 
-				polyFace.ManuallySetFacePlane(DirectX::SimpleMath::Plane(a, assumeNormal));
+		// The box only shrinks, so the first pass is still valid until a cut happens.
+		if (TRUE == boxShrunk)
+		{
+			float minDist, maxDist;
+			PlaneBBDistance(&plane, 1, bbMin, bbMax, &minDist, &maxDist);
 
-				std::vector<int> localTriangulated = polyFace.EarClipping();
-				std::vector<int> triangulated;
-				for (const int local : localTriangulated)
-					triangulated.push_back(face[local]);
+			const int boxcomp = ComparePlaneBB(minDist, maxDist);
+			if (boxcomp == 1)
+				continue;
 
-				for (int i = 0; i < triangulated.size(); i += 3)
-					maintainFaces.push_back({ triangulated[i], triangulated[i + 1], triangulated[i + 2] });
+			if (boxcomp == -1)
+			{
+				polyhedron.clear();
+				break;
 			}
+		}
 
-			std::vector<int> flat;
-			for (const std::vector<int>& face : maintainFaces)
-				flat.insert(flat.end(), face.begin(), face.end());
+		// Check the current set of vertices against this plane.
+		// Also keep track of any vertices that landed exactly in-plane.
+		const int vertcomp = ComparePlanePoints(plane, polyhedron, scratch.Comp);
+		const auto above = vertcomp == 1;
+		const auto below = vertcomp == -1;
 
-			std::vector<Vector3> vertices(polyhedron.size());
-			std::transform(polyhedron.begin(), polyhedron.end(), vertices.begin(), [](const Vertex& vert) { return vert.Position; });
+		// Did we get a simple case?
+		if (below)
+		{
+			// The polyhedron is entirely below the clip plane, && is therefore entirely removed.
+			// No need to check any more clipping planes -- we're done.
+			polyhedron.clear();
+		}
+		else if (!above)
+		{
+			// This plane passes through the polyhedron.
+			CutPolyhedron(polyhedron, plane, scratch.Comp, scratch);
 
-			std::vector<std::vector<int>> nei = ExtractNeighborFromMesh(vertices, flat);
-			Poly::InitPolyhedron(polyhedron, vertices, nei);
+			// Is the polyhedron gone?
+			if (polyhedron.size() < 4)
+			{
+				polyhedron.clear();
+			}
+			else
+			{
+				computeBB(bbMin, bbMax);
+				boxShrunk = true;
+			}
 		}
 	}
 }
@@ -565,23 +709,272 @@ Poly::Polyhedron Poly::ClipPolyhedron(const Polyhedron& polyhedron, const VMACH:
 	return res;
 }
 
+void Poly::SplitPolyhedron(const Polyhedron& polyhedron, const Plane& plane, Polyhedron& inside, Polyhedron& outside)
+{
+	ClipScratch& scratch = t_clipScratch;
+
+	inside.clear();
+	outside.clear();
+	if (polyhedron.empty())
+		return;
+
+	const int vertcomp = ComparePlanePoints(plane, polyhedron, scratch.Comp);
+	if (vertcomp == 1)
+	{
+		inside = polyhedron;
+		return;
+	}
+
+	if (vertcomp == -1)
+	{
+		outside = polyhedron;
+		return;
+	}
+
+	// 1. Outside part keeps the opposite vertices. Vertices in plane stay in both.
+	scratch.FlippedComp.resize(scratch.Comp.size());
+	std::transform(scratch.Comp.begin(), scratch.Comp.end(), scratch.FlippedComp.begin(), [](const int c) { return -c; });
+
+	// 2. Same cut as ClipPolyhedron for each part. Points on the crossing edges are computed by the first one.
+	scratch.EdgePointMap.clear();
+
+	inside = polyhedron;
+	CutPolyhedron(inside, plane, scratch.Comp, scratch, &scratch.EdgePointMap);
+
+	outside = polyhedron;
+	CutPolyhedron(outside, plane, scratch.FlippedComp, scratch, &scratch.EdgePointMap);
+
+	if (inside.size() < 4)
+		inside.clear();
+
+	if (outside.size() < 4)
+		outside.clear();
+}
+
+// Below this many cells, PartitionPolyhedron clips the part by each cell directly.
+static constexpr int c_partitionLeafCellCnt = 4;
+
+// Convex cell of PartitionPolyhedron.
+struct PartitionCell
+{
+	std::vector<Poly::Plane>	Planes;
+	Poly::Vector3				MinBB;
+	Poly::Vector3				MaxBB;
+};
+
+// Side of the bounds of the cell against the plane, 1 inside, -1 outside, 0 crossing.
+// Cells only crossing by their bounds are sorted out after the split, by CellMissBB.
+static int ComparePlaneCell(const Poly::Plane& plane, const PartitionCell& cell, const float tolerance)
+{
+	const float bbMin[3] = { cell.MinBB.x, cell.MinBB.y, cell.MinBB.z };
+	const float bbMax[3] = { cell.MaxBB.x, cell.MaxBB.y, cell.MaxBB.z };
+
+	float minDist, maxDist;
+	Poly::PlaneBBDistance(&plane, 1, bbMin, bbMax, &minDist, &maxDist);
+
+	return maxDist <= tolerance ? 1 : minDist >= -tolerance ? -1 : 0;
+}
+
+// True if the cell does not reach the box. The axes and the faces of the cell are tested as separating planes.
+static bool CellMissBB(const PartitionCell& cell, const float* bbMin, const float* bbMax, const float tolerance)
+{
+	if (cell.MaxBB.x < bbMin[0] - tolerance || cell.MaxBB.y < bbMin[1] - tolerance || cell.MaxBB.z < bbMin[2] - tolerance ||
+		cell.MinBB.x > bbMax[0] + tolerance || cell.MinBB.y > bbMax[1] + tolerance || cell.MinBB.z > bbMax[2] + tolerance)
+		return true;
+
+	for (const Poly::Plane& plane : cell.Planes)
+	{
+		float minDist, maxDist;
+		Poly::PlaneBBDistance(&plane, 1, bbMin, bbMax, &minDist, &maxDist);
+		if (minDist > tolerance)
+			return true;
+	}
+
+	return false;
+}
+
+static void ComputeBB(const Poly::Polyhedron& polyhedron, float* bbMin, float* bbMax)
+{
+	const auto x = std::minmax_element(polyhedron.X.begin(), polyhedron.X.end());
+	const auto y = std::minmax_element(polyhedron.Y.begin(), polyhedron.Y.end());
+	const auto z = std::minmax_element(polyhedron.Z.begin(), polyhedron.Z.end());
+
+	bbMin[0] = *x.first;	bbMax[0] = *x.second;
+	bbMin[1] = *y.first;	bbMax[1] = *y.second;
+	bbMin[2] = *z.first;	bbMax[2] = *z.second;
+}
+
+// 1. Cells out of the bounds of the polyhedron are dropped, the last few cells clip it alone.
+// 2. Among the faces of the cell nearest to the center of the bounds, the plane crossing the fewest cells,
+//    and then splitting them most evenly, is picked.
+// 3. Cells crossing the plane go to the part they reach, or clip the polyhedron directly if they reach both.
+static void PartitionNode(Poly::Polyhedron& polyhedron, const std::vector<PartitionCell>& cellVec, std::vector<int>& activeVec,
+						  std::vector<Poly::Polyhedron>& partVec)
+{
+	using Poly::Vector3;
+
+	if (polyhedron.empty() || activeVec.empty())
+		return;
+
+	float bbMin[3], bbMax[3];
+	ComputeBB(polyhedron, bbMin, bbMax);
+	const Vector3 minBB(bbMin[0], bbMin[1], bbMin[2]), maxBB(bbMax[0], bbMax[1], bbMax[2]);
+
+	// Relative to the size and to the position, the cut vertices are only that close to the plane.
+	const float tolerance = 1e-5f * ((maxBB - minBB).Length() + std::max(Vector3::Max(-minBB, maxBB).Length(), 1.0f));
+
+	// 1.
+	std::erase_if(activeVec, [&](const int a) { return CellMissBB(cellVec[a], bbMin, bbMax, tolerance); });
+
+	const auto clipDirect = [&](const int a)
+	{
+		partVec[a] = polyhedron;
+		Poly::ClipPolyhedron(partVec[a], cellVec[a].Planes);
+	};
+
+	if (activeVec.size() <= c_partitionLeafCellCnt)
+	{
+		for (const int a : activeVec)
+			clipDirect(a);
+		return;
+	}
+
+	// 2.
+	const Vector3 center = (minBB + maxBB) * 0.5f;
+	const int nearest = *std::min_element(activeVec.begin(), activeVec.end(), [&](const int a, const int b)
+										  {
+											  return Vector3::DistanceSquared((cellVec[a].MinBB + cellVec[a].MaxBB) * 0.5f, center) <
+													 Vector3::DistanceSquared((cellVec[b].MinBB + cellVec[b].MaxBB) * 0.5f, center);
+										  });
+
+	int bestPlane = -1;
+	int bestCost = std::numeric_limits<int>::max();
+	std::vector<int> sideVec(activeVec.size());
+	std::vector<int> bestSideVec;
+	for (int p = 0; p < cellVec[nearest].Planes.size(); p++)
+	{
+		const Poly::Plane& plane = cellVec[nearest].Planes[p];
+
+		float minDist, maxDist;
+		Poly::PlaneBBDistance(&plane, 1, bbMin, bbMax, &minDist, &maxDist);
+		if (minDist > -tolerance || maxDist < tolerance)
+			continue;
+
+		int insideCnt = 0, outsideCnt = 0, crossCnt = 0;
+		for (int k = 0; k < activeVec.size(); k++)
+		{
+			sideVec[k] = activeVec[k] == nearest ? 1 : ComparePlaneCell(plane, cellVec[activeVec[k]], tolerance);
+			insideCnt += sideVec[k] == 1;
+			outsideCnt += sideVec[k] == -1;
+			crossCnt += sideVec[k] == 0;
+		}
+
+		// Both sides must lose a cell, or the recursion does not end. Crossing cells may all go to one side.
+		if (outsideCnt == 0)
+			continue;
+
+		const int cost = 2 * crossCnt + std::abs(insideCnt - outsideCnt);
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestPlane = p;
+			bestSideVec = sideVec;
+		}
+	}
+
+	// The polyhedron is inside the nearest cell, or no face of it separates the others.
+	if (bestPlane == -1)
+	{
+		for (const int a : activeVec)
+			clipDirect(a);
+		return;
+	}
+
+	// 3.
+	Poly::Polyhedron inside, outside;
+	Poly::SplitPolyhedron(polyhedron, cellVec[nearest].Planes[bestPlane], inside, outside);
+
+	float inMin[3], inMax[3], outMin[3], outMax[3];
+	if (!inside.empty())
+		ComputeBB(inside, inMin, inMax);
+	if (!outside.empty())
+		ComputeBB(outside, outMin, outMax);
+
+	std::vector<int> insideVec, outsideVec;
+	for (int k = 0; k < activeVec.size(); k++)
+	{
+		const int a = activeVec[k];
+		if (bestSideVec[k] != 0)
+		{
+			(bestSideVec[k] == 1 ? insideVec : outsideVec).push_back(a);
+			continue;
+		}
+
+		const bool reachInside = !inside.empty() && FALSE == CellMissBB(cellVec[a], inMin, inMax, tolerance);
+		const bool reachOutside = !outside.empty() && FALSE == CellMissBB(cellVec[a], outMin, outMax, tolerance);
+		if (TRUE == reachInside && TRUE == reachOutside)
+			clipDirect(a);
+		else if (TRUE == reachInside)
+			insideVec.push_back(a);
+		else if (TRUE == reachOutside)
+			outsideVec.push_back(a);
+	}
+
+	polyhedron = Poly::Polyhedron();
+
+	PartitionNode(inside, cellVec, insideVec, partVec);
+	PartitionNode(outside, cellVec, outsideVec, partVec);
+}
+
+std::vector<Poly::Polyhedron> Poly::PartitionPolyhedron(const Polyhedron& polyhedron, const std::vector<VMACH::Polygon3D>& cellVec, std::span<const int> cellIndexVec)
+{
+	std::vector<PartitionCell> partitionCellVec(cellIndexVec.size());
+	for (int k = 0; k < cellIndexVec.size(); k++)
+	{
+		PartitionCell& cell = partitionCellVec[k];
+		cell.MinBB = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+		cell.MaxBB = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (const VMACH::PolygonFace& face : cellVec[cellIndexVec[k]].FaceVec)
+		{
+			cell.Planes.push_back(face.FacePlane);
+			for (const Vector3& v : face.VertexVec)
+			{
+				cell.MinBB = Vector3::Min(cell.MinBB, v);
+				cell.MaxBB = Vector3::Max(cell.MaxBB, v);
+			}
+		}
+	}
+
+	std::vector<Polyhedron> partVec(cellIndexVec.size());
+	std::vector<int> activeVec(cellIndexVec.size());
+	std::iota(activeVec.begin(), activeVec.end(), 0);
+
+	Polyhedron root = polyhedron;
+	PartitionNode(root, partitionCellVec, activeVec, partVec);
+
+	return partVec;
+}
+
 void Poly::Translate(Polyhedron& polyhedron, const Vector3& v)
 {
-	for (auto& i : polyhedron)
-		i.Position += v;
+	for (float& x : polyhedron.X) x += v.x;
+	for (float& y : polyhedron.Y) y += v.y;
+	for (float& z : polyhedron.Z) z += v.z;
 }
 
 void Poly::Scale(Polyhedron& polyhedron, const Vector3& v)
 {
-	for (auto& i : polyhedron)
-		i.Position *= v;
+	for (float& x : polyhedron.X) x *= v.x;
+	for (float& y : polyhedron.Y) y *= v.y;
+	for (float& z : polyhedron.Z) z *= v.z;
 }
 
 void Poly::Transform(Polyhedron& polyhedron, const DirectX::XMMATRIX& matrix)
 {
 	const DirectX::XMMATRIX mat = XMMatrixTranspose(matrix);
-	for (Poly::Vertex& vert : polyhedron)
-		vert.Position = XMVector3TransformCoord(vert.Position, mat);
+	for (int i = 0; i < polyhedron.size(); i++)
+		polyhedron.SetPosition(i, XMVector3TransformCoord(polyhedron.Position(i), mat));
 }
 
 Poly::Polyhedron Poly::GetBB()
@@ -610,7 +1003,7 @@ Poly::Polyhedron Poly::GetBB()
 		{4, 6, 3}
 	};
 
-	std::vector<Poly::Vertex> poly;
+	Poly::Polyhedron poly;
 	Poly::InitPolyhedron(poly, points, neighbors);
 
 	return poly;
@@ -622,18 +1015,18 @@ void Poly::RenderPolyhedronNormal(std::vector<VertexNormalColor>& vertexData,
 								  bool isConvex, 
 								  Vector3 color)
 {
-	const auto faceVec = *Poly::ExtractFaces(poly);
+	const auto faceVec = Poly::ExtractFaces(poly);
 	for (int i = 0; i < faceVec.size(); i++)
 	{
 		VMACH::PolygonFace f = { isConvex };
 		for (int j = 0; j < faceVec[i].size(); j++)
-			f.AddVertex(poly[faceVec[i][j]].Position);
+			f.AddVertex(poly.Position(faceVec[i][j]));
 
 		if (FALSE == isConvex)
 		{
-			const Vector3 a = poly[faceVec[i][0]].Position;
-			const Vector3 b = poly[faceVec[i][1]].Position;
-			const Vector3 c = poly[faceVec[i][2]].Position;
+			const Vector3 a = poly.Position(faceVec[i][0]);
+			const Vector3 b = poly.Position(faceVec[i][1]);
+			const Vector3 c = poly.Position(faceVec[i][2]);
 
 			Vector3 normal = (b - a).Cross(c - a);
 
@@ -650,21 +1043,21 @@ void Poly::RenderPolyhedronNormal(std::vector<VertexNormalColor>& vertexData,
 void Poly::RenderPolyhedronNormal(std::vector<VertexNormalColor>& vertexData,
 								  std::vector<uint32_t>& indexData,
 								  const Polyhedron& poly,
-								  const Extract* extract,
+								  const Extract& extract,
 								  bool isConvex,
 								  Vector3 color)
 {
-	for (const auto& faceInfo : *extract)
+	for (const auto faceInfo : extract)
 	{
 		VMACH::PolygonFace f = { isConvex };
 		for (int j = 0; j < faceInfo.size(); j++)
-			f.AddVertex(poly[faceInfo[j]].Position);
+			f.AddVertex(poly.Position(faceInfo[j]));
 
 		if (FALSE == isConvex)
 		{
-			const Vector3 a = poly[faceInfo[0]].Position;
-			const Vector3 b = poly[faceInfo[1]].Position;
-			const Vector3 c = poly[faceInfo[2]].Position;
+			const Vector3 a = poly.Position(faceInfo[0]);
+			const Vector3 b = poly.Position(faceInfo[1]);
+			const Vector3 c = poly.Position(faceInfo[2]);
 
 			Vector3 normal = (b - a).Cross(c - a);
 
@@ -681,21 +1074,19 @@ void Poly::RenderPolyhedronNormal(std::vector<VertexNormalColor>& vertexData,
 void Poly::RenderPolyhedron(std::vector<VertexNormalColor>& vertexData, 
 							std::vector<uint32_t>& indexData, 
 							const Polyhedron& poly, 
-							const Extract* extract, 
+							const Extract& extract, 
 							bool isConvex, 
 							Vector3 color)
 {
 	const size_t vertexOffset = vertexData.size();
 
-	vertexData.resize(vertexOffset + poly.size());
-	std::transform(poly.begin(), 
-				   poly.end(), 
-				   std::next(vertexData.begin(), vertexOffset), 
-				   [&color](const Poly::Vertex& vert) { return VertexNormalColor(vert.Position, DirectX::XMFLOAT3(), color); });
+	vertexData.reserve(vertexOffset + poly.size());
+	for (int i = 0; i < poly.size(); i++)
+		vertexData.push_back(VertexNormalColor(poly.Position(i), DirectX::XMFLOAT3(), color));
 
 	if (TRUE == isConvex)
 	{
-		for (const auto& f : *extract)
+		for (const auto f : extract)
 		{
 			for (int v = 1; v < f.size() - 1; v++)
 			{
@@ -707,7 +1098,7 @@ void Poly::RenderPolyhedron(std::vector<VertexNormalColor>& vertexData,
 	}
 	else
 	{
-		for (const auto& f : *extract)
+		for (const auto f : extract)
 			for (const int v : EarClipping(poly, f))
 				indexData.push_back(vertexOffset + f[v]);
 	}
@@ -724,44 +1115,163 @@ int Poly::ComparePlanePoint(const Plane& plane, const Vector3& point)
 
 int Poly::ComparePlaneBB(const Plane& plane, const double xmin, const double ymin, const double zmin, const double xmax, const double ymax, const double zmax)
 {
-	const auto c1 = ComparePlanePoint(plane, Vector3(xmin, ymin, zmin));
-	const auto c2 = ComparePlanePoint(plane, Vector3(xmax, ymin, zmin));
-	const auto c3 = ComparePlanePoint(plane, Vector3(xmax, ymax, zmin));
-	const auto c4 = ComparePlanePoint(plane, Vector3(xmin, ymax, zmin));
-	const auto c5 = ComparePlanePoint(plane, Vector3(xmin, ymin, zmax));
-	const auto c6 = ComparePlanePoint(plane, Vector3(xmax, ymin, zmax));
-	const auto c7 = ComparePlanePoint(plane, Vector3(xmax, ymax, zmax));
-	const auto c8 = ComparePlanePoint(plane, Vector3(xmin, ymax, zmax));
-	const auto cmin = std::min(c1, std::min(c2, std::min(c3, std::min(c4, std::min(c5, std::min(c6, std::min(c7, c8)))))));
-	const auto cmax = std::max(c1, std::max(c2, std::max(c3, std::max(c4, std::max(c5, std::max(c6, std::max(c7, c8)))))));
-
-	if (cmin >= 0)
+	const float bbMin[3] = { (float)xmin, (float)ymin, (float)zmin };
+	const float bbMax[3] = { (float)xmax, (float)ymax, (float)zmax };
+
+	float minDist, maxDist;
+	PlaneBBDistance(&plane, 1, bbMin, bbMax, &minDist, &maxDist);
+
+	return ComparePlaneBB(minDist, maxDist);
+}
+
+int Poly::ComparePlaneBB(const float minDist, const float maxDist)
+{
+	// Same result as testing all 8 corners with ComparePlanePoint.
+	if (maxDist < c_planeEpsilon)
 		return 1;
-	else if (cmax <= 0)
+	else if (minDist > -c_planeEpsilon)
+		return -1;
+	else
+		return 0;
+}
+
+void Poly::PlaneBBDistance(const Plane* planes, const size_t count, const float* bbMin, const float* bbMax, float* minDist, float* maxDist)
+{
+	static_assert(sizeof(Plane) == 4 * sizeof(float));
+
+	// Per axis, the smaller and larger of the two products pick the nearest and farthest corner.
+	// The sum is done in the same order as ComparePlanePoint, so the distances match the corner test exactly.
+	size_t p = 0;
+
+#ifdef POLY_USE_SSE
+	const __m128 loX = _mm_set1_ps(bbMin[0]), loY = _mm_set1_ps(bbMin[1]), loZ = _mm_set1_ps(bbMin[2]);
+	const __m128 hiX = _mm_set1_ps(bbMax[0]), hiY = _mm_set1_ps(bbMax[1]), hiZ = _mm_set1_ps(bbMax[2]);
+	for (; p + 4 <= count; p += 4)
+	{
+		// Four planes at once, transposed to nx / ny / nz / d.
+		__m128 nx = _mm_loadu_ps(&planes[p + 0].x);
+		__m128 ny = _mm_loadu_ps(&planes[p + 1].x);
+		__m128 nz = _mm_loadu_ps(&planes[p + 2].x);
+		__m128 d = _mm_loadu_ps(&planes[p + 3].x);
+		_MM_TRANSPOSE4_PS(nx, ny, nz, d);
+
+		const __m128 x0 = _mm_mul_ps(nx, loX), x1 = _mm_mul_ps(nx, hiX);
+		const __m128 y0 = _mm_mul_ps(ny, loY), y1 = _mm_mul_ps(ny, hiY);
+		const __m128 z0 = _mm_mul_ps(nz, loZ), z1 = _mm_mul_ps(nz, hiZ);
+
+		_mm_storeu_ps(minDist + p, _mm_add_ps(d, _mm_add_ps(_mm_add_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_min_ps(z0, z1))));
+		_mm_storeu_ps(maxDist + p, _mm_add_ps(d, _mm_add_ps(_mm_add_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_max_ps(z0, z1))));
+	}
+#endif
+
+	for (; p < count; ++p)
+	{
+		const Plane& plane = planes[p];
+		const float x0 = plane.x * bbMin[0], x1 = plane.x * bbMax[0];
+		const float y0 = plane.y * bbMin[1], y1 = plane.y * bbMax[1];
+		const float z0 = plane.z * bbMin[2], z1 = plane.z * bbMax[2];
+
+		minDist[p] = plane.w + (std::min(x0, x1) + std::min(y0, y1) + std::min(z0, z1));
+		maxDist[p] = plane.w + (std::max(x0, x1) + std::max(y0, y1) + std::max(z0, z1));
+	}
+}
+
+int Poly::ComparePlanePoints(const Plane& plane, const Polyhedron& polyhedron, std::vector<int>& compVec)
+{
+	const int n = polyhedron.size();
+	compVec.resize(n);
+
+	const float nx = plane.x, ny = plane.y, nz = plane.z, d = plane.w;
+	const float* px = polyhedron.X.data();
+	const float* py = polyhedron.Y.data();
+	const float* pz = polyhedron.Z.data();
+	int* comp = compVec.data();
+
+	// Bit set when any vertex is kept / clipped.
+	int kept = 0;
+	int clipped = 0;
+	int i = 0;
+
+	// Lanes compute comp as float (kept - clipped), then convert.
+#ifdef POLY_USE_AVX
+	{
+		const __m256 vnx = _mm256_set1_ps(nx), vny = _mm256_set1_ps(ny), vnz = _mm256_set1_ps(nz), vd = _mm256_set1_ps(d);
+		const __m256 veps = _mm256_set1_ps(c_planeEpsilon), vneps = _mm256_set1_ps(-c_planeEpsilon), vone = _mm256_set1_ps(1.0f);
+		__m256 anyKept = _mm256_setzero_ps(), anyClipped = _mm256_setzero_ps();
+		for (; i + 8 <= n; i += 8)
+		{
+			const __m256 dist = _mm256_add_ps(vd, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vnx, _mm256_loadu_ps(px + i)),
+																				_mm256_mul_ps(vny, _mm256_loadu_ps(py + i))),
+																  _mm256_mul_ps(vnz, _mm256_loadu_ps(pz + i))));
+			const __m256 k = _mm256_cmp_ps(dist, vneps, _CMP_LE_OQ);
+			const __m256 c = _mm256_cmp_ps(dist, veps, _CMP_GE_OQ);
+
+			_mm256_storeu_si256((__m256i*)(comp + i), _mm256_cvtps_epi32(_mm256_sub_ps(_mm256_and_ps(k, vone), _mm256_and_ps(c, vone))));
+			anyKept = _mm256_or_ps(anyKept, k);
+			anyClipped = _mm256_or_ps(anyClipped, c);
+		}
+		kept |= _mm256_movemask_ps(anyKept);
+		clipped |= _mm256_movemask_ps(anyClipped);
+	}
+#endif
+
+#ifdef POLY_USE_SSE
+	{
+		const __m128 vnx = _mm_set1_ps(nx), vny = _mm_set1_ps(ny), vnz = _mm_set1_ps(nz), vd = _mm_set1_ps(d);
+		const __m128 veps = _mm_set1_ps(c_planeEpsilon), vneps = _mm_set1_ps(-c_planeEpsilon), vone = _mm_set1_ps(1.0f);
+		__m128 anyKept = _mm_setzero_ps(), anyClipped = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 dist = _mm_add_ps(vd, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vnx, _mm_loadu_ps(px + i)),
+																	 _mm_mul_ps(vny, _mm_loadu_ps(py + i))),
+														  _mm_mul_ps(vnz, _mm_loadu_ps(pz + i))));
+			const __m128 k = _mm_cmple_ps(dist, vneps);
+			const __m128 c = _mm_cmpge_ps(dist, veps);
+
+			_mm_storeu_si128((__m128i*)(comp + i), _mm_cvtps_epi32(_mm_sub_ps(_mm_and_ps(k, vone), _mm_and_ps(c, vone))));
+			anyKept = _mm_or_ps(anyKept, k);
+			anyClipped = _mm_or_ps(anyClipped, c);
+		}
+		kept |= _mm_movemask_ps(anyKept);
+		clipped |= _mm_movemask_ps(anyClipped);
+	}
+#endif
+
+	for (; i < n; ++i)
+	{
+		const float sgndist = d + (nx * px[i] + ny * py[i] + nz * pz[i]);
+		comp[i] = std::abs(sgndist) < c_planeEpsilon ? 0 : (sgndist < 0 ? 1 : -1);
+		kept |= comp[i] == 1;
+		clipped |= comp[i] == -1;
+	}
+
+	if (0 == kept)
 		return -1;
+	else if (0 == clipped)
+		return 1;
 	else
 		return 0;
 }
 
-Poly::Vector3 Poly::PlaneLineIntersection(const typename Vector3& a, const typename Vector3& b, const Plane& plane)
+Poly::Vector3 Poly::PlaneLineIntersection(const Vector3& a, const Vector3& b, const Plane& plane)
 {
 	const auto asgndist = plane.D() + plane.Normal().Dot(a);
 	const auto bsgndist = plane.D() + plane.Normal().Dot(b);
 	return ((a * bsgndist) - (b * asgndist)) / (bsgndist - asgndist);
 }
 
-bool Poly::IsCCW(const Polyhedron& polyhedron, const std::vector<int>& face, const Vector3& normal)
+bool Poly::IsCCW(const Polyhedron& polyhedron, std::span<const int> face, const Vector3& normal)
 {
-	Vector3 P = polyhedron[face[0]].Position;
+	Vector3 P = polyhedron.Position(face[0]);
 	Vector3 S;
 
 	for (int v = 0; v < face.size(); v++)
-		S += (polyhedron[face[v]].Position - P).Cross(polyhedron[face[(v + 1) % face.size()]].Position - P);
+		S += (polyhedron.Position(face[v]) - P).Cross(polyhedron.Position(face[(v + 1) % face.size()]) - P);
 
 	return S.Dot(normal) < 0;
 }
 
-std::vector<int> Poly::EarClipping(const Polyhedron& polyhedron, const std::vector<int>& face)
+std::vector<int> Poly::EarClipping(const Polyhedron& polyhedron, std::span<const int> face)
 {
 	struct VertexNode
 	{
@@ -784,9 +1294,9 @@ std::vector<int> Poly::EarClipping(const Polyhedron& polyhedron, const std::vect
 		return triangles;
 	}
 
-	const Vector3 a = polyhedron[face[0]].Position;
-	const Vector3 b = polyhedron[face[1]].Position;
-	const Vector3 c = polyhedron[face[2]].Position;
+	const Vector3 a = polyhedron.Position(face[0]);
+	const Vector3 b = polyhedron.Position(face[1]);
+	const Vector3 c = polyhedron.Position(face[2]);
 	Vector3 normal = (b - a).Cross(c - a);
 	if (TRUE == IsCCW(polyhedron, face, normal))
 		normal = -normal;
@@ -795,9 +1305,9 @@ std::vector<int> Poly::EarClipping(const Polyhedron& polyhedron, const std::vect
 
 	const auto isReflex = [&](const VertexNode& vertex)
 	{
-		const Vector3& a = polyhedron[face[vertex.Prev->Index]].Position;
-		const Vector3& b = polyhedron[face[vertex.Index]].Position;
-		const Vector3& c = polyhedron[face[vertex.Next->Index]].Position;
+		const Vector3 a = polyhedron.Position(face[vertex.Prev->Index]);
+		const Vector3 b = polyhedron.Position(face[vertex.Index]);
+		const Vector3 c = polyhedron.Position(face[vertex.Next->Index]);
 
 		return !VMACH::OnYourRight(a, b, c, normal);
 	};
@@ -830,9 +1340,9 @@ std::vector<int> Poly::EarClipping(const Polyhedron& polyhedron, const std::vect
 		if (TRUE == vertex.IsReflex)
 			return false;
 
-		const Vector3& a = polyhedron[face[vertex.Prev->Index]].Position;
-		const Vector3& b = polyhedron[face[vertex.Index]].Position;
-		const Vector3& c = polyhedron[face[vertex.Next->Index]].Position;
+		const Vector3 a = polyhedron.Position(face[vertex.Prev->Index]);
+		const Vector3 b = polyhedron.Position(face[vertex.Index]);
+		const Vector3 c = polyhedron.Position(face[vertex.Next->Index]);
 
 		for (auto itr = reflexVertices.begin(); itr != reflexVertices.end(); itr++)
 		{
@@ -841,15 +1351,15 @@ std::vector<int> Poly::EarClipping(const Polyhedron& polyhedron, const std::vect
 			if (index == vertex.Prev->Index || index == vertex.Next->Index)
 				continue;
 
-			if (polyhedron[face[index]].Position == a || polyhedron[face[index]].Position == b || polyhedron[face[index]] == c)
+			if (polyhedron.Position(face[index]) == a || polyhedron.Position(face[index]) == b || polyhedron.Position(face[index]) == c)
 				continue;
 
 			// Check any point is inside or not.
-			if (FALSE == VMACH::OnYourRight(a, b, polyhedron[face[index]].Position, normal))
+			if (FALSE == VMACH::OnYourRight(a, b, polyhedron.Position(face[index]), normal))
 				continue;
-			if (FALSE == VMACH::OnYourRight(b, c, polyhedron[face[index]].Position, normal))
+			if (FALSE == VMACH::OnYourRight(b, c, polyhedron.Position(face[index]), normal))
 				continue;
-			if (FALSE == VMACH::OnYourRight(c, a, polyhedron[face[index]].Position, normal))
+			if (FALSE == VMACH::OnYourRight(c, a, polyhedron.Position(face[index]), normal))
 				continue;
 
 			return false;
@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#ifdef SURTR_PROFILE
+
+#include <fstream>
+
+namespace
+{
+
+struct Event
+{
+	const char*	Name;
+	int64_t		Arg;
+	int64_t		BeginNs;
+	int64_t		EndNs;
+};
+
+static constexpr int c_chunkEventCnt = 4096;
+
+// Only the owner thread appends. Readers see the events below Count, which is published after they are written.
+struct Chunk
+{
+	Event				EventArr[c_chunkEventCnt];
+	std::atomic<int>	Count = 0;
+	std::atomic<Chunk*>	Next = nullptr;
+};
+
+struct ThreadBuffer
+{
+	int						ThreadID;
+	std::string				Name;
+
+	// Capture the events belong to. The owner rewinds the buffer on its first event of a new capture.
+	std::atomic<uint32_t>	Generation = 0;
+	Chunk					Head;
+	Chunk*					Tail = &Head;
+
+	// Free once its thread exits, a new thread takes it over.
+	std::atomic<bool>		InUse = true;
+
+	~ThreadBuffer()
+	{
+		for (Chunk* chunk = Head.Next.load(); chunk != nullptr;)
+		{
+			Chunk* next = chunk->Next.load();
+			delete chunk;
+			chunk = next;
+		}
+	}
+};
+
+struct Registry
+{
+	std::mutex									Mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>>	BufferVec;
+
+	std::atomic<bool>							Capturing = false;
+	std::atomic<uint32_t>						Generation = 0;
+	std::chrono::steady_clock::time_point		Origin = std::chrono::steady_clock::now();
+};
+
+// Never destroyed, the buffers are released by threads which may exit after the static destructors.
+Registry& GetRegistry()
+{
+	static Registry* registry = new Registry();
+	return *registry;
+}
+
+// Releases the buffer of the thread when it exits.
+struct ThreadSlot
+{
+	ThreadBuffer* Buffer = nullptr;
+
+	~ThreadSlot()
+	{
+		if (Buffer != nullptr)
+			Buffer->InUse.store(false, std::memory_order_release);
+	}
+};
+
+thread_local ThreadSlot t_threadSlot;
+
+ThreadBuffer& GetThreadBuffer()
+{
+	if (t_threadSlot.Buffer != nullptr)
+		return *t_threadSlot.Buffer;
+
+	// Registration is the only locked path, once per thread.
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	for (const auto& buffer : registry.BufferVec)
+	{
+		bool inUse = false;
+		if (TRUE == buffer->InUse.compare_exchange_strong(inUse, true, std::memory_order_acq_rel))
+		{
+			t_threadSlot.Buffer = buffer.get();
+			return *t_threadSlot.Buffer;
+		}
+	}
+
+	ThreadBuffer* buffer = registry.BufferVec.emplace_back(std::make_unique<ThreadBuffer>()).get();
+	buffer->ThreadID = (int)registry.BufferVec.size() - 1;
+	buffer->Name = "Thread " + std::to_string(buffer->ThreadID);
+
+	t_threadSlot.Buffer = buffer;
+	return *buffer;
+}
+
+int64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetRegistry().Origin).count();
+}
+
+void PushEvent(const Event& e)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	const uint32_t generation = GetRegistry().Generation.load(std::memory_order_acquire);
+	if (buffer.Generation.load(std::memory_order_relaxed) != generation)
+	{
+		for (Chunk* chunk = &buffer.Head; chunk != nullptr; chunk = chunk->Next.load(std::memory_order_relaxed))
+			chunk->Count.store(0, std::memory_order_relaxed);
+
+		buffer.Tail = &buffer.Head;
+		buffer.Generation.store(generation, std::memory_order_release);
+	}
+
+	// Chunks are kept for the next captures, a full one moves to the next or a new one.
+	int count = buffer.Tail->Count.load(std::memory_order_relaxed);
+	if (count == c_chunkEventCnt)
+	{
+		Chunk* next = buffer.Tail->Next.load(std::memory_order_relaxed);
+		if (next == nullptr)
+		{
+			next = new Chunk();
+			buffer.Tail->Next.store(next, std::memory_order_release);
+		}
+
+		buffer.Tail = next;
+		count = 0;
+	}
+
+	buffer.Tail->EventArr[count] = e;
+	buffer.Tail->Count.store(count + 1, std::memory_order_release);
+}
+
+void WriteJsonString(std::ofstream& out, const std::string_view str)
+{
+	out << '"';
+	for (const char c : str)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if ((unsigned char)c < 0x20)
+			out << ' ';
+		else
+			out << c;
+	}
+	out << '"';
+}
+
+}
+
+void Profiler::BeginCapture()
+{
+	Registry& registry = GetRegistry();
+	registry.Generation.fetch_add(1, std::memory_order_acq_rel);
+	registry.Capturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture()
+{
+	GetRegistry().Capturing.store(false, std::memory_order_release);
+}
+
+bool Profiler::IsCapturing()
+{
+	return GetRegistry().Capturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(_In_ const char* name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	buffer.Name = name;
+}
+
+bool Profiler::WriteChromeTrace(_In_ const std::string& fileName)
+{
+	std::ofstream out(fileName);
+	if (FALSE == out.is_open())
+		return false;
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	const uint32_t generation = registry.Generation.load(std::memory_order_acquire);
+
+	// Complete events in microseconds, one row per thread.
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	for (const auto& buffer : registry.BufferVec)
+	{
+		out << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << buffer->ThreadID << ",\"args\":{\"name\":";
+		WriteJsonString(out, buffer->Name);
+		out << "}}";
+		first = false;
+
+		if (buffer->Generation.load(std::memory_order_acquire) != generation)
+			continue;
+
+		for (const Chunk* chunk = &buffer->Head; chunk != nullptr; chunk = chunk->Next.load(std::memory_order_acquire))
+		{
+			const int count = chunk->Count.load(std::memory_order_acquire);
+			for (int i = 0; i < count; i++)
+			{
+				const Event& e = chunk->EventArr[i];
+				out << ",\n{\"ph\":\"X\",\"name\":";
+				WriteJsonString(out, e.Name);
+				char timing[96];
+				std::snprintf(timing, sizeof(timing), ",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", buffer->ThreadID, e.BeginNs / 1000.0, (e.EndNs - e.BeginNs) / 1000.0);
+				out << timing;
+
+				if (e.Arg != INT64_MIN)
+					out << ",\"args\":{\"value\":" << e.Arg << "}";
+
+				out << "}";
+			}
+
+			if (count < c_chunkEventCnt)
+				break;
+		}
+	}
+
+	out << "\n]}\n";
+	return out.good();
+}
+
+Profiler::Zone::Zone(_In_ const char* name, _In_ const int64_t arg)
+	: m_name(name), m_arg(arg), m_beginNs(0), m_record(IsCapturing())
+{
+	if (TRUE == m_record)
+		m_beginNs = NowNs();
+}
+
+Profiler::Zone::~Zone()
+{
+	// Zones which started in the capture end in it, even if it is ended meanwhile.
+	if (TRUE == m_record)
+		PushEvent(Event(m_name, m_arg, m_beginNs, NowNs()));
+}
+
+#endif
@@ -1,7 +1,6 @@
 #include "pch.h"
 #include "Surtr.h"
-
-#include "voro++.hh"
+#include "Profiler.h"
 
 #define PVD_HOST "127.0.0.1"
 #define MAX_NUM_ACTOR_SHAPES 512
@@ -25,8 +24,6 @@ static PxScene*						gScene				= NULL;
 static PxMaterial*					gMaterial			= NULL;
 static PxPvd*						gPvd				= NULL;
 
-dp::thread_pool g_threadPool(16);
-
 Surtr::Surtr() noexcept :
 	m_window(nullptr),
 	m_outputWidth(1280),
@@ -68,6 +65,8 @@ int work(int t, int id)
 // Initialize the Direct3D resources required to run.
 void Surtr::InitializeD3DResources(HWND window, int width, int height, UINT modelIndex, UINT shadowMapSize, BOOL fullScreenMode)
 {
+	Profiler::SetThreadName("Main");
+
 	m_window = window;
 	m_outputWidth = std::max(width, 1);
 	m_outputHeight = std::max(height, 1);
@@ -122,6 +121,9 @@ void Surtr::InitializeD3DResources(HWND window, int width, int height, UINT mode
 // Executes the basic game loop.
 void Surtr::Tick()
 {
+	// Swap in the finished fracture before the next step.
+	CommitFractureJob();
+
 	m_timer.Tick([&]()
 	{
 		Update(m_timer);
@@ -249,8 +251,7 @@ void Surtr::OnMouseDown()
 	UpdateDynamicMesh(m_impactPointMesh, vertices, m_impactPointMesh->IndexData);
 
 	if (TRUE == m_executeFractureImmediate)
-		for (PxRigidActor* rigidBody : m_affectRigidBodyVec)
-			ExecuteFractureRoutine(rigidBody);
+		SubmitFractureJob(m_affectRigidBodyVec);
 }
 
 // Updates the world.
@@ -586,17 +587,29 @@ void Surtr::Render()
 					ImGui::Dummy(ImVec2(0.0f, 10.0f));
 
 					ImGui::SliderInt("Seed", &m_fractureArgs.Seed, 0, 100000);
+					ImGui::Combo("Refitting", (int*)&m_fractureArgs.Refitting, "ICH\0" "6-DOP\0" "14-DOP\0" "18-DOP\0" "26-DOP\0");
+					ImGui::Combo("Voronoi", (int*)&m_fractureArgs.Voronoi, "voro++\0" "Delaunay Dual\0");
+					ImGui::Combo("Convex Fracture", (int*)&m_fractureArgs.ConvexFracture, "Clip\0" "voro++ Wall\0");
+					ImGui::Checkbox("Recursive Split", &m_fractureArgs.RecursiveSplit);
+					ImGui::SliderFloat("K-DOP Normal Tolerance", &m_fractureArgs.KdopNormalTolerance, 0.0f, 0.2f);
 
 					ImGui::Dummy(ImVec2(0.0f, 10.0f));
 
 					if (ImGui::Button("Simulate!"))
-					{
-						for (PxRigidActor* rigidBody : m_affectRigidBodyVec)
-							ExecuteFractureRoutine(rigidBody);
-					}
+						SubmitFractureJob(m_affectRigidBodyVec);
+
+					if (TRUE == m_fractureJob.Result.valid())
+						ImGui::TextColored(ImVec4(1, 1, 0, 1), "Fracturing...");
+
+#ifdef SURTR_PROFILE
+					// Written to SurtrTrace.json, open it with chrome://tracing or Perfetto.
+					ImGui::Checkbox("Trace Next Fracture", &m_captureTrace);
+#endif
 
 					ImGui::Text("[Results]");
 					ImGui::Text("ICH Face Count: %d", m_fractureResult.ICHFaceCnt);
+					ImGui::Text("ICH Discarded Point Count: %d", m_fractureResult.ICHDiscardedPointCnt);
+					ImGui::Text("ACH Eliminated Plane Count: %d", m_fractureResult.ACHEliminatedPlaneCnt);
 
 					if (m_fractureResult.ACHErrorPointCnt == 0)
 						ImGui::TextColored(ImVec4(0, 1, 0, 1), "ALL VERTEX CONTAINED");
@@ -605,6 +618,39 @@ void Surtr::Render()
 
 					ImGui::Dummy(ImVec2(0.0f, 20.0f));
 
+					ImGui::Text("[Thread Pool]");
+					ImGui::SliderInt("Threads (0 = Auto)", &m_threadCnt, 0, 64);
+					ImGui::Checkbox("Pin Threads", &m_pinThreads);
+
+					if (ImGui::Button("Apply") && FALSE == m_fractureJob.Result.valid())
+						g_threadPool.reset(m_threadCnt, m_pinThreads);
+
+					ImGui::SameLine();
+					if (ImGui::Button("Reset Stats"))
+						g_threadPool.reset_stats();
+
+					// Tasks run and stolen by each worker, to see how the work is balanced.
+					const std::vector<dp::worker_stats> statsVec = g_threadPool.stats();
+					for (int i = 0; i < statsVec.size(); i++)
+					{
+						const dp::worker_stats& stats = statsVec[i];
+						ImGui::Text("#%-2d Tasks %6llu / Stolen %6llu / Idle %9.1f ms / Queue %3zu (Max %zu)", i,
+									(unsigned long long)stats.tasks_executed, (unsigned long long)stats.tasks_stolen,
+									std::chrono::duration<double, std::milli>(stats.idle_time).count(), stats.queue_depth, stats.max_queue_depth);
+					}
+
+					ImGui::Dummy(ImVec2(0.0f, 20.0f));
+
+					// Pieces of the compounds which are replaced are released, the slots should stop growing over repeated impacts.
+					ImGui::Text("[Piece Store]");
+					if (FALSE == m_fractureJob.Result.valid())
+						m_pieceStoreStats = m_fractureEngine.GetPieceStore().GetStats();
+
+					ImGui::Text("Live Pieces %zu / Slots %zu", m_pieceStoreStats.LivePieceCnt, m_pieceStoreStats.SlotCnt);
+					ImGui::Text("Live %.3f MB / Total %.3f MB", m_pieceStoreStats.LiveBytes / (1024.0 * 1024.0), m_pieceStoreStats.TotalBytes / (1024.0 * 1024.0));
+
+					ImGui::Dummy(ImVec2(0.0f, 20.0f));
+
 					ImGui::SliderFloat("Rotate speed", &m_camRotateSpeed, 0.0f, 1.0f);
 					ImGui::Text("Move speed: %.3f (Scroll to Adjust)", m_camMoveSpeed);
 
@@ -1433,86 +1479,34 @@ void Surtr::CreateCommandListDependentResources()
 		m_dynamicMeshPool.push(mesh);
 	}
 
-	m_initCompoundTask = [this](const Piece* piece, const Extract* extract, bool renderConvex) -> std::pair<PxConvexMeshGeometry, DynamicMesh*>
+	m_initCompoundTask = [this](const Piece* piece, bool renderConvex) -> PreparedPiece
 	{
-		std::vector<VertexNormalColor> vertexData;
-		std::vector<uint32_t> indexData;
+		PROFILE_SCOPE("InitPiece");
+
+		PreparedPiece prepared;
 
 		if (TRUE == renderConvex)
-			Poly::RenderPolyhedron(vertexData, indexData, piece->Convex, extract, true);
+			Poly::RenderPolyhedron(prepared.VertexData, prepared.IndexData, piece->GetConvex(), piece->GetConvexCache().Faces, true);
 		else
-			Poly::RenderPolyhedron(vertexData, indexData, piece->Mesh, Poly::ExtractFaces(piece->Mesh), false);
-
-		return std::make_pair(CookingConvex(piece, extract), PrepareDynamicMeshResource(vertexData, indexData, true));
-	};
-
-	m_refittingTask = [this](Piece* piece) -> void
-	{
-		Kdop::KdopContainer kdop(GenerateICHNormal(piece->Mesh, std::min((int)piece->Mesh.size(), m_fractureArgs.RefittingPointLimit)));
-		kdop.Calc(piece->Mesh);
-
-		piece->Convex = kdop.ClipWithPolyhedron(piece->Convex);
-	};
-
-	m_fractureTask = [this](const VMACH::Polygon3D& voroPoly, const std::vector<Piece*>& targetPieceVec, const std::set<int>& outside) -> std::vector<Piece*>
-	{
-		std::vector<Piece*> localDecompose;
-
-		for (int c = 0; c < targetPieceVec.size(); c++)
-		{
-			if (TRUE == outside.contains(c))
-				continue;
-
-			Poly::Polyhedron convex = Poly::ClipPolyhedron(targetPieceVec[c]->Convex, voroPoly);
-			if (convex.empty())
-				continue;
-
-			Poly::Polyhedron mesh = Poly::ClipPolyhedron(targetPieceVec[c]->Mesh, voroPoly);
-			if (mesh.empty())
-				continue;
-
-			const auto groupVec = CheckMeshIsland(mesh);
-			if (groupVec.size() >= 2)
-			{
-				for (const auto& group : groupVec)
-				{
-					Poly::Polyhedron island;
-					std::unordered_map<int, int> mapping;
-
-					for (const int iVert : group)
-					{
-						int oldIndex = island.size();
-						mapping[iVert] = oldIndex;
-
-						island.push_back(mesh[iVert]);
-					}
+			Poly::RenderPolyhedron(prepared.VertexData, prepared.IndexData, piece->GetMesh(), piece->GetMeshCache().Faces, false);
 
-					for (auto& vert : island)
-						for (int& iAdj : vert.NeighborVertexVec)
-							iAdj = mapping[iAdj];
-
-					localDecompose.push_back(new Piece(convex, island));
-				}
-			}
-			else
-			{
-				localDecompose.push_back(new Piece(convex, mesh));
-			}
-		}
+		prepared.Geometry = CookingConvex(piece);
 
-		return localDecompose;
+		return prepared;
 	};
 
 	// Sphere point cloud.
 	{
 		LoadModelData("Resources\\Models\\sphere.obj", XMFLOAT3(0.5, 0.5, 0.5), XMFLOAT3(0, 0, 0), m_sphereVertexData, m_sphereIndexData);
 
-		m_spherePointCloud = std::vector<Vector3>(m_sphereVertexData.size());
+		std::vector<Vector3> spherePointCloud(m_sphereVertexData.size());
 		std::transform(m_sphereVertexData.begin(), 
 					   m_sphereVertexData.end(), 
-					   m_spherePointCloud.begin(), 
+					   spherePointCloud.begin(), 
 					   [](const VertexNormalColor& vnc) { return vnc.Position; });
 
+		m_fractureEngine.SetSpherePointCloud(spherePointCloud);
+
 		m_impactPointMesh = PrepareDynamicMeshResource(m_sphereVertexData, m_sphereIndexData);
 	}
 
@@ -1530,7 +1524,13 @@ void Surtr::CreateCommandListDependentResources()
 
 	// Set initial compound.
 	{
-		Compound initialCompound = PrepareFracture(objectVertexData, objectIndexData);
+		std::vector<Vector3> objectVertices(objectVertexData.size());
+		std::transform(objectVertexData.begin(), objectVertexData.end(), objectVertices.begin(), [](const VertexNormalColor& vertex) { return vertex.Position; });
+
+		m_fractureEngine.GetArgs() = m_fractureArgs;
+		Compound initialCompound = m_fractureEngine.PrepareFracture(objectVertices, objectIndexData);
+		m_fractureResult = m_fractureEngine.GetResult();
+
 		InitCompound(initialCompound, false, PxVec3(0, 5, 0));
 	}
 
@@ -1644,6 +1644,27 @@ void Surtr::GetAdapter(IDXGIAdapter1** ppAdapter) const
 
 void Surtr::OnDeviceLost()
 {
+	// The running fracture cooks with the physics released below, its result is dropped.
+	if (TRUE == m_fractureJob.Result.valid())
+	{
+		for (const std::vector<PreparedCompound>& preparedVec : m_fractureJob.Result.get())
+		{
+			for (const PreparedCompound& prepared : preparedVec)
+			{
+				m_fractureEngine.GetPieceStore().Release(prepared.Fractured);
+
+				for (const PreparedPiece& piece : prepared.PieceVec)
+					if (piece.Geometry.convexMesh != nullptr)
+						piece.Geometry.convexMesh->release();
+			}
+		}
+
+		m_fractureJob = FractureJob();
+	}
+
+	if (TRUE == Profiler::IsCapturing())
+		Profiler::EndCapture();
+
 	// imgui
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
@@ -1684,16 +1705,8 @@ void Surtr::OnDeviceLost()
 	}
 
 	// Compounds.
-	for (auto& compound : m_fractureStorage.CompoundVec)
-	{
-		for (Piece* piece : compound.PieceVec)
-			if (piece != nullptr)
-				delete piece;
-
-		for (Extract* extract : compound.PieceExtractedConvex)
-			if (extract != nullptr)
-				delete extract;
-	}
+	for (const Compound& compound : m_fractureStorage.CompoundVec)
+		m_fractureEngine.GetPieceStore().Release(compound);
 
 	// Textures
 	m_colorLTexResource.Reset();
@@ -1744,160 +1757,56 @@ void Surtr::OnDeviceLost()
 	CreateCommandListDependentResources();
 }
 
-Surtr::Compound Surtr::PrepareFracture(_In_ const std::vector<VertexNormalColor>& visualMeshVertices, _In_ const std::vector<uint32_t>& visualMeshIndices)
+void Surtr::SubmitFractureJob(const std::vector<physx::PxRigidActor*>& targetRigidBodyVec)
 {
-	// 1. Create intermediate convex hull with limit count.
-	std::vector<Vector3> vertices(visualMeshVertices.size());
-	std::transform(visualMeshVertices.begin(), visualMeshVertices.end(), vertices.begin(), [](const VertexNormalColor& vertex) { return vertex.Position; });
-
-	// 2. Collect ICH face normals.
-	std::vector<Vector3> ichFaceNormalVec = GenerateICHNormal(vertices, m_fractureArgs.ICHIncludePointLimit);
-	m_fractureResult.ICHFaceCnt = ichFaceNormalVec.size();
-
-	// 3. Calculate bounding box.
-	double minX, maxX, minY, maxY, minZ, maxZ;
-	{
-		const auto x = std::minmax_element(vertices.begin(), vertices.end(), [](const Vector3& p1, const Vector3& p2) { return p1.x < p2.x; });
-		const auto y = std::minmax_element(vertices.begin(), vertices.end(), [](const Vector3& p1, const Vector3& p2) { return p1.y < p2.y; });
-		const auto z = std::minmax_element(vertices.begin(), vertices.end(), [](const Vector3& p1, const Vector3& p2) { return p1.z < p2.z; });
-
-		minX = (*x.first).x;    maxX = (*x.second).x;
-		minY = (*y.first).y;    maxY = (*y.second).y;
-		minZ = (*z.first).z;    maxZ = (*z.second).z;
-	}
-
-	m_fractureStorage.BBCenter = Vector3((maxX + minX) / 2.0, (maxY + minY) / 2.0, (maxZ + minZ) / 2.0);
-	m_fractureStorage.MinBB = Vector3(minX, minY, minZ);
-	m_fractureStorage.MaxBB = Vector3(maxX, maxY, maxZ);
-	m_fractureStorage.MaxAxisScale = std::max(std::max(maxX - minX, maxY - minY), maxZ - minZ);
-
-	// 4. Calculate min/max plane for k-DOP generation.
-	Kdop::KdopContainer achKdop(ichFaceNormalVec);
-	achKdop.Calc(vertices, m_fractureStorage.MaxAxisScale, m_fractureArgs.ACHPlaneGapInverse);
-
-	// 5. Init bounding box polygon.
-	Poly::Polyhedron achPolyhedron = Poly::GetBB();
-	Poly::Scale(achPolyhedron, Vector3((maxX - minX), (maxY - minY), (maxZ - minZ)));
-	Poly::Scale(achPolyhedron, Vector3(2.0, 2.0, 2.0));
-	Poly::Translate(achPolyhedron, m_fractureStorage.BBCenter);
-
-	// 6. Clip ACH polygon with clipping faces.
-	achPolyhedron = achKdop.ClipWithPolyhedron(achPolyhedron);
-
-	// 7. Init Mesh Polygon.
-	Poly::Polyhedron meshPolyhedron;
+	if (TRUE == m_fractureJob.Result.valid())
 	{
-		std::vector<int> indices(visualMeshIndices.size());
-		std::transform(visualMeshIndices.begin(), visualMeshIndices.end(), indices.begin(), [](const uint32_t i) { return (int)i; });
-
-		const std::vector<std::vector<int>> nei = Poly::ExtractNeighborFromMesh(vertices, indices);
-		Poly::InitPolyhedron(meshPolyhedron, vertices, nei);
-	}
-
-	// 8. Voronoi diagram generation for initial decomposition.
-	std::vector<VMACH::Polygon3D> voroPolyVec = GenerateVoronoi(m_fractureArgs.InitialDecomposeCellCnt);
-	for (VMACH::Polygon3D& voro : voroPolyVec)
-	{
-		voro.Scale(Vector3((maxX - minX), (maxY - minY), (maxZ - minZ)));
-		voro.Translate(m_fractureStorage.BBCenter);
+		OutputDebugStringW(L"Fracture is still running!\n");
+		return;
 	}
 
-	// 9. Generate Fracture Pattern.
-	m_fractureStorage.PartialFracturePattern = GenerateFracturePattern(m_fractureArgs.PartialFracturePatternCellCnt, m_fractureArgs.PartialFracturePatternDist);
-	m_fractureStorage.GeneralFracturePattern = GenerateFracturePattern(m_fractureArgs.GeneralFracturePatternCellCnt, m_fractureArgs.GeneralFracturePatternDist);
-
-	// 10. Generate initial pieces.
-	Compound preCompound = Compound({ new Piece(achPolyhedron, meshPolyhedron) }, { Poly::ExtractFaces(achPolyhedron) });
-	CompoundInfo initial = ApplyFracture(preCompound, voroPolyVec, m_spherePointCloud);
-	
-	Refitting(initial.PieceVec);
-	SetExtract(initial);
-
-	Compound result;
-	for (const auto& iComp : initial.CompoundBind)
+	// Snapshot the bodies. A body touched by several shapes is listed once.
+	m_fractureJob.TargetVec.clear();
+	for (PxRigidActor* targetRigidBody : targetRigidBodyVec)
 	{
-		for (const int iPiece : iComp)
+		auto itr = std::find(m_fractureStorage.RigidDynamicVec.begin(), m_fractureStorage.RigidDynamicVec.end(), targetRigidBody);
+		if (itr == m_fractureStorage.RigidDynamicVec.end())
 		{
-			result.PieceVec.push_back(initial.PieceVec[iPiece]);
-			result.PieceExtractedConvex.push_back(initial.PieceExtractedConvex[iPiece]);
+			OutputDebugStringW(L"Impact point is not valid!\n");
+			continue;
 		}
-	}
 
-	return result;
-}
-
-void Surtr::ExecuteFractureRoutine(physx::PxRigidActor* targetRididBody)
-{
-	auto itr = std::find(m_fractureStorage.RigidDynamicVec.begin(), m_fractureStorage.RigidDynamicVec.end(), targetRididBody);
-	if (itr != m_fractureStorage.RigidDynamicVec.end())
-	{
-		TIMER_INIT;
-		TIMER_START;
+		if (m_fractureJob.TargetVec.end() != std::find_if(m_fractureJob.TargetVec.begin(), m_fractureJob.TargetVec.end(),
+														  [&](const FractureTarget& target) { return target.RigidBody == targetRigidBody; }))
+			continue;
 
 		int targetIndex = std::distance(m_fractureStorage.RigidDynamicVec.begin(), itr);
 
-		// Get world transform matrix range.
+		// Get world transform matrix of target compound.
 		int startID = 0;
 		for (int i = 0; i < targetIndex; i++)
 			startID += m_fractureStorage.CompoundVec[i].PieceVec.size();
-		int endID = startID + m_fractureStorage.CompoundVec[targetIndex].PieceVec.size() - 1;
-
-		// Apply world transform matrix to target compound.
-		for (int j = 0; j < m_fractureStorage.CompoundVec[targetIndex].PieceVec.size(); j++)
-		{
-			Piece* piece = m_fractureStorage.CompoundVec[targetIndex].PieceVec[j];
-			Poly::Transform(piece->Convex, m_structuredBufferData[startID + j].WorldMatrix);
-			Poly::Transform(piece->Mesh, m_structuredBufferData[startID + j].WorldMatrix);
-		}
-
-		// Do fracture.
-		std::vector<Compound> fracturedCompoundVec = DoFracture(m_fractureStorage.CompoundVec[targetIndex]);
-
-		// Destroy target rigidbody.
-		gScene->removeActor(*targetRididBody);
-		m_fractureStorage.RigidDynamicVec.erase(std::next(m_fractureStorage.RigidDynamicVec.begin(), targetIndex));
-
-		// Destroy target mesh. Also Re-cycle mesh buffer.
-		for (DynamicMesh* mesh : m_fractureStorage.CompoundMeshVec[targetIndex])
-		{
-			mesh->Clean();
-			m_dynamicMeshPool.push(mesh);
-		}
-		m_fractureStorage.CompoundMeshVec.erase(std::next(m_fractureStorage.CompoundMeshVec.begin(), targetIndex));
-
-		// Destroy piece data.
-		m_fractureStorage.CompoundVec.erase(std::next(m_fractureStorage.CompoundVec.begin(), targetIndex));
-
-		// Remove world matrix of target compound mesh.
-		m_structuredBufferData.erase(std::next(m_structuredBufferData.begin(), startID), std::next(m_structuredBufferData.begin(), endID + 1));
-
-		for (Compound& compound : fracturedCompoundVec)
-			InitCompound(compound, false);
 
-		OutputDebugStringWFormat(L"\n\nTotal Elapsed: ");
-		TIMER_STOP_PRINT;
-		OutputDebugStringWFormat(L"\n\n");
+		m_fractureJob.TargetVec.push_back(FractureTarget(targetRigidBody, targetRigidBody->getGlobalPose(),
+														 m_structuredBufferData[startID].WorldMatrix, m_fractureStorage.CompoundVec[targetIndex]));
 	}
-	else
-		OutputDebugStringW(L"Impact point is not valid!\n");
-}
 
-std::vector<Surtr::Compound> Surtr::DoFracture(const Compound& targetCompound)
-{
-	std::vector<VMACH::Polygon3D> localFracturePattern = m_fractureArgs.PartialFracture ? m_fractureStorage.PartialFracturePattern : m_fractureStorage.GeneralFracturePattern;
-	std::vector<Vector3> localSpherePointCloud = m_spherePointCloud;
+	if (m_fractureJob.TargetVec.empty())
+		return;
 
-	// Scale.
-	for (VMACH::Polygon3D& voro : localFracturePattern)
-		voro.Scale(Vector3(m_fractureStorage.MaxAxisScale, m_fractureStorage.MaxAxisScale, m_fractureStorage.MaxAxisScale) * 2);
+	// One trace per requested fracture, written once it is committed.
+	if (TRUE == m_captureTrace)
+		Profiler::BeginCapture();
 
-	// Alignment.
-	for (VMACH::Polygon3D& voro : localFracturePattern)
-		voro.Translate(m_fractureArgs.ImpactPosition);
+	// The job reads the arguments of the engine, which are not touched until it is committed.
+	m_fractureEngine.GetArgs() = m_fractureArgs;
 
+	// Show fracture pattern boundary.
 	{
+		const float maxAxisScale = m_fractureEngine.GetStorage().MaxAxisScale;
+
 		Poly::Polyhedron cube = Poly::GetBB();
-		Poly::Scale(cube, Vector3(m_fractureStorage.MaxAxisScale, m_fractureStorage.MaxAxisScale, m_fractureStorage.MaxAxisScale) * 2);
+		Poly::Scale(cube, Vector3(maxAxisScale, maxAxisScale, maxAxisScale) * 2);
 		Poly::Translate(cube, m_fractureArgs.ImpactPosition);
 
 		std::vector<VertexNormalColor> vertexData;
@@ -1907,554 +1816,143 @@ std::vector<Surtr::Compound> Surtr::DoFracture(const Compound& targetCompound)
 		UpdateDynamicMesh(m_patternBoundaryMesh, vertexData, indexData);
 	}
 
-	// Align sphere point cloud.
-	for (auto& v : localSpherePointCloud)
+	// Not on the thread pool, the fracture itself waits for its tasks.
+	m_fractureJob.Result = std::async(std::launch::async, [this, targetVec = m_fractureJob.TargetVec]()
 	{
-		v *= m_fractureArgs.ImpactRadius;
-		v += m_fractureArgs.ImpactPosition;
-	}
-
-	TIMER_INIT;
-	TIMER_START_NAME(L"ApplyFracture\t\t");
+		Profiler::SetThreadName("Fracture Job");
+		PROFILE_SCOPE("FractureJob");
 
-	// 11. Apply fracture pattern.
-	CompoundInfo second = ApplyFracture(targetCompound, localFracturePattern, localSpherePointCloud, m_fractureArgs.PartialFracture);
-	SetExtract(second);
+		const auto jobStart = std::chrono::steady_clock::now();
 
-	TIMER_STOP_PRINT;
-	TIMER_START_NAME(L"MergeOutOfImpact\t\t");
-
-	if (TRUE == m_fractureArgs.PartialFracture)
-		MergeOutOfImpact(second, localSpherePointCloud);
-
-	TIMER_STOP_PRINT;
-	TIMER_START_NAME(L"HandleConvexIsland\t\t");
-
-	HandleConvexIsland(second);
-
-	TIMER_STOP_PRINT;
-	TIMER_START_NAME(L"Refitting\t\t");
-
-	Refitting(second.PieceVec);
-	SetExtract(second);
-
-	TIMER_STOP_PRINT;
-
-	std::vector<Compound> result;
-	for (const auto& iComp : second.CompoundBind)
-	{
-		std::vector<Piece*> pieceVec;
-		std::vector<Extract*> extractVec;
-
-		for (const int iPiece : iComp)
+		std::vector<std::vector<PreparedCompound>> resultVec(targetVec.size());
+		for (int t = 0; t < targetVec.size(); t++)
 		{
-			pieceVec.push_back(second.PieceVec[iPiece]);
-			extractVec.push_back(second.PieceExtractedConvex[iPiece]);
-		}
-
-		result.push_back(Compound(pieceVec, extractVec));
-	}
-
-	return result;
-}
-
-std::vector<Vector3> Surtr::GenerateICHNormal(_In_ const std::vector<Vector3>& vertices, _In_ const int ichIncludePointLimit) const
-{
-	VMACH::ConvexHull ich(vertices, ichIncludePointLimit);
-
-	std::vector<Vector3> ichFaceNormalVec;
-	for (const VMACH::ConvexHullFace& f : ich.GetFaces())
-	{
-		Vector3 normal = (f.Vertices[1] - f.Vertices[0]).Cross(f.Vertices[2] - f.Vertices[0]);
-		normal.Normalize();
-		ichFaceNormalVec.push_back(normal);
-	}
-
-	return ichFaceNormalVec;
-}
-
-std::vector<Vector3> Surtr::GenerateICHNormal(_In_ const Poly::Polyhedron& polyhedron, _In_ const int ichIncludePointLimit) const
-{
-	std::vector<Vector3> vertices(polyhedron.size());
-	std::transform(polyhedron.begin(), polyhedron.end(), vertices.begin(), [](const Poly::Vertex& vert) { return vert.Position; });
-
-	return GenerateICHNormal(vertices, ichIncludePointLimit);
-}
-
-std::vector<VMACH::Polygon3D> Surtr::GenerateVoronoi(_In_ const int cellCount) const
-{
-	std::vector<Vector3> cellPointVec;
-
-	std::mt19937 gen(m_fractureArgs.Seed);
-	std::uniform_real_distribution<double> uniformDist(-0.5, 0.5);
-
-	double x, y, z;
-	for (int i = 0; i < cellCount; i++)
-	{
-		x = uniformDist(gen);
-		y = uniformDist(gen);
-		z = uniformDist(gen);
-		cellPointVec.emplace_back(x, y, z);
-	}
-
-	return GenerateVoronoi(cellPointVec);
-}
-
-std::vector<VMACH::Polygon3D> Surtr::GenerateVoronoi(_In_ const std::vector<Vector3>& cellPointVec) const
-{
-	std::vector<VMACH::Polygon3D> voroPolyVec;
+			const FractureTarget& target = targetVec[t];
 
-	voro::container voroCon(
-		-0.5, +0.5,
-		-0.5, +0.5,
-		-0.5, +0.5,
-		8, 8, 8, false, false, false, 8);
+			// 1. Pieces of the target stay as they are while it is simulated, the copies are moved to the world space.
+			Fracture::PieceStore& pieceStore = m_fractureEngine.GetPieceStore();
 
-	for (int i = 0; i < cellPointVec.size(); i++)
-		voroCon.put(i, cellPointVec[i].x, cellPointVec[i].y, cellPointVec[i].z);
-
-	int id;
-	voro::voronoicell_neighbor voroCell;
-	std::vector<int> neighborVec;
-
-	voro::c_loop_all cl(voroCon);
-	int dimension = 0;
-	if (cl.start()) do if (voroCon.compute_cell(voroCell, cl))
-	{
-		dimension += 1;
-	} while (cl.inc());
-
-	double x, y, z;
-	int counter = 0;
-	if (cl.start()) do if (voroCon.compute_cell(voroCell, cl))
-	{
-		cl.pos(x, y, z);
-		id = cl.pid();
-
-		std::vector<int> cellFaceVec;
-		std::vector<double> cellVertices;
-
-		voroCell.neighbors(neighborVec);
-		voroCell.face_vertices(cellFaceVec);
-
-		voroCell.vertices(x, y, z, cellVertices);
-
-		VMACH::Polygon3D voroPoly = { true };
-
-		int cur = 0;
-		while (cur < cellFaceVec.size())
-		{
-			VMACH::PolygonFace face = { true };
-
-			int cnt = cellFaceVec[cur];
-			for (int i = 0; i < cnt; i++)
+			Compound worldCompound;
+			for (const PieceHandle handle : target.Target.PieceVec)
 			{
-				int vertIndex = cellFaceVec[cur + i + 1];
-				face.AddVertex(Vector3(
-					cellVertices[3 * vertIndex],
-					cellVertices[3 * vertIndex + 1],
-					cellVertices[3 * vertIndex + 2]));
+				const Piece* piece = pieceStore.Get(handle);
+				const PieceHandle worldPiece = pieceStore.Create(piece->GetConvex(), piece->GetMesh());
+				pieceStore.Get(worldPiece)->Transform(target.WorldMatrix);
+				worldCompound.PieceVec.push_back(worldPiece);
 			}
-			cur += cnt + 1;
-
-			face.Rewind();
-			voroPoly.AddFace(face);
-		}
-
-		voroPolyVec.push_back(voroPoly);
-
-		counter += 1;
-	} while (cl.inc());
-
-	return voroPolyVec;
-}
-
-std::vector<VMACH::Polygon3D> Surtr::GenerateFracturePattern(_In_ const int cellCount, _In_ const double mean) const
-{
-	std::vector<Vector3> cellPointVec;
-
-	std::mt19937 gen(m_fractureArgs.Seed);
-	std::uniform_real_distribution<double> directionUniformDist(-1.0, 1.0);
-	std::exponential_distribution<double> lengthExpDist(1.0 / mean);
-
-	for (int i = 0; i < cellCount; i++)
-	{
-		double len = std::max(std::min(lengthExpDist(gen), 0.5), 1e-12);
-
-		double x = directionUniformDist(gen);
-		double y = directionUniformDist(gen);
-		double z = directionUniformDist(gen);
-
-		Vector3 v = Vector3(x, y, z);
-		v.Normalize();
-		v *= len;
 
-		cellPointVec.push_back(v);
-	}
-
-	return GenerateVoronoi(cellPointVec);
-}
-
-Surtr::CompoundInfo Surtr::ApplyFracture(_In_ const Compound& compound,
-										 _In_ const std::vector<VMACH::Polygon3D>& voroPolyVec,
-										 _In_ const std::vector<Vector3>& spherePointCloud,
-										 _In_ bool partial) const
-{
-	std::vector<Piece*> decompose;
-	std::vector<std::set<int>> bind;
-
-	const std::vector<Piece*>& targetPieceVec = compound.PieceVec;
-	const std::vector<Extract*>& extractVec = compound.PieceExtractedConvex;
-
-	// Check convex located at outside or not.
-	std::set<int> outside;
-	std::set<int> outsideBind;
-	if (TRUE == partial)
-	{
-		for (int c = 0; c < targetPieceVec.size(); c++)
-		{
-			if (TRUE == ConvexOutOfSphere(targetPieceVec[c]->Convex, extractVec[c], spherePointCloud, m_fractureArgs.ImpactPosition, m_fractureArgs.ImpactRadius))
+			// 2. Do fracture.
+			//    Each piece is cooked and gets its render data as soon as it is refitted.
+			std::mutex preparedMutex;
+			std::unordered_map<const Piece*, PreparedPiece> preparedPieceMap;
+			const auto pieceTask = [this, &preparedMutex, &preparedPieceMap](const Piece* piece)
 			{
-				outside.insert(c);
-
-				outsideBind.insert(decompose.size());
-				decompose.push_back(targetPieceVec[c]);
-			}
-		}
-	}
-
-	// 0-th element is reserved.
-	bind.push_back(outsideBind);
-
-	std::vector<std::future<std::vector<Piece*>>> futures;
-	for (int i = 0; i < voroPolyVec.size(); i++)
-		futures.push_back(g_threadPool.enqueue(m_fractureTask, voroPolyVec[i], targetPieceVec, outside));
-
-	for (int i = 0; i < futures.size(); i++)
-	{
-		std::vector<Piece*> localDecompose = futures[i].get();
-
-		int offset = decompose.size();
-		decompose.insert(decompose.end(), localDecompose.begin(), localDecompose.end());
-		
-		std::set<int> localBind;
-		for (int x = offset; x < offset + localDecompose.size(); x++)
-			localBind.insert(x);
-
-		if (FALSE == localBind.empty())
-			bind.push_back(localBind);
-	}
+				PreparedPiece prepared = m_initCompoundTask(piece, false);
 
-	return CompoundInfo(decompose, {}, bind);
-}
-
-void Surtr::SetExtract(_Inout_ CompoundInfo& preResult) const
-{
-	preResult.PieceExtractedConvex.resize(preResult.PieceVec.size(), nullptr);
-	std::transform(preResult.PieceVec.begin(), preResult.PieceVec.end(), preResult.PieceExtractedConvex.begin(), [](const Piece* p) { return Poly::ExtractFaces(p->Convex); });
-}
-
-void Surtr::_MeshIslandLoop(const int index, const Poly::Polyhedron& mesh, std::set<int>& group) const
-{
-	std::vector<int> search;
-	for (const int iAdj : mesh[index].NeighborVertexVec)
-	{
-		const auto res = group.insert(iAdj);
-		if (TRUE == res.second)
-			search.push_back(iAdj);
-	}
-
-	for (const int iSearch : search)
-		_MeshIslandLoop(iSearch, mesh, group);
-}
+				std::lock_guard<std::mutex> lock(preparedMutex);
+				preparedPieceMap[piece] = std::move(prepared);
+			};
 
-std::vector<std::set<int>> Surtr::CheckMeshIsland(_In_ const Poly::Polyhedron& polyhedron) const
-{
-	std::vector<std::set<int>> groupVec;
-	std::set<int> exclude;
+			std::vector<Compound> fracturedCompoundVec = m_fractureEngine.DoFracture(worldCompound, pieceTask);
 
-	int iArbitPoint = 0;
-	while (TRUE)
-	{
-		std::set<int> group;
-		_MeshIslandLoop(iArbitPoint, polyhedron, group);
+			for (const Fracture::FractureStage& stage : m_fractureEngine.GetResult().StageVec)
+				OutputDebugStringWFormat(L"%S\t\t%f\n", stage.Name, stage.ElapsedMs);
 
-		groupVec.push_back(group);
-		exclude.insert(group.begin(), group.end());
+			// 3. Copies out of the impact are kept by the result.
+			pieceStore.ReleaseReplaced(worldCompound, fracturedCompoundVec);
 
-		bool remain = false;
-		for (int v = 0; v < polyhedron.size(); v++)
-		{
-			if (FALSE == exclude.contains(v))
+			// 4. Gather the prepared pieces.
+			for (Compound& compound : fracturedCompoundVec)
 			{
-				remain = true;
-				iArbitPoint = v;
-				break;
+				std::vector<PreparedPiece> preparedPieceVec;
+				for (const PieceHandle handle : compound.PieceVec)
+				{
+					const Piece* piece = pieceStore.Get(handle);
+					auto prepared = preparedPieceMap.find(piece);
+					preparedPieceVec.push_back(prepared != preparedPieceMap.end() ? std::move(prepared->second) : m_initCompoundTask(piece, false));
+				}
+
+				resultVec[t].push_back(PreparedCompound(compound, std::move(preparedPieceVec)));
 			}
 		}
 
-		if (FALSE == remain)
-			break;
-	}
+		OutputDebugStringWFormat(L"\n\nTotal Elapsed: %f\n\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - jobStart).count());
 
-	return groupVec;
+		return resultVec;
+	});
 }
 
-void Surtr::HandleConvexIsland(_Inout_ CompoundInfo& compoundInfo) const
+void Surtr::CommitFractureJob()
 {
-	// FaceNode struct is only needed for this function.
-	struct FaceNode
-	{
-		int						CID;
-		double					AbsD;
-		Plane					FacePlane;
-		std::vector<Vector3>	FacePoints;
-	};
+	if (FALSE == m_fractureJob.Result.valid() || m_fractureJob.Result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
 
-	std::vector<std::set<int>> newBind;
+	std::vector<std::vector<PreparedCompound>> resultVec = m_fractureJob.Result.get();
+	m_fractureResult = m_fractureEngine.GetResult();
 
-	for (auto& localBind : compoundInfo.CompoundBind)
+	for (int t = 0; t < m_fractureJob.TargetVec.size(); t++)
 	{
-		if (localBind.size() <= 1)
-			continue;
+		const FractureTarget& target = m_fractureJob.TargetVec[t];
 
-		std::vector<FaceNode> nodes;
-		for (const int cid : localBind)
+		auto itr = std::find(m_fractureStorage.RigidDynamicVec.begin(), m_fractureStorage.RigidDynamicVec.end(), target.RigidBody);
+		if (itr == m_fractureStorage.RigidDynamicVec.end())
 		{
-			for (const auto& poly : *compoundInfo.PieceExtractedConvex[cid])
+			// Result is dropped with the target.
+			for (const PreparedCompound& prepared : resultVec[t])
 			{
-				std::vector<Vector3> points(poly.size());
-				std::transform(poly.begin(), poly.end(), points.begin(), [&](const int v) { return compoundInfo.PieceVec[cid]->Convex[v].Position; });
+				m_fractureEngine.GetPieceStore().Release(prepared.Fractured);
 
-				Plane p(points[0], points[1], points[2]);
-				nodes.push_back(FaceNode(cid, std::abs(p.D()), p, points));
+				for (const PreparedPiece& piece : prepared.PieceVec)
+					if (piece.Geometry.convexMesh != nullptr)
+						piece.Geometry.convexMesh->release();
 			}
-		}
-
-		std::sort(nodes.begin(), nodes.end(), [](const FaceNode& a, const FaceNode& b) { return a.AbsD < b.AbsD; });
-
-		std::unordered_map<int, std::set<int>> nei;
-		for (const int cid : localBind)
-			nei[cid] = std::set<int>();
-
-		for (int i = 0; i < nodes.size() - 1; i++)
-		{
-			bool lowerBoundFound = false;
-			for (int j = i + 1; j < nodes.size(); j++)
-			{
-				if (TRUE == lowerBoundFound && (nodes[i].AbsD > nodes[j].AbsD))
-					break;
-
-				// Approximatly check planes are equal or not.
-				if (std::abs(nodes[i].AbsD - nodes[j].AbsD) > 1e-3)
-					continue;
-
-				lowerBoundFound = true;
-
-				Vector3 in = nodes[i].FacePlane.Normal();
-				Vector3 jn = nodes[j].FacePlane.Normal();
-				in.Normalize(); jn.Normalize();
-
-				// Normals should be opposite.
-				bool oppositeNormal = std::abs(1 + in.Dot(jn)) < 1e-4;
-				if (FALSE == oppositeNormal)
-					continue;
-
-				// Check two faces are intersect or not.
-				bool atLeastOnePointIncluded = false;
-
-				// First, check vertex of i node is contained by j node.
-				int nJPoint = nodes[j].FacePoints.size();
-				for (const Vector3& iPoint : nodes[i].FacePoints)
-				{
-					bool pointIncluded = true;
-					for (int v = 0; v < nJPoint; v++)
-					{
-						const Vector3& a = nodes[j].FacePoints[v];
-						const Vector3& b = nodes[j].FacePoints[(v + 1) % nJPoint];
-
-						if (FALSE == VMACH::OnYourRight(a, b, iPoint, jn))
-						{
-							pointIncluded = false;
-							break;
-						}
-					}
 
-					if (TRUE == pointIncluded)
-					{
-						atLeastOnePointIncluded = true;
-						break;
-					}
-				}
-
-				// Give me one more chance.
-				if (FALSE == atLeastOnePointIncluded)
-				{
-					// If no point included, check vertex of j node is contained by i node.
-					int nIPoint = nodes[i].FacePoints.size();
-					for (const Vector3& jPoint : nodes[j].FacePoints)
-					{
-						bool pointIncluded = true;
-						for (int v = 0; v < nIPoint; v++)
-						{
-							const Vector3& a = nodes[i].FacePoints[v];
-							const Vector3& b = nodes[i].FacePoints[(v + 1) % nIPoint];
-
-							if (FALSE == VMACH::OnYourRight(a, b, jPoint, in))
-							{
-								pointIncluded = false;
-								break;
-							}
-						}
-
-						if (TRUE == pointIncluded)
-						{
-							atLeastOnePointIncluded = true;
-							break;
-						}
-					}
-				}
-
-				// If all condition met, they are neighbors.
-				if (TRUE == atLeastOnePointIncluded)
-				{
-					nei[nodes[i].CID].insert(nodes[j].CID);
-					nei[nodes[j].CID].insert(nodes[i].CID);
-				}
-			}
-		}
-
-		// Flood fill.
-		std::set<int> remain;
-		remain.insert(localBind.begin(), localBind.end());
-
-		std::vector<std::set<int>> splitGroup;
-
-		while (remain.size() != 0)
-		{
-			std::set<int> split;
-
-			std::queue<int> fillQueue;
-			fillQueue.push(*remain.begin());
-
-			while (FALSE == fillQueue.empty())
-			{
-				int curr = fillQueue.front();
-				fillQueue.pop();
-
-				if (TRUE == remain.contains(curr))
-				{
-					split.insert(curr);
-					remain.erase(curr);
-
-					for (const int iAdj : nei[curr])
-						fillQueue.push(iAdj);
-				}
-			}
-
-			splitGroup.push_back(split);
-		}
-
-		if (splitGroup.size() >= 2)
-		{
-			localBind = splitGroup[0];
-			newBind.insert(newBind.end(), std::next(splitGroup.begin()), splitGroup.end());
+			continue;
 		}
-	}
 
-	compoundInfo.CompoundBind.insert(compoundInfo.CompoundBind.end(), newBind.begin(), newBind.end());
-}
+		int targetIndex = std::distance(m_fractureStorage.RigidDynamicVec.begin(), itr);
 
-void Surtr::MergeOutOfImpact(_Inout_ CompoundInfo& compoundInfo, _In_ const std::vector<Vector3>& spherePointCloud) const
-{
-	std::set<int> emptyCompound;
+		// Get world transform matrix range.
+		int startID = 0;
+		for (int i = 0; i < targetIndex; i++)
+			startID += m_fractureStorage.CompoundVec[i].PieceVec.size();
+		int endID = startID + m_fractureStorage.CompoundVec[targetIndex].PieceVec.size() - 1;
 
-	// Ignore 0-th element.
-	for (int i = 1; i < compoundInfo.CompoundBind.size(); i++)
-	{
-		auto& local = compoundInfo.CompoundBind[i];
+		// Pieces are cut where the body was at the submission, they follow where it is now.
+		const PxTransform pose = target.RigidBody->getGlobalPose() * target.Pose.getInverse();
 
-		std::set<int> outside;
-		for (const int c : local)
-		{
-			if (TRUE == ConvexOutOfSphere(compoundInfo.PieceVec[c]->Convex, compoundInfo.PieceExtractedConvex[c], spherePointCloud, m_fractureArgs.ImpactPosition, m_fractureArgs.ImpactRadius))
-				outside.insert(c);
-		}
+		// Destroy target rigidbody.
+		gScene->removeActor(*target.RigidBody);
+		m_fractureStorage.RigidDynamicVec.erase(itr);
 
-		if (FALSE == outside.empty())
+		// Destroy target mesh. Also Re-cycle mesh buffer.
+		for (DynamicMesh* mesh : m_fractureStorage.CompoundMeshVec[targetIndex])
 		{
-			std::set<int> tempLocal;
-			std::set_difference(local.begin(), local.end(), outside.begin(), outside.end(), std::inserter(tempLocal, tempLocal.end()));
-			local.swap(tempLocal);
-
-			if (TRUE == local.empty())
-				emptyCompound.insert(i);
-
-			compoundInfo.CompoundBind[0].insert(outside.begin(), outside.end());
+			mesh->Clean();
+			m_dynamicMeshPool.push(mesh);
 		}
-	}
-
-	// Clean size 0.
-	compoundInfo.CompoundBind.erase(
-		std::remove_if(std::next(compoundInfo.CompoundBind.begin()),
-					   compoundInfo.CompoundBind.end(),
-					   [](const auto& local) { return local.empty(); }),
-		compoundInfo.CompoundBind.end());
-}
+		m_fractureStorage.CompoundMeshVec.erase(std::next(m_fractureStorage.CompoundMeshVec.begin(), targetIndex));
 
-void Surtr::Refitting(_Inout_ std::vector<Piece*>& targetPieceVec) const
-{
-	std::vector<std::future<void>> futures;
-	for (int i = 0; i < targetPieceVec.size(); i++)
-		futures.push_back(g_threadPool.enqueue(m_refittingTask, targetPieceVec[i]));
+		// Destroy piece data. Result is made of the world space copies, none of the target pieces is kept.
+		m_fractureEngine.GetPieceStore().Release(m_fractureStorage.CompoundVec[targetIndex]);
+		m_fractureStorage.CompoundVec.erase(std::next(m_fractureStorage.CompoundVec.begin(), targetIndex));
 
-	for (int i = 0; i < futures.size(); i++)
-		futures[i].get();
-}
+		// Remove world matrix of target compound mesh.
+		m_structuredBufferData.erase(std::next(m_structuredBufferData.begin(), startID), std::next(m_structuredBufferData.begin(), endID + 1));
 
-bool Surtr::ConvexOutOfSphere(_In_ const Poly::Polyhedron& polyhedron,
-							  _In_ const Extract* extract,
-							  _In_ const std::vector<Vector3>& spherePointCloud,
-							  _In_ const Vector3 origin,
-							  _In_ const float radius) const
-{
-	// Approximate.
-	bool noVertexInsideSphere = true;
-	for (const auto& v : polyhedron)
-	{
-		if ((origin - v.Position).Length() < radius)
-		{
-			noVertexInsideSphere = false;
-			break;
-		}
+		PROFILE_SCOPE_ARG("CommitFractureTarget", t);
+		for (PreparedCompound& prepared : resultVec[t])
+			InitCompound(prepared.Fractured, std::move(prepared.PieceVec), pose);
 	}
 
-	if (FALSE == noVertexInsideSphere)
-		return false;
+	m_fractureJob.TargetVec.clear();
 
-	for (const auto& po : spherePointCloud)
+	if (TRUE == Profiler::IsCapturing())
 	{
-		bool contain = true;
-		for (const auto& f : *extract)
-		{
-			Vector3 normal = (polyhedron[f[1]].Position - polyhedron[f[0]].Position).Cross(polyhedron[f[2]].Position - polyhedron[f[0]].Position);
-			normal.Normalize();
-
-			float d = -polyhedron[f[0]].Position.Dot(normal);
-
-			float dist = normal.Dot(po) + d;
-			if (dist > 0)
-			{
-				contain = false;
-				break;
-			}
-		}
-
-		if (TRUE == contain)
-			return false;
+		Profiler::EndCapture();
+		Profiler::WriteChromeTrace("SurtrTrace.json");
+		m_captureTrace = false;
 	}
-
-	return true;
 }
 
 bool Surtr::ConvexRayIntersection(_In_ const VMACH::Polygon3D& convex, _In_ const Ray ray, _Out_ float& dist) const
@@ -2496,23 +1994,31 @@ bool Surtr::ConvexRayIntersection(_In_ const VMACH::Polygon3D& convex, _In_ cons
 	return hit;
 }
 
+std::vector<Surtr::PreparedPiece> Surtr::PrepareCompound(const Compound& compound, bool renderConvex)
+{
+	const Fracture::PieceStore& pieceStore = m_fractureEngine.GetPieceStore();
+	return g_threadPool.parallel_map(0, compound.PieceVec.size(), [&](const size_t i) { return m_initCompoundTask(pieceStore.Get(compound.PieceVec[i]), renderConvex); });
+}
+
 void Surtr::InitCompound(const Compound& compound, bool renderConvex, const physx::PxVec3 translate)
 {
-	PxRigidDynamic* compoundRigidBody = gPhysics->createRigidDynamic(PxTransform(translate));
+	InitCompound(compound, PrepareCompound(compound, renderConvex), PxTransform(translate));
+}
 
-	std::vector<std::future<std::pair<PxConvexMeshGeometry, DynamicMesh*>>> futures;
-	for (int i = 0; i < compound.PieceVec.size(); i++)
-		futures.push_back(g_threadPool.enqueue(m_initCompoundTask, compound.PieceVec[i], compound.PieceExtractedConvex[i], renderConvex));
+void Surtr::InitCompound(const Compound& compound, std::vector<PreparedPiece>&& preparedPieceVec, const physx::PxTransform& pose)
+{
+	PxRigidDynamic* compoundRigidBody = gPhysics->createRigidDynamic(pose);
 
-	std::vector<DynamicMesh*> meshes(futures.size());
-	for (int i = 0; i < futures.size(); i++)
+	// Mesh buffers come from the pool, which is only used by the main thread.
+	std::vector<DynamicMesh*> meshes(preparedPieceVec.size());
+	for (int i = 0; i < preparedPieceVec.size(); i++)
 	{
-		const auto result = futures[i].get();
+		const PreparedPiece& prepared = preparedPieceVec[i];
 
-		if (result.first.convexMesh != nullptr)
-			PxShape* convexShape = PxRigidActorExt::createExclusiveShape(*compoundRigidBody, result.first, *gMaterial);
-		
-		meshes[i] = result.second;
+		if (prepared.Geometry.convexMesh != nullptr)
+			PxShape* convexShape = PxRigidActorExt::createExclusiveShape(*compoundRigidBody, prepared.Geometry, *gMaterial);
+
+		meshes[i] = PrepareDynamicMeshResource(prepared.VertexData, prepared.IndexData, true);
 	}
 
 	compoundRigidBody->setContactReportThreshold(0);
@@ -2528,13 +2034,13 @@ void Surtr::InitCompound(const Compound& compound, bool renderConvex, const phys
 	m_structuredBufferData.resize(m_structuredBufferData.size() + meshes.size(), MeshSB(XMMatrixIdentity()));
 }
 
-PxConvexMeshGeometry Surtr::CookingConvex(const Piece* piece, const Extract* extract)
+PxConvexMeshGeometry Surtr::CookingConvex(const Piece* piece)
 {
-	std::vector<PxVec3> convexVertexData(piece->Convex.size());
-	std::transform(piece->Convex.begin(),
-				   piece->Convex.end(),
-				   convexVertexData.begin(),
-				   [](const Poly::Vertex& vert) { return PxVec3(vert.Position.x, vert.Position.y, vert.Position.z); });
+	const Poly::Polyhedron& convex = piece->GetConvex();
+
+	std::vector<PxVec3> convexVertexData(convex.size());
+	for (int i = 0; i < convex.size(); i++)
+		convexVertexData[i] = PxVec3(convex.X[i], convex.Y[i], convex.Z[i]);
 
 	PxConvexMeshDesc convexDesc;
 	convexDesc.points.count = convexVertexData.size();
@@ -2552,14 +2058,12 @@ PxConvexMeshGeometry Surtr::CookingConvex(const Piece* piece, const Extract* ext
 	return PxConvexMeshGeometry(convexMesh, PxMeshScale(), PxConvexMeshGeometryFlag::eTIGHT_BOUNDS);
 }
 
-PxConvexMeshGeometry Surtr::CookingConvexManual(const Poly::Polyhedron& polyhedron, const std::vector<std::vector<int>>& extract)
+PxConvexMeshGeometry Surtr::CookingConvexManual(const Poly::Polyhedron& polyhedron, const Extract& extract)
 {
 	// #TODO : Currently not working.
 	std::vector<PxVec3> convexVertexData(polyhedron.size());
-	std::transform(polyhedron.begin(), 
-				   polyhedron.end(), 
-				   convexVertexData.begin(), 
-				   [](const Poly::Vertex& vert) { return PxVec3(vert.Position.x, vert.Position.y, vert.Position.z); });
+	for (int i = 0; i < polyhedron.size(); i++)
+		convexVertexData[i] = PxVec3(polyhedron.X[i], polyhedron.Y[i], polyhedron.Z[i]);
 
 	std::vector<PxU16> convexIndexData;
 	std::vector<PxHullPolygon> convexPolygonData;
@@ -1,12 +1,16 @@
 #include "pch.h"
 #include "VMACH.h"
 
+// Extreme point search of QuickHull uses 4 lanes with SSE, scalar otherwise.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VMACH_USE_SSE
+	#include <immintrin.h>
+#endif
+
 using namespace DirectX;
 using namespace SimpleMath;
 
 const auto                      rnd = []() { return double(rand() * 0.75) / RAND_MAX; };
-std::vector<VMACH::PolygonEdge> globalEdgeContainer;
-std::vector<Vector3>            globalPointContainer;
 
 bool VMACH::PolygonFace::operator==(const PolygonFace& other)
 {
@@ -337,7 +341,7 @@ void VMACH::PolygonFace::__Reorder()
 			  });
 }
 
-VMACH::PolygonFace VMACH::PolygonFace::ClipWithPlane(const PolygonFace& inFace, const Plane& clippingPlane, std::vector<PolygonEdge>& edgeVec)
+VMACH::PolygonFace VMACH::PolygonFace::ClipWithPlane(const PolygonFace& inFace, const Plane& clippingPlane, ClipContext& context)
 {
 	PolygonFace workingFace = { inFace.GuaranteeConvex };
 	PolygonEdge clippedEdge;
@@ -440,13 +444,15 @@ VMACH::PolygonFace VMACH::PolygonFace::ClipWithPlane(const PolygonFace& inFace,
 
 		for (int i = 0; i < clippedEdge.VertexVec.size(); i++)
 		{
-			globalPointContainer.push_back(clippedEdge.VertexVec[i]);
+			if (context.DebugSink != nullptr)
+				context.DebugSink->PointVec.push_back(clippedEdge.VertexVec[i]);
+
 			OutputDebugStringWFormat(L"%.10f %.10f %.10f\n", clippedEdge.VertexVec[i].x, clippedEdge.VertexVec[i].y,
 									 clippedEdge.VertexVec[i].z);
 		}
 
-		// globalPointContainer.push_back(record1);
-		// globalPointContainer.push_back(record2);
+		// context.DebugSink->PointVec.push_back(record1);
+		// context.DebugSink->PointVec.push_back(record2);
 
 		Vector3 in;
 		VMACH::GetIntersectionPoint(record1, record2, clippingPlane, in);
@@ -457,14 +463,14 @@ VMACH::PolygonFace VMACH::PolygonFace::ClipWithPlane(const PolygonFace& inFace,
 	}
 
 	if (clippedEdge.VertexVec.size() >= 2)
-		edgeVec.push_back(clippedEdge);
+		context.EdgeVec.push_back(clippedEdge);
 
 	return (workingFace.VertexVec.size() >= 3) ? workingFace : PolygonFace(inFace.GuaranteeConvex);
 }
 
-VMACH::PolygonFace VMACH::PolygonFace::ClipWithFace(const PolygonFace& inFace, const PolygonFace& clippingFace, std::vector<PolygonEdge>& edgeVec)
+VMACH::PolygonFace VMACH::PolygonFace::ClipWithFace(const PolygonFace& inFace, const PolygonFace& clippingFace, ClipContext& context)
 {
-	return ClipWithPlane(inFace, clippingFace.FacePlane, edgeVec);
+	return ClipWithPlane(inFace, clippingFace.FacePlane, context);
 }
 
 Vector3 VMACH::Polygon3D::GetCentroid() const
@@ -547,18 +553,19 @@ bool intersection(const Vector3& a2, const Vector3& a1, const Vector3& b2, const
 	return 0 <= s && s <= 1 && 0 <= t && t <= 1;
 }
 
-VMACH::Polygon3D VMACH::Polygon3D::ClipWithPlane(const Polygon3D& inPolygon, const Plane& clippingPlane, int doTest)
+VMACH::Polygon3D VMACH::Polygon3D::ClipWithPlane(const Polygon3D& inPolygon, const Plane& clippingPlane, ClipContext& context, int doTest)
 {
 	Vector3 cn = clippingPlane.Normal();
 	cn.Normalize();
 
-	std::vector<PolygonEdge> edgeVec;
+	std::vector<PolygonEdge>& edgeVec = context.EdgeVec;
+	edgeVec.clear();
 
 	// Clip Polygon3D
 	Polygon3D outPolygon = { inPolygon.GuaranteeConvex };
 	for (int i = 0; i < inPolygon.FaceVec.size(); i++)
 	{
-		PolygonFace clippedFace = PolygonFace::ClipWithPlane(inPolygon.FaceVec[i], clippingPlane, edgeVec);
+		PolygonFace clippedFace = PolygonFace::ClipWithPlane(inPolygon.FaceVec[i], clippingPlane, context);
 
 		if (FALSE == clippedFace.GuaranteeConvex && clippedFace.VertexVec.size() >= 3)
 		{
@@ -769,7 +776,7 @@ VMACH::Polygon3D VMACH::Polygon3D::ClipWithPlane(const Polygon3D& inPolygon, con
 							e.VertexVec.push_back(closeFace.VertexVec[i]);
 							e.VertexVec.push_back(closeFace.VertexVec[i+1]);
 
-							globalEdgeContainer.push_back(e);
+							context.DebugSink->EdgeVec.push_back(e);
 						}*/
 
 						std::reverse(closeFace.VertexVec.begin(), closeFace.VertexVec.end());
@@ -850,42 +857,86 @@ VMACH::Polygon3D VMACH::Polygon3D::ClipWithPlane(const Polygon3D& inPolygon, con
 	return outPolygon;
 }
 
-VMACH::Polygon3D VMACH::Polygon3D::ClipWithFace(const Polygon3D& inPolygon, const PolygonFace& clippingFace, int doTest)
+VMACH::Polygon3D VMACH::Polygon3D::ClipWithFace(const Polygon3D& inPolygon, const PolygonFace& clippingFace, ClipContext& context, int doTest)
 {
-	return ClipWithPlane(inPolygon, clippingFace.FacePlane);
+	return ClipWithPlane(inPolygon, clippingFace.FacePlane, context);
 }
 
-VMACH::Polygon3D VMACH::Polygon3D::ClipWithPolygon(const Polygon3D& inPolygon, const Polygon3D& clippingPolygon)
+VMACH::Polygon3D VMACH::Polygon3D::ClipWithPolygon(const Polygon3D& inPolygon, const Polygon3D& clippingPolygon, ClipContext& context)
 {
 	Polygon3D outPolygon = inPolygon;
 
 	// Clip polygon for each faces from clipping polygon.
 	for (int i = 0; i < clippingPolygon.FaceVec.size(); i++)
-		outPolygon = ClipWithFace(outPolygon, clippingPolygon.FaceVec[i]);
+		outPolygon = ClipWithFace(outPolygon, clippingPolygon.FaceVec[i], context);
 
 	return outPolygon;
 }
 
-VMACH::ConvexHull::ConvexHull(const std::vector<ConvexHullVertex>& pointCloud, uint32_t limitCnt)
-	: m_pointCloud(pointCloud), m_limitCnt(limitCnt)
+VMACH::Polygon3D VMACH::Polygon3D::ClipWithPlane(const Polygon3D& inPolygon, const Plane& clippingPlane, int doTest)
+{
+	ClipContext context;
+	return ClipWithPlane(inPolygon, clippingPlane, context, doTest);
+}
+
+VMACH::Polygon3D VMACH::Polygon3D::ClipWithFace(const Polygon3D& inPolygon, const PolygonFace& clippingFace, int doTest)
+{
+	ClipContext context;
+	return ClipWithFace(inPolygon, clippingFace, context, doTest);
+}
+
+VMACH::Polygon3D VMACH::Polygon3D::ClipWithPolygon(const Polygon3D& inPolygon, const Polygon3D& clippingPolygon)
+{
+	ClipContext context;
+	return ClipWithPolygon(inPolygon, clippingPolygon, context);
+}
+
+std::vector<VMACH::Polygon3D> VMACH::Polygon3D::ClipWithPolygon(const std::vector<Polygon3D>& inPolygonVec, const Polygon3D& clippingPolygon,
+																dp::thread_pool<>& threadPool, ClipDebugSink* debugSink)
+{
+	// Each task has its own context and sink, sinks are merged afterwards.
+	std::vector<ClipDebugSink> sinkVec(debugSink != nullptr ? inPolygonVec.size() : 0);
+
+	std::vector<Polygon3D> outPolygonVec = threadPool.parallel_map(0, inPolygonVec.size(), [&](const size_t i)
+		{
+			ClipContext context;
+			context.DebugSink = sinkVec.empty() ? nullptr : &sinkVec[i];
+
+			return ClipWithPolygon(inPolygonVec[i], clippingPolygon, context);
+		});
+
+	for (const ClipDebugSink& sink : sinkVec)
+	{
+		debugSink->EdgeVec.insert(debugSink->EdgeVec.end(), sink.EdgeVec.begin(), sink.EdgeVec.end());
+		debugSink->PointVec.insert(debugSink->PointVec.end(), sink.PointVec.begin(), sink.PointVec.end());
+	}
+
+	return outPolygonVec;
+}
+
+VMACH::ConvexHull::ConvexHull(const std::vector<ConvexHullVertex>& pointCloud, uint32_t limitCnt,
+							   dp::thread_pool<>* threadPool)
+	: m_pointCloud(pointCloud), m_limitCnt(limitCnt), m_threadPool(threadPool)
 {
-	m_pointVolume = std::vector<float>(m_pointCloud.size(), 0.0f);
 	CreateConvexHull();
 }
 
-VMACH::ConvexHull::ConvexHull(const std::vector<Vector3>& pointCloud, uint32_t limitCnt) : m_limitCnt(limitCnt)
+VMACH::ConvexHull::ConvexHull(const std::vector<Vector3>& pointCloud, uint32_t limitCnt, dp::thread_pool<>* threadPool)
+	: m_limitCnt(limitCnt), m_threadPool(threadPool)
 {
 	m_pointCloud.resize(pointCloud.size());
 	std::transform(pointCloud.begin(), pointCloud.end(), m_pointCloud.begin(), [](const Vector3& v3) { return v3; });
 
-	m_pointVolume = std::vector<float>(m_pointCloud.size(), 0.0f);
 	CreateConvexHull();
 }
 
 bool VMACH::ConvexHull::Contains(const ConvexHullVertex& point) const
 {
-	for (const ConvexHullFace& f : m_faceList)
+	for (const ConvexHullFace& f : m_faceVec)
 	{
+		if (f.Visible)
+			continue;
+
 		if (Volume(f, point) <= 0)
 			return false;
 	}
@@ -893,15 +944,38 @@ bool VMACH::ConvexHull::Contains(const ConvexHullVertex& point) const
 	return true;
 }
 
-const std::list<VMACH::ConvexHullFace> VMACH::ConvexHull::GetFaces() const { return m_faceList; }
+const std::vector<VMACH::ConvexHullFace> VMACH::ConvexHull::GetFaces() const
+{
+	std::vector<ConvexHullFace> faceVec;
+	for (const ConvexHullFace& f : m_faceVec)
+	{
+		if (FALSE == f.Visible)
+			faceVec.push_back(f);
+	}
+
+	return faceVec;
+}
+
+const std::vector<VMACH::ConvexHullEdge> VMACH::ConvexHull::GetEdges() const
+{
+	std::vector<ConvexHullEdge> edgeVec;
+	for (const ConvexHullEdge& e : m_edgeVec)
+	{
+		if (FALSE == e.Remove)
+			edgeVec.push_back(e);
+	}
 
-const std::list<VMACH::ConvexHullEdge> VMACH::ConvexHull::GetEdges() const { return m_edgeList; }
+	return edgeVec;
+}
 
 void VMACH::ConvexHull::Render(std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData,
 							   Vector3 color) const
 {
-	for (const VMACH::ConvexHullFace& f : m_faceList)
+	for (const VMACH::ConvexHullFace& f : m_faceVec)
 	{
+		if (f.Visible)
+			continue;
+
 		vertexData.push_back(VertexNormalColor(f.Vertices[0], XMFLOAT3(), color));
 		vertexData.push_back(VertexNormalColor(f.Vertices[1], XMFLOAT3(), color));
 		vertexData.push_back(VertexNormalColor(f.Vertices[2], XMFLOAT3(), color));
@@ -938,99 +1012,284 @@ float VMACH::ConvexHull::Volume(const ConvexHullFace& face, const ConvexHullVert
 	return vol;
 }
 
-size_t VMACH::ConvexHull::Key2Edge(const ConvexHullVertex& p1, const ConvexHullVertex& p2)
+bool VMACH::ConvexHull::SameWinding(const ConvexHullFace& face, const ConvexHullEdge& edge)
 {
-	std::hash<std::string> sHash;
-	size_t                 h1 = sHash(std::to_string(p1.x) + std::to_string(p1.y) + std::to_string(p1.z));
-	size_t                 h2 = sHash(std::to_string(p2.x) + std::to_string(p2.y) + std::to_string(p2.z));
+	for (int i = 0; i < 3; i++)
+	{
+		if (face.VertexID[i] == edge.EndPointID[0] && face.VertexID[(i + 1) % 3] == edge.EndPointID[1])
+			return true;
+	}
 
-	return h1 ^ h2;
+	return false;
 }
 
-VMACH::ConvexHullVertex VMACH::ConvexHull::FindInnerPoint(const ConvexHullFace* face, const ConvexHullEdge& edge)
+int VMACH::ConvexHull::CreateFace(int p1, int p2, int p3, bool rewind)
 {
-	for (int i = 0; i < 3; i++)
-	{
-		if (face->Vertices[i] == edge.EndPoints[0])
-			continue;
-		if (face->Vertices[i] == edge.EndPoints[1])
-			continue;
+	const int newFace = (int)m_faceVec.size();
+
+	m_faceVec.emplace_back(m_pointCloud, p1, p2, p3);
+	m_faceConflictVec.emplace_back();
+	m_addedFaceVec.push_back(newFace);
+
+	if (rewind)
+		m_faceVec[newFace].Rewind();
+
+	m_faceVec[newFace].EdgeID[0] = CreateEdge(p1, p2, newFace);
+	m_faceVec[newFace].EdgeID[1] = CreateEdge(p1, p3, newFace);
+	m_faceVec[newFace].EdgeID[2] = CreateEdge(p2, p3, newFace);
+
+	return newFace;
+}
 
-		return face->Vertices[i];
+int VMACH::ConvexHull::CreateEdge(int p1, int p2, int newFace)
+{
+	int edge = m_edgeMap.Find(p1, p2);
+	if (edge == -1)
+	{
+		edge = (int)m_edgeVec.size();
+		m_edgeMap.Insert(p1, p2, edge);
+		m_edgeVec.emplace_back(m_pointCloud, p1, p2);
 	}
+
+	m_edgeVec[edge].LinkFace(newFace);
+
+	return edge;
+}
+
+void VMACH::ConvexHull::LinkConflict(int face, const Conflict& conflict)
+{
+	const int point = conflict.ID;
+
+	m_pointConflictPool.push_back({ face, m_pointConflictHead[point] });
+	m_pointConflictHead[point] = (int)m_pointConflictPool.size() - 1;
+	m_pointConflictCnt[point]++;
+	m_pointVolume[point] += conflict.Volume;
+
+	MarkChanged(point);
 }
 
-void VMACH::ConvexHull::CreateFace(const ConvexHullVertex& p1, const ConvexHullVertex& p2, const ConvexHullVertex& p3,
-								   const ConvexHullVertex& innerPoint)
+void VMACH::ConvexHull::MarkChanged(int point)
 {
-	m_faceList.emplace_back(p1, p2, p3);
-	ConvexHullFace& newFace = m_faceList.back();
+	if (FALSE == m_useVolumeHeap || m_pointMark[point] == (int)m_processedPointCnt)
+		return;
+
+	m_pointMark[point] = (int)m_processedPointCnt;
+	m_changedPointVec.push_back(point);
+}
+
+void VMACH::ConvexHull::CollectConflict(int newFace, int face1, int face2)
+{
+	std::vector<Conflict>& newList = m_faceConflictVec[newFace];
+
+	// Face of the first hull, test all points.
+	if (face1 == -1)
+	{
+		for (int i = 0; i < m_pointCloud.size(); i++)
+		{
+			if (m_pointCloud[i].Processed)
+				continue;
 
-	m_addedFaceVec.push_back(&newFace);
+			const float vol = Volume(m_faceVec[newFace], m_pointCloud[i]);
+			if (vol < 0)
+				newList.push_back({ i, -vol });
+		}
 
-	// If needed, rewind face.
-	if (Volume(newFace, innerPoint) < 0)
-		newFace.Rewind();
+		return;
+	}
 
-	CreateEdge(p1, p2, newFace);
-	CreateEdge(p1, p3, newFace);
-	CreateEdge(p2, p3, newFace);
+	// Only the points seeing one of the two faces around the horizon edge can see the new face.
+	// Conflict lists are sorted by point, merge them without duplicates.
+	const std::vector<Conflict>& list1 = m_faceConflictVec[face1];
+	const std::vector<Conflict>& list2 = m_faceConflictVec[face2];
+
+	size_t i = 0, j = 0;
+	while (i < list1.size() || j < list2.size())
+	{
+		int point;
+		if (j == list2.size() || (i < list1.size() && list1[i].ID < list2[j].ID))
+			point = list1[i++].ID;
+		else if (i == list1.size() || list2[j].ID < list1[i].ID)
+			point = list2[j++].ID;
+		else
+		{
+			point = list1[i].ID;
+			i++;
+			j++;
+		}
+
+		if (m_pointCloud[point].Processed)
+			continue;
+
+		const float vol = Volume(m_faceVec[newFace], m_pointCloud[point]);
+		if (vol < 0)
+			newList.push_back({ point, -vol });
+	}
 }
 
-void VMACH::ConvexHull::CreateEdge(const ConvexHullVertex& p1, const ConvexHullVertex& p2, ConvexHullFace& newFace)
+void VMACH::ConvexHull::UpdateAddedFaceConflict()
 {
-	// Get hash-key and apply to map.
-	size_t key = Key2Edge(p1, p2);
+	// Each face only writes its own list, so large clouds are split over the thread pool.
+	size_t candidateCnt = 0;
+	for (const auto& source : m_addedFaceSourceVec)
+	{
+		if (source.first == -1)
+			candidateCnt += m_pointCloud.size();
+		else
+			candidateCnt += m_faceConflictVec[source.first].size() + m_faceConflictVec[source.second].size();
+	}
 
-	if (!m_edgeMap.count(key))
+	if (m_threadPool != nullptr && m_addedFaceVec.size() > 1 && candidateCnt >= ParallelCandidateCnt)
+	{
+		m_threadPool->parallel_for(0, m_addedFaceVec.size(), [this](const size_t i)
+			{
+				CollectConflict(m_addedFaceVec[i], m_addedFaceSourceVec[i].first, m_addedFaceSourceVec[i].second);
+			});
+	}
+	else
 	{
-		m_edgeList.emplace_back(p1, p2);
-		m_edgeMap.insert({ key, &m_edgeList.back() });
+		for (int i = 0; i < m_addedFaceVec.size(); i++)
+			CollectConflict(m_addedFaceVec[i], m_addedFaceSourceVec[i].first, m_addedFaceSourceVec[i].second);
 	}
 
-	m_edgeMap[key]->LinkFace(&newFace);
+	// Linking is serial and in face order, so the result does not depend on the thread pool.
+	for (int f : m_addedFaceVec)
+	{
+		for (const Conflict& c : m_faceConflictVec[f])
+			LinkConflict(f, c);
+	}
 }
 
-void VMACH::ConvexHull::AddPointToHull(const ConvexHullVertex& point)
+void VMACH::ConvexHull::AddPointToHull(int point)
 {
-	// Find the illuminated (will be removed) faces.
-	bool atLeastOneVisible = false;
-	for (ConvexHullFace& face : m_faceList)
+	// 1. Find the illuminated (will be removed) faces from the conflict graph.
+	// Faces removed by the former insertions are still listed, skip them.
+	for (int node = m_pointConflictHead[point]; node != -1; node = m_pointConflictPool[node].Next)
 	{
-		if (Volume(face, point) < 0)
-		{
-			face.Visible = true;
-			m_visibleFaceVec.push_back(&face);
+		const int f = m_pointConflictPool[node].Face;
+		if (m_faceVec[f].Visible)
+			continue;
 
-			atLeastOneVisible = true;
-		}
+		m_faceVec[f].Visible = true;
+		m_visibleFaceVec.push_back(f);
 	}
 
-	if (FALSE == atLeastOneVisible)
+	m_pointConflictHead[point] = -1;
+
+	if (m_visibleFaceVec.empty())
 		return;
 
-	// Check edges. If needed, add faces.
-	for (auto itr = m_edgeList.begin(); itr != m_edgeList.end(); itr++)
+	// 2. Check edges around the visible faces, in creation order. If needed, add faces.
+	for (int f : m_visibleFaceVec)
+		m_horizonEdgeVec.insert(m_horizonEdgeVec.end(), std::begin(m_faceVec[f].EdgeID), std::end(m_faceVec[f].EdgeID));
+
+	std::sort(m_horizonEdgeVec.begin(), m_horizonEdgeVec.end());
+	m_horizonEdgeVec.erase(std::unique(m_horizonEdgeVec.begin(), m_horizonEdgeVec.end()), m_horizonEdgeVec.end());
+
+	for (int e : m_horizonEdgeVec)
 	{
-		auto& edge = *itr;
-		auto& face1 = edge.Face1;
-		auto& face2 = edge.Face2;
+		// Edge array grows in CreateFace, do not hold the reference.
+		int face1 = m_edgeVec[e].Face1;
+		int face2 = m_edgeVec[e].Face2;
 
-		if (face1 == nullptr || face2 == nullptr)
+		if (face1 == -1 || face2 == -1)
 			continue;
-		else if (face1->Visible && face2->Visible)
-			edge.Remove = true;
-		else if (face1->Visible || face2->Visible)
+		else if (m_faceVec[face1].Visible && m_faceVec[face2].Visible)
+			m_edgeVec[e].Remove = true;
+		else if (m_faceVec[face1].Visible || m_faceVec[face2].Visible)
 		{
-			if (face1->Visible)
+			if (m_faceVec[face1].Visible)
+			{
+				std::swap(m_edgeVec[e].Face1, m_edgeVec[e].Face2);
 				std::swap(face1, face2);
+			}
+
+			// New face replaces the visible face at this edge, so it follows the winding of the visible face.
+			// Unlike a test against the inner point, this does not flip when the points are coplanar.
+			const bool rewind = FALSE == SameWinding(m_faceVec[face2], m_edgeVec[e]);
+			m_edgeVec[e].EraseFace(face2);
+
+			CreateFace(m_edgeVec[e].EndPointID[0], m_edgeVec[e].EndPointID[1], point, rewind);
+			m_addedFaceSourceVec.push_back({ face1, face2 });
+		}
+	}
+
+	// 3. Collect conflicts of the added faces.
+	UpdateAddedFaceConflict();
+
+	// 4. Take off the volume of the removed faces.
+	for (int f : m_visibleFaceVec)
+	{
+		for (const Conflict& c : m_faceConflictVec[f])
+		{
+			if (m_pointCloud[c.ID].Processed)
+				continue;
 
-			ConvexHullVertex innerPoint = FindInnerPoint(face2, edge);
-			edge.EraseFace(face2);
+			// No conflict is left, drop the accumulated rounding error too.
+			if (--m_pointConflictCnt[c.ID] == 0)
+				m_pointVolume[c.ID] = 0.0f;
+			else
+				m_pointVolume[c.ID] -= c.Volume;
 
-			CreateFace(edge.EndPoints[0], edge.EndPoints[1], point, innerPoint);
+			MarkChanged(c.ID);
 		}
 	}
+
+	// 5. Push the new volume of the changed points. Former entries of them become stale.
+	// If most of the points are changed, rebuilding is cheaper and drops the stale entries too.
+	if (FALSE == m_useVolumeHeap)
+		return;
+
+	if (m_changedPointVec.size() * 4 > m_pointCloud.size() - m_processedPointCnt)
+		BuildVolumeHeap();
+	else
+	{
+		for (int i : m_changedPointVec)
+		{
+			if (FALSE == m_pointCloud[i].Processed)
+				m_volumeHeap.push({ m_pointVolume[i], i });
+		}
+	}
+}
+
+void VMACH::ConvexHull::BuildVolumeHeap()
+{
+	std::vector<VolumeEntry> entryVec;
+	entryVec.reserve(m_pointCloud.size() - m_processedPointCnt);
+
+	for (int i = 0; i < m_pointCloud.size(); i++)
+	{
+		if (FALSE == m_pointCloud[i].Processed)
+			entryVec.push_back({ m_pointVolume[i], i });
+	}
+
+	m_volumeHeap = std::priority_queue<VolumeEntry>(std::less<VolumeEntry>(), std::move(entryVec));
+}
+
+bool VMACH::ConvexHull::PopMaxVolumePoint(int& point)
+{
+	if (FALSE == m_useVolumeHeap)
+	{
+		// Processed points are at -FLT_MAX.
+		if (m_processedPointCnt == m_pointCloud.size())
+			return false;
+
+		point = (int)std::distance(m_pointVolume.begin(), std::max_element(m_pointVolume.begin(), m_pointVolume.end()));
+		return true;
+	}
+
+	while (FALSE == m_volumeHeap.empty())
+	{
+		const VolumeEntry entry = m_volumeHeap.top();
+		m_volumeHeap.pop();
+
+		if (m_pointCloud[entry.Point].Processed || entry.Volume != m_pointVolume[entry.Point])
+			continue;
+
+		point = entry.Point;
+		return true;
+	}
+
+	return false;
 }
 
 bool VMACH::ConvexHull::BuildFirstHull()
@@ -1039,99 +1298,116 @@ bool VMACH::ConvexHull::BuildFirstHull()
 	if (m_pointCloud.size() <= 3)
 		return false;
 
+	// Index of the first point that maximizes the key. (same as std::max_element)
+	auto findMaxPoint = [&](auto key)
+	{
+		int maxIndex = 0;
+		auto maxKey = key(m_pointCloud[0]);
+
+		for (int i = 1; i < m_pointCloud.size(); i++)
+		{
+			const auto k = key(m_pointCloud[i]);
+			if (maxKey < k)
+			{
+				maxIndex = i;
+				maxKey = k;
+			}
+		}
+
+		return maxIndex;
+	};
+
 	// Find x max point.
-	const auto v1 = std::max_element(std::begin(m_pointCloud), std::end(m_pointCloud),
-									 [](const ConvexHullVertex& a, const ConvexHullVertex& b) { return a.x < b.x; });
+	const int v1 = findMaxPoint([](const ConvexHullVertex& a) { return a.x; });
 
 	// Find length max point.
-	const auto v2 = std::max_element(
-		std::begin(m_pointCloud), std::end(m_pointCloud), [&](const ConvexHullVertex& a, const ConvexHullVertex& b)
- {
-	 return std::sqrt(pow((a.x - (*v1).x), 2) + pow((a.y - (*v1).y), 2) + pow((a.z - (*v1).z), 2)) <
-		 std::sqrt(pow((b.x - (*v1).x), 2) + pow((b.y - (*v1).y), 2) + pow((b.z - (*v1).z), 2));
+	const int v2 = findMaxPoint([&](const ConvexHullVertex& a)
+		{
+			const Vector3 d = a - m_pointCloud[v1];
+			return (double)d.x * d.x + (double)d.y * d.y + (double)d.z * d.z;
 		});
 
 	// Find area max point.
-	const auto v3 = std::max_element(std::begin(m_pointCloud), std::end(m_pointCloud),
-									 [&](const ConvexHullVertex& a, const ConvexHullVertex& b)
- {
-	 ConvexHullFace f1(*v1, *v2, a);
-	 ConvexHullFace f2(*v1, *v2, b);
-	 return f1.CalcArea() < f2.CalcArea();
-									 });
+	const int v3 = findMaxPoint([&](const ConvexHullVertex& a)
+		{
+			const Vector3 d1 = m_pointCloud[v2] - m_pointCloud[v1];
+			const Vector3 d2 = a - m_pointCloud[v1];
+			return d1.Cross(d2).LengthSquared();
+		});
 
 	// Find volume max point.
-	const auto v4 = std::max_element(std::begin(m_pointCloud), std::end(m_pointCloud),
-									 [&](const ConvexHullVertex& a, const ConvexHullVertex& b)
- {
-	 ConvexHullFace f(*v1, *v2, *v3);
-	 return Volume(f, a) < Volume(f, b);
-									 });
-
-	(*v1).Processed = true;
-	(*v2).Processed = true;
-	(*v3).Processed = true;
-	(*v4).Processed = true;
+	const ConvexHullFace baseFace(m_pointCloud, v1, v2, v3);
+	const int v4 = findMaxPoint([&](const ConvexHullVertex& a) { return Volume(baseFace, a); });
+
+	m_pointCloud[v1].Processed = true;
+	m_pointCloud[v2].Processed = true;
+	m_pointCloud[v3].Processed = true;
+	m_pointCloud[v4].Processed = true;
 
 	m_processedPointCnt = 4;
 
-	// Create tetrahedron.
-	CreateFace(*v1, *v2, *v3, *v4);
-	CreateFace(*v1, *v2, *v4, *v3);
-	CreateFace(*v1, *v3, *v4, *v2);
-	CreateFace(*v2, *v3, *v4, *v1);
+	// Create tetrahedron. If needed, rewind face.
+	auto createFirstFace = [&](int p1, int p2, int p3, int innerPoint)
+	{
+		ConvexHullFace face(m_pointCloud, p1, p2, p3);
+		CreateFace(p1, p2, p3, Volume(face, m_pointCloud[innerPoint]) < 0);
+		m_addedFaceSourceVec.push_back({ -1, -1 });
+	};
+
+	createFirstFace(v1, v2, v3, v4);
+	createFirstFace(v1, v2, v4, v3);
+	createFirstFace(v1, v3, v4, v2);
+	createFirstFace(v2, v3, v4, v1);
 
 	return true;
 }
 
 void VMACH::ConvexHull::CreateConvexHull()
 {
+	m_pointVolume = std::vector<float>(m_pointCloud.size(), 0.0f);
+	m_pointConflictHead = std::vector<int>(m_pointCloud.size(), -1);
+	m_pointConflictPool.reserve(4 * m_pointCloud.size());
+	m_pointConflictCnt = std::vector<int>(m_pointCloud.size(), 0);
+	m_pointMark = std::vector<int>(m_pointCloud.size(), -1);
+
+	// Closed triangle mesh has 3 * V - 6 edges.
+	const size_t hullPointCnt = m_limitCnt == 0 ? m_pointCloud.size() : std::min<size_t>(m_limitCnt, m_pointCloud.size());
+	m_edgeMap.Reserve(3 * hullPointCnt);
+
 	if (!BuildFirstHull())
 		return;
 
-	// Init volume values.
-	for (int i = 0; i < m_pointCloud.size(); i++)
-	{
-		if (m_pointCloud[i].Processed)
-			continue;
+	// Init conflict graph and volume values.
+	// Volume of a point is the sum of the visible volumes, which is the volume it would add to the hull.
+	UpdateAddedFaceConflict();
 
-		for (const ConvexHullFace& f : m_faceList)
-			m_pointVolume[i] += std::max(0.0f, Volume(f, m_pointCloud[i]));
-	}
+	m_addedFaceVec.clear();
+	m_addedFaceSourceVec.clear();
+	m_changedPointVec.clear();
 
 	if (m_limitCnt == 0)
 		m_limitCnt = m_pointCloud.size();
 
+	// Few insertions are cheaper with a linear search than keeping the heap up to date.
+	m_useVolumeHeap = (size_t)m_limitCnt * VolumeHeapRatio > m_pointCloud.size();
+	if (m_useVolumeHeap)
+		BuildVolumeHeap();
+
 	// Do until specified count is met.
 	while (m_processedPointCnt < m_limitCnt)
 	{
 		// Greedy algorithm.
-		// Find point index that maximizes volume.
-		int k = std::distance(m_pointVolume.begin(), std::max_element(m_pointVolume.begin(), m_pointVolume.end()));
+		// Find point index that maximizes volume. Nothing is left to add if every point is processed.
+		int k;
+		if (FALSE == PopMaxVolumePoint(k))
+			break;
 
-		AddPointToHull(m_pointCloud[k]);
 		m_pointCloud[k].Processed = true;
 		m_pointVolume[k] = -FLT_MAX;
 
 		m_processedPointCnt++;
 
-		// Apply changes to volume values.
-		for (int i = 0; i < m_pointCloud.size(); i++)
-		{
-			if (m_pointCloud[i].Processed)
-				continue;
-
-			float removedMaxVol = 0.0f;
-			for (int j = 0; j < m_visibleFaceVec.size(); j++)
-				removedMaxVol += std::max(0.0f, Volume(*m_visibleFaceVec[j], m_pointCloud[i]));
-
-			float addedMaxVol = 0.0f;
-			for (int j = 0; j < m_addedFaceVec.size(); j++)
-				addedMaxVol += std::max(0.0f, Volume(*m_addedFaceVec[j], m_pointCloud[i]));
-
-			m_pointVolume[i] -= removedMaxVol;
-			m_pointVolume[i] += addedMaxVol;
-		}
+		AddPointToHull(k);
 
 		CleanUp();
 	}
@@ -1139,37 +1415,46 @@ void VMACH::ConvexHull::CreateConvexHull()
 
 void VMACH::ConvexHull::CleanUp()
 {
-	m_visibleFaceVec.clear();
-	m_addedFaceVec.clear();
-
-	// Erase flagged edges.
-	auto itr = m_edgeList.begin();
-	while (itr != m_edgeList.end())
+	// Release flagged edges from the map. Only the edges around the removed faces can be flagged.
+	for (int e : m_horizonEdgeVec)
 	{
-		if (itr->Remove)
-		{
-			size_t key = Key2Edge(itr->EndPoints[0], itr->EndPoints[1]);
-			m_edgeMap.erase(key);
-			m_edgeList.erase(itr++);
-		}
-		else
-			itr++;
-	};
+		if (m_edgeVec[e].Remove)
+			m_edgeMap.Erase(m_edgeVec[e].EndPointID[0], m_edgeVec[e].EndPointID[1]);
+	}
 
-	// Erase flagged faces.
-	std::erase_if(m_faceList, [](const ConvexHullFace& f) { return f.Visible; });
+	// Removed faces never come back, drop their conflicts.
+	for (int f : m_visibleFaceVec)
+		m_faceConflictVec[f] = {};
+
+	m_visibleFaceVec.clear();
+	m_addedFaceVec.clear();
+	m_addedFaceSourceVec.clear();
+	m_changedPointVec.clear();
+	m_horizonEdgeVec.clear();
 }
 
 VMACH::ConvexHullFace::ConvexHullFace(const ConvexHullVertex& p1, const ConvexHullVertex& p2,
 									  const ConvexHullVertex& p3)
-	: Visible(false)
+	: Visible(false), VertexID{ -1, -1, -1 }, EdgeID{ -1, -1, -1 }
 {
 	Vertices[0] = p1;
 	Vertices[1] = p2;
 	Vertices[2] = p3;
 }
 
-void VMACH::ConvexHullFace::Rewind() { std::swap(Vertices[0], Vertices[2]); }
+VMACH::ConvexHullFace::ConvexHullFace(const std::vector<ConvexHullVertex>& pointCloud, int p1, int p2, int p3)
+	: ConvexHullFace(pointCloud[p1], pointCloud[p2], pointCloud[p3])
+{
+	VertexID[0] = p1;
+	VertexID[1] = p2;
+	VertexID[2] = p3;
+}
+
+void VMACH::ConvexHullFace::Rewind()
+{
+	std::swap(Vertices[0], Vertices[2]);
+	std::swap(VertexID[0], VertexID[2]);
+}
 
 float VMACH::ConvexHullFace::CalcArea()
 {
@@ -1179,27 +1464,531 @@ float VMACH::ConvexHullFace::CalcArea()
 	return 0.5f * d1.Cross(d2).Length();
 }
 
-VMACH::ConvexHullEdge::ConvexHullEdge(const ConvexHullVertex& p1, const ConvexHullVertex& p2)
-	: Face1(nullptr), Face2(nullptr), Remove(false)
+VMACH::ConvexHullEdge::ConvexHullEdge(const std::vector<ConvexHullVertex>& pointCloud, int p1, int p2)
+	: Face1(-1), Face2(-1), Remove(false)
 {
-	EndPoints[0] = p1;
-	EndPoints[1] = p2;
+	EndPointID[0] = p1;
+	EndPointID[1] = p2;
+	EndPoints[0] = pointCloud[p1];
+	EndPoints[1] = pointCloud[p2];
 }
 
-void VMACH::ConvexHullEdge::LinkFace(ConvexHullFace* face)
+void VMACH::ConvexHullEdge::LinkFace(int face)
 {
-	if (Face1 != nullptr && Face2 != nullptr)
+	if (Face1 != -1 && Face2 != -1)
 		return;
 
-	(Face1 == nullptr ? Face1 : Face2) = face;
+	(Face1 == -1 ? Face1 : Face2) = face;
 }
 
-void VMACH::ConvexHullEdge::EraseFace(ConvexHullFace* face)
+void VMACH::ConvexHullEdge::EraseFace(int face)
 {
 	if (Face1 != face && Face2 != face)
 		return;
 
-	(Face1 == face ? Face1 : Face2) = nullptr;
+	(Face1 == face ? Face1 : Face2) = -1;
+}
+
+int VMACH::ConvexHullEdgeMap::Find(int p1, int p2) const
+{
+	if (m_slotVec.empty())
+		return -1;
+
+	const uint64_t key = MakeKey(p1, p2);
+	const size_t mask = m_slotVec.size() - 1;
+
+	for (size_t i = Home(key);; i = (i + 1) & mask)
+	{
+		if (m_slotVec[i].Key == key)
+			return m_slotVec[i].Edge;
+		if (m_slotVec[i].Key == EmptyKey)
+			return -1;
+	}
+}
+
+void VMACH::ConvexHullEdgeMap::Insert(int p1, int p2, int edge)
+{
+	// Keep load factor under 0.5.
+	if ((m_count + 1) * 2 > m_slotVec.size())
+		Reserve(std::max<size_t>(m_count + 1, m_slotVec.size()));
+
+	const uint64_t key = MakeKey(p1, p2);
+	const size_t mask = m_slotVec.size() - 1;
+
+	size_t i = Home(key);
+	while (m_slotVec[i].Key != EmptyKey && m_slotVec[i].Key != key)
+		i = (i + 1) & mask;
+
+	if (m_slotVec[i].Key == EmptyKey)
+		m_count++;
+
+	m_slotVec[i] = { key, edge };
+}
+
+void VMACH::ConvexHullEdgeMap::Erase(int p1, int p2)
+{
+	if (m_slotVec.empty())
+		return;
+
+	const uint64_t key = MakeKey(p1, p2);
+	const size_t mask = m_slotVec.size() - 1;
+
+	size_t i = Home(key);
+	while (m_slotVec[i].Key != key)
+	{
+		if (m_slotVec[i].Key == EmptyKey)
+			return;
+
+		i = (i + 1) & mask;
+	}
+
+	// Shift back the following slots of the cluster, which would be unreachable otherwise.
+	for (size_t j = (i + 1) & mask; m_slotVec[j].Key != EmptyKey; j = (j + 1) & mask)
+	{
+		const size_t home = Home(m_slotVec[j].Key);
+		if (((j - home) & mask) >= ((j - i) & mask))
+		{
+			m_slotVec[i] = m_slotVec[j];
+			i = j;
+		}
+	}
+
+	m_slotVec[i] = {};
+	m_count--;
+}
+
+void VMACH::ConvexHullEdgeMap::Reserve(size_t count)
+{
+	size_t capacity = 16;
+	while (capacity < count * 2)
+		capacity <<= 1;
+
+	if (capacity <= m_slotVec.size())
+		return;
+
+	std::vector<Slot> oldSlotVec(capacity);
+	oldSlotVec.swap(m_slotVec);
+	const size_t mask = capacity - 1;
+
+	for (const Slot& slot : oldSlotVec)
+	{
+		if (slot.Key == EmptyKey)
+			continue;
+
+		size_t i = Home(slot.Key);
+		while (m_slotVec[i].Key != EmptyKey)
+			i = (i + 1) & mask;
+
+		m_slotVec[i] = slot;
+	}
+}
+
+uint64_t VMACH::ConvexHullEdgeMap::MakeKey(int p1, int p2)
+{
+	if (p1 > p2)
+		std::swap(p1, p2);
+
+	return ((uint64_t)(uint32_t)p1 << 32) | (uint32_t)p2;
+}
+
+size_t VMACH::ConvexHullEdgeMap::Home(uint64_t key) const
+{
+	// Fibonacci hashing, high bits are the best mixed.
+	const uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+	return (size_t)(hash >> 32) & (m_slotVec.size() - 1);
+}
+
+VMACH::QuickHull::QuickHull(const std::vector<Vector3>& pointCloud)
+	: m_pointCnt(pointCloud.size())
+{
+	m_X.resize(m_pointCnt);
+	m_Y.resize(m_pointCnt);
+	m_Z.resize(m_pointCnt);
+	for (size_t i = 0; i < m_pointCnt; i++)
+	{
+		m_X[i] = pointCloud[i].x;
+		m_Y[i] = pointCloud[i].y;
+		m_Z[i] = pointCloud[i].z;
+	}
+
+	if (FALSE == CreateQuickHull())
+	{
+		m_hullPointIDVec.resize(m_pointCnt);
+		std::iota(m_hullPointIDVec.begin(), m_hullPointIDVec.end(), 0);
+		return;
+	}
+
+	// Collect the vertices of the remaining faces.
+	std::vector<bool> hullPoint(m_pointCnt, false);
+	for (const Face& f : m_faceVec)
+	{
+		if (f.Remove)
+			continue;
+
+		for (int i = 0; i < 3; i++)
+			hullPoint[f.VertexID[i]] = true;
+	}
+
+	for (int i = 0; i < m_pointCnt; i++)
+	{
+		if (hullPoint[i])
+			m_hullPointIDVec.push_back(i);
+	}
+}
+
+float VMACH::QuickHull::Distance(const Face& face, int point) const
+{
+	return face.Normal.x * m_X[point] + face.Normal.y * m_Y[point] + face.Normal.z * m_Z[point] + face.Offset;
+}
+
+int VMACH::QuickHull::FindMaxDotPoint(const Vector3& direction) const
+{
+	// Index of the first point that maximizes the dot product. (same as std::max_element)
+	const int    n = (int)m_pointCnt;
+	const float* px = m_X.data();
+	const float* py = m_Y.data();
+	const float* pz = m_Z.data();
+
+	int   maxIndex = 0;
+	float maxDot = -FLT_MAX;
+	int   i = 0;
+
+#ifdef VMACH_USE_SSE
+	if (n >= 4)
+	{
+		const __m128  vdx = _mm_set1_ps(direction.x), vdy = _mm_set1_ps(direction.y), vdz = _mm_set1_ps(direction.z);
+		const __m128i four = _mm_set1_epi32(4);
+		__m128        laneMax = _mm_set1_ps(-FLT_MAX);
+		__m128i       laneIndex = _mm_setzero_si128();
+		__m128i       index = _mm_setr_epi32(0, 1, 2, 3);
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vdx, _mm_loadu_ps(px + i)), _mm_mul_ps(vdy, _mm_loadu_ps(py + i))),
+										  _mm_mul_ps(vdz, _mm_loadu_ps(pz + i)));
+
+			// Strictly greater, so each lane keeps its first maximum.
+			const __m128 greater = _mm_cmpgt_ps(dot, laneMax);
+			laneMax = _mm_or_ps(_mm_and_ps(greater, dot), _mm_andnot_ps(greater, laneMax));
+			laneIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(greater), index), _mm_andnot_si128(_mm_castps_si128(greater), laneIndex));
+			index = _mm_add_epi32(index, four);
+		}
+
+		float lanes[4];
+		int   laneIndices[4];
+		_mm_storeu_ps(lanes, laneMax);
+		_mm_storeu_si128((__m128i*)laneIndices, laneIndex);
+
+		// Ties between lanes go to the lower index.
+		for (int l = 0; l < 4; l++)
+		{
+			if (maxDot < lanes[l] || (maxDot == lanes[l] && laneIndices[l] < maxIndex))
+			{
+				maxDot = lanes[l];
+				maxIndex = laneIndices[l];
+			}
+		}
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		const float dot = (direction.x * px[i] + direction.y * py[i]) + direction.z * pz[i];
+		if (maxDot < dot)
+		{
+			maxDot = dot;
+			maxIndex = i;
+		}
+	}
+
+	return maxIndex;
+}
+
+int VMACH::QuickHull::CreateFace(int p1, int p2, int p3)
+{
+	const Vector3 a(m_X[p1], m_Y[p1], m_Z[p1]);
+	const Vector3 b(m_X[p2], m_Y[p2], m_Z[p2]);
+	const Vector3 c(m_X[p3], m_Y[p3], m_Z[p3]);
+
+	Face face;
+	face.Remove = false;
+	face.VertexID[0] = p1;
+	face.VertexID[1] = p2;
+	face.VertexID[2] = p3;
+	face.AdjFace[0] = face.AdjFace[1] = face.AdjFace[2] = -1;
+	face.Normal = (b - a).Cross(c - a);
+	face.Normal.Normalize();
+	face.Offset = -face.Normal.Dot(a);
+	face.OutsideHead = -1;
+	face.FurthestPoint = -1;
+	face.FurthestDist = 0.0f;
+
+	m_faceVec.push_back(face);
+	m_faceMark.push_back(-1);
+
+	return (int)m_faceVec.size() - 1;
+}
+
+void VMACH::QuickHull::AssignPoint(const std::vector<int>& faceVec, int point)
+{
+	// First face the point is outside of. If none, the point is inside or on the hull.
+	for (int f : faceVec)
+	{
+		const float dist = Distance(m_faceVec[f], point);
+		if (dist <= m_epsilon)
+			continue;
+
+		Face& face = m_faceVec[f];
+		m_outsideNext[point] = face.OutsideHead;
+		face.OutsideHead = point;
+
+		if (face.FurthestDist < dist)
+		{
+			face.FurthestDist = dist;
+			face.FurthestPoint = point;
+		}
+
+		return;
+	}
+}
+
+bool VMACH::QuickHull::BuildFirstHull()
+{
+	// Not enough points!
+	if (m_pointCnt <= 3)
+		return false;
+
+	auto position = [&](int point) { return Vector3(m_X[point], m_Y[point], m_Z[point]); };
+
+	// Extreme points along the axes.
+	const int extreme[6] = { FindMaxDotPoint(Vector3(+1, 0, 0)), FindMaxDotPoint(Vector3(-1, 0, 0)),
+							 FindMaxDotPoint(Vector3(0, +1, 0)), FindMaxDotPoint(Vector3(0, -1, 0)),
+							 FindMaxDotPoint(Vector3(0, 0, +1)), FindMaxDotPoint(Vector3(0, 0, -1)) };
+
+	// Tolerance grows with the magnitude of the coordinates.
+	const float maxX = std::max(std::abs(m_X[extreme[0]]), std::abs(m_X[extreme[1]]));
+	const float maxY = std::max(std::abs(m_Y[extreme[2]]), std::abs(m_Y[extreme[3]]));
+	const float maxZ = std::max(std::abs(m_Z[extreme[4]]), std::abs(m_Z[extreme[5]]));
+	m_epsilon = 3.0f * FLT_EPSILON * (maxX + maxY + maxZ);
+
+	// Find the farthest pair of extreme points.
+	int   v1 = extreme[0];
+	int   v2 = extreme[1];
+	float maxLengthSq = 0.0f;
+	for (int i = 0; i < 6; i++)
+	{
+		for (int j = i + 1; j < 6; j++)
+		{
+			const float lengthSq = (position(extreme[i]) - position(extreme[j])).LengthSquared();
+			if (maxLengthSq < lengthSq)
+			{
+				v1 = extreme[i];
+				v2 = extreme[j];
+				maxLengthSq = lengthSq;
+			}
+		}
+	}
+
+	if (std::sqrt(maxLengthSq) <= m_epsilon)
+		return false;
+
+	// Find the farthest point from the line.
+	const Vector3 lineDir = position(v2) - position(v1);
+	int           v3 = -1;
+	float         maxAreaSq = 0.0f;
+	for (int i = 0; i < m_pointCnt; i++)
+	{
+		const float areaSq = lineDir.Cross(position(i) - position(v1)).LengthSquared();
+		if (maxAreaSq < areaSq)
+		{
+			v3 = i;
+			maxAreaSq = areaSq;
+		}
+	}
+
+	if (v3 == -1 || std::sqrt(maxAreaSq / maxLengthSq) <= m_epsilon)
+		return false;
+
+	// Find the farthest point from the plane, on either side.
+	Vector3 normal = lineDir.Cross(position(v3) - position(v1));
+	normal.Normalize();
+
+	const int   above = FindMaxDotPoint(normal);
+	const int   below = FindMaxDotPoint(-normal);
+	const float aboveDist = normal.Dot(position(above) - position(v1));
+	const float belowDist = normal.Dot(position(v1) - position(below));
+	const int   v4 = aboveDist >= belowDist ? above : below;
+
+	if (std::max(aboveDist, belowDist) <= m_epsilon)
+		return false;
+
+	// Base face looks away from the apex, and the others share its edges in reverse.
+	if (v4 == above)
+		std::swap(v2, v3);
+
+	CreateFace(v1, v2, v3);
+	CreateFace(v2, v1, v4);
+	CreateFace(v3, v2, v4);
+	CreateFace(v1, v3, v4);
+
+	for (Face& f : m_faceVec)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			const int p1 = f.VertexID[i];
+			const int p2 = f.VertexID[(i + 1) % 3];
+			for (int g = 0; g < 4; g++)
+			{
+				const Face& other = m_faceVec[g];
+				for (int j = 0; j < 3; j++)
+				{
+					if (other.VertexID[j] == p2 && other.VertexID[(j + 1) % 3] == p1)
+						f.AdjFace[i] = g;
+				}
+			}
+		}
+	}
+
+	m_outsideNext = std::vector<int>(m_pointCnt, -1);
+	m_coneFace = std::vector<int>(m_pointCnt, -1);
+
+	const std::vector<int> firstFaceVec = { 0, 1, 2, 3 };
+	for (int i = 0; i < m_pointCnt; i++)
+	{
+		if (i != v1 && i != v2 && i != v3 && i != v4)
+			AssignPoint(firstFaceVec, i);
+	}
+
+	for (int f : firstFaceVec)
+	{
+		if (m_faceVec[f].OutsideHead != -1)
+			m_pendingFaceVec.push_back(f);
+	}
+
+	return true;
+}
+
+bool VMACH::QuickHull::AddPointToHull(int face)
+{
+	const int eye = m_faceVec[face].FurthestPoint;
+
+	// 1. Find visible faces, connected to the given one. Visible faces are flagged as removed.
+	m_visibleFaceVec.clear();
+	m_visibleFaceVec.push_back(face);
+	m_faceVec[face].Remove = true;
+	m_faceMark[face] = eye;
+
+	for (int i = 0; i < m_visibleFaceVec.size(); i++)
+	{
+		for (int adj : m_faceVec[m_visibleFaceVec[i]].AdjFace)
+		{
+			if (m_faceMark[adj] == eye)
+				continue;
+
+			m_faceMark[adj] = eye;
+			if (Distance(m_faceVec[adj], eye) > 0.0f)
+			{
+				m_faceVec[adj].Remove = true;
+				m_visibleFaceVec.push_back(adj);
+			}
+		}
+	}
+
+	// 2. Connect the eye to each horizon edge, keeping the winding of the visible face.
+	m_addedFaceVec.clear();
+	for (int v : m_visibleFaceVec)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			const int adj = m_faceVec[v].AdjFace[i];
+			if (m_faceVec[adj].Remove)
+				continue;
+
+			const int p1 = m_faceVec[v].VertexID[i];
+			const int p2 = m_faceVec[v].VertexID[(i + 1) % 3];
+
+			// Visible region is not a disk.
+			if (m_coneFace[p1] != -1)
+				return false;
+
+			const int newFace = CreateFace(p1, p2, eye);
+			m_faceVec[newFace].AdjFace[0] = adj;
+
+			Face& neighbor = m_faceVec[adj];
+			for (int j = 0; j < 3; j++)
+			{
+				if (neighbor.VertexID[j] == p2 && neighbor.VertexID[(j + 1) % 3] == p1)
+					neighbor.AdjFace[j] = newFace;
+			}
+
+			m_coneFace[p1] = newFace;
+			m_addedFaceVec.push_back(newFace);
+		}
+	}
+
+	// 3. Link the added faces around the eye. Face (p1, p2, eye) meets the one starting at p2.
+	bool closed = true;
+	for (int f : m_addedFaceVec)
+	{
+		const int next = m_coneFace[m_faceVec[f].VertexID[1]];
+		if (next == -1)
+		{
+			closed = false;
+			continue;
+		}
+
+		m_faceVec[f].AdjFace[1] = next;
+		m_faceVec[next].AdjFace[2] = f;
+	}
+
+	for (int f : m_addedFaceVec)
+		m_coneFace[m_faceVec[f].VertexID[0]] = -1;
+
+	if (FALSE == closed)
+		return false;
+
+	// 4. Hand over the outside points of the removed faces.
+	for (int v : m_visibleFaceVec)
+	{
+		for (int p = m_faceVec[v].OutsideHead; p != -1;)
+		{
+			const int next = m_outsideNext[p];
+			if (p != eye)
+				AssignPoint(m_addedFaceVec, p);
+
+			p = next;
+		}
+
+		m_faceVec[v].OutsideHead = -1;
+	}
+
+	for (int f : m_addedFaceVec)
+	{
+		if (m_faceVec[f].OutsideHead != -1)
+			m_pendingFaceVec.push_back(f);
+	}
+
+	return true;
+}
+
+bool VMACH::QuickHull::CreateQuickHull()
+{
+	if (FALSE == BuildFirstHull())
+		return false;
+
+	while (FALSE == m_pendingFaceVec.empty())
+	{
+		const int face = m_pendingFaceVec.back();
+		m_pendingFaceVec.pop_back();
+
+		// Removed, or its points are handed over already.
+		if (m_faceVec[face].Remove || m_faceVec[face].OutsideHead == -1)
+			continue;
+
+		if (FALSE == AddPointToHull(face))
+			return false;
+	}
+
+	return true;
 }
 
 bool VMACH::NearlyEqual(const Vector3& v1, const Vector3& v2) { return (v1 - v2).Length() < EPSILON; }
@@ -1274,13 +2063,13 @@ bool VMACH::GetIntersectionPoint(const Vector3& p1, const Vector3& p2, const Pla
 	return true;
 }
 
-void VMACH::RenderEdge(std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData)
+void VMACH::RenderEdge(const ClipDebugSink& debugSink, std::vector<VertexNormalColor>& vertexData, std::vector<uint32_t>& indexData)
 {
-	for (int e = 0; e < globalEdgeContainer.size(); e++)
+	for (int e = 0; e < debugSink.EdgeVec.size(); e++)
 	{
-		vertexData.push_back(VertexNormalColor(globalEdgeContainer[e].VertexVec[0], XMFLOAT3(), Vector3(1, 0, 0)));
-		vertexData.push_back(VertexNormalColor(globalEdgeContainer[e].VertexVec[1], XMFLOAT3(), Vector3(1, 0, 0)));
-		vertexData.push_back(VertexNormalColor(globalEdgeContainer[e].VertexVec[1] + Vector3(-0.01, 0.01, -0.01),
+		vertexData.push_back(VertexNormalColor(debugSink.EdgeVec[e].VertexVec[0], XMFLOAT3(), Vector3(1, 0, 0)));
+		vertexData.push_back(VertexNormalColor(debugSink.EdgeVec[e].VertexVec[1], XMFLOAT3(), Vector3(1, 0, 0)));
+		vertexData.push_back(VertexNormalColor(debugSink.EdgeVec[e].VertexVec[1] + Vector3(-0.01, 0.01, -0.01),
 											   XMFLOAT3(), Vector3(1, 0, 0)));
 
 		indexData.push_back(indexData.size());
@@ -1288,11 +2077,11 @@ void VMACH::RenderEdge(std::vector<VertexNormalColor>& vertexData, std::vector<u
 		indexData.push_back(indexData.size());
 	}
 
-	for (int e = 0; e < globalPointContainer.size(); e++)
+	for (int e = 0; e < debugSink.PointVec.size(); e++)
 	{
 		Polygon3D boxPoly = VMACH::GetBoxPolygon();
 		boxPoly.Scale(0.001);
-		boxPoly.Translate(globalPointContainer[e]);
+		boxPoly.Translate(debugSink.PointVec[e]);
 		boxPoly.Render(vertexData, indexData, Vector3(0, 1, 0));
 	}
 }
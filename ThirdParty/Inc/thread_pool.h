@@ -1,21 +1,34 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <barrier>
+#include <chrono>
 #include <concepts>
 #include <deque>
 #include <functional>
 #include <future>
+#include <latch>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <semaphore>
 #include <thread>
 #include <type_traits>
+#include <vector>
 #ifdef __has_include
 #    if __has_include(<version>)
 #        include <version>
 #    endif
 #endif
 
+#if defined(_WIN32)
+#    include <Windows.h>
+#elif defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#endif
+
 #include "thread_safe_queue.h"
 
 namespace dp
@@ -30,6 +43,23 @@ using default_function_type = std::function<void()>;
 #endif
 }  // namespace details
 
+/**
+ * @brief Counters of one worker, since the pool was started or the counters were reset.
+ */
+struct worker_stats
+{
+    /// tasks run by the worker, stolen ones included
+    std::uint64_t tasks_executed = 0;
+    /// tasks taken from the queue of another worker
+    std::uint64_t tasks_stolen = 0;
+    /// time spent waiting for a signal
+    std::chrono::nanoseconds idle_time {};
+    /// tasks in the queue of the worker right now
+    std::size_t queue_depth = 0;
+    /// deepest the queue of the worker has been
+    std::size_t max_queue_depth = 0;
+};
+
 template <typename FunctionType = details::default_function_type,
     typename ThreadType = std::jthread>
     requires std::invocable<FunctionType>&&
@@ -37,84 +67,91 @@ template <typename FunctionType = details::default_function_type,
     class thread_pool
 {
 public:
-    explicit thread_pool(
-        const unsigned int& number_of_threads = std::thread::hardware_concurrency())
-        : tasks_(number_of_threads)
-    {
-        std::size_t current_id = 0;
-        for (std::size_t i = 0; i < number_of_threads; ++i)
-        {
-            priority_queue_.push_back(size_t(current_id));
-            try
-            {
-                threads_.emplace_back([&, id = current_id](const std::stop_token& stop_tok)
-{
-    do
+    /**
+     * @param number_of_threads Worker count, 0 uses the hardware concurrency.
+     * @param pin_threads Pin each worker to one logical processor, in worker order.
+     */
+    explicit thread_pool(const unsigned int& number_of_threads = std::thread::hardware_concurrency(),
+        bool pin_threads = false)
     {
-        // wait until signaled
-        tasks_[id].signal.acquire();
-
-        do
-        {
-            // invoke the task
-            while (auto task = tasks_[id].tasks.pop_front())
-            {
-                try
-                {
-                    pending_tasks_.fetch_sub(1, std::memory_order_release);
-                    std::invoke(std::move(task.value()));
-                }
-                catch (...)
-                {
-                }
-            }
-
-            // try to steal a task
-            for (std::size_t j = 1; j < tasks_.size(); ++j)
-            {
-                const std::size_t index = (id + j) % tasks_.size();
-                if (auto task = tasks_[index].tasks.steal())
-                {
-                    // steal a task
-                    pending_tasks_.fetch_sub(1, std::memory_order_release);
-                    std::invoke(std::move(task.value()));
-                    // stop stealing once we have invoked a stolen task
-                    break;
-                }
-            }
-
-        } while (pending_tasks_.load(std::memory_order_acquire) > 0);
+        start(number_of_threads, pin_threads);
+    }
 
-        priority_queue_.rotate_to_front(id);
+    ~thread_pool() { stop(); }
 
-    } while (!stop_tok.stop_requested());
-                });
-                // increment the thread id
-                ++current_id;
-
-            }
-            catch (...)
-            {
-                // catch all
+    /**
+     * @brief Stop the workers and start the given number of them.
+     * @details The pool must be idle, no task may be queued or running, and no other thread
+     * may use the pool meanwhile. Counters are reset.
+     * @param number_of_threads Worker count, 0 uses the hardware concurrency.
+     * @param pin_threads Pin each worker to one logical processor, in worker order.
+     */
+    void reset(const unsigned int& number_of_threads, bool pin_threads = false)
+    {
+        stop();
+        start(number_of_threads, pin_threads);
+    }
 
-                // remove one item from the tasks
-                tasks_.pop_back();
+    /**
+     * @brief Counters of each worker, in worker order.
+     * @details Each counter is read on its own while the workers run, so they are only
+     * consistent with each other when the pool is idle.
+     */
+    [[nodiscard]] std::vector<worker_stats> stats() const
+    {
+        std::vector<worker_stats> result(tasks_.size());
+        for (std::size_t i = 0; i < tasks_.size(); ++i)
+        {
+            const task_item& item = tasks_[i];
+            result[i].tasks_executed = item.tasks_executed.load(std::memory_order_relaxed);
+            result[i].tasks_stolen = item.tasks_stolen.load(std::memory_order_relaxed);
+            result[i].idle_time =
+                std::chrono::nanoseconds(item.idle_ns.load(std::memory_order_relaxed));
+            result[i].queue_depth = item.tasks.size();
+            result[i].max_queue_depth = item.max_queue_depth.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
 
-                // remove our thread from the priority queue
-                std::ignore = priority_queue_.pop_back();
-            }
+    /**
+     * @brief Zero the counters of every worker.
+     */
+    void reset_stats()
+    {
+        for (task_item& item : tasks_)
+        {
+            item.tasks_executed.store(0, std::memory_order_relaxed);
+            item.tasks_stolen.store(0, std::memory_order_relaxed);
+            item.idle_ns.store(0, std::memory_order_relaxed);
+            item.max_queue_depth.store(item.tasks.size(), std::memory_order_relaxed);
         }
     }
 
-    ~thread_pool()
+    /**
+     * @brief Whether the calling thread is a worker of this pool.
+     */
+    [[nodiscard]] bool is_worker_thread() const { return current_pool_ == this; }
+
+    /**
+     * @brief Wait for a future of this pool and get its value.
+     * @details A worker of the pool runs queued tasks while it waits, so a task waiting for
+     * another one cannot starve the pool. Other threads just wait.
+     * @param future A future returned by enqueue.
+     */
+    template <typename ReturnType>
+    ReturnType wait(std::future<ReturnType>& future)
     {
-        // stop all threads
-        for (std::size_t i = 0; i < threads_.size(); ++i)
+        if (is_worker_thread())
         {
-            threads_[i].request_stop();
-            tasks_[i].signal.release();
-            threads_[i].join();
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                if (!run_queued_task(current_worker_id_))
+                {
+                    std::this_thread::yield();
+                }
+            }
         }
+        return future.get();
     }
 
     /// thread pool is non-copyable
@@ -228,9 +265,311 @@ public:
         }));
     }
 
+    /**
+     * @brief Invoke a function for every index of [first, last) in the thread pool and wait for
+     * all of them.
+     * @details Indices are split into chunks, which are claimed one by one by at most one task per
+     * thread and by the calling thread. The function is taken by reference and never copied, and
+     * the whole loop waits on a single latch. Tasks that start after the loop is done return right
+     * away, so this does not wait for a busy pool. The first exception thrown is rethrown.
+     * @tparam Function An invokable type taking the index.
+     * @param first First index.
+     * @param last One past the last index.
+     * @param func The callable to be executed for each index.
+     * @param chunk_size Indices per chunk, 0 picks about 4 chunks per thread.
+     */
+    template <typename Function>
+    requires std::invocable<Function&, std::size_t>
+    void parallel_for(std::size_t first, std::size_t last, Function&& func,
+        std::size_t chunk_size = 0)
+    {
+        if (first >= last)
+        {
+            return;
+        }
+
+        const std::size_t count = last - first;
+        if (chunk_size == 0)
+        {
+            chunk_size = (std::max)(std::size_t(1), count / ((std::max)(std::size_t(1), size()) * 4));
+        }
+
+        const std::size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        if (chunk_count == 1 || size() == 0)
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                func(i);
+            }
+            return;
+        }
+
+        // shared with the tasks, which may outlive this call if they start late
+        struct loop_state
+        {
+            explicit loop_state(std::ptrdiff_t chunks) : done(chunks) {}
+
+            std::atomic_size_t next_chunk {};
+            std::latch done;
+            std::mutex exception_mutex;
+            std::exception_ptr exception;
+        };
+        auto state = std::make_shared<loop_state>(static_cast<std::ptrdiff_t>(chunk_count));
+
+        // the function is only reached through a claimed chunk, while the caller still waits
+        auto* body = &func;
+        auto run_chunks = [state, body, first, last, chunk_size, chunk_count]() {
+            for (std::size_t chunk = state->next_chunk.fetch_add(1); chunk < chunk_count;
+                 chunk = state->next_chunk.fetch_add(1))
+            {
+                try
+                {
+                    const std::size_t chunk_first = first + chunk * chunk_size;
+                    const std::size_t chunk_last = (std::min)(chunk_first + chunk_size, last);
+                    for (std::size_t i = chunk_first; i < chunk_last; ++i)
+                    {
+                        (*body)(i);
+                    }
+                }
+                catch (...)
+                {
+                    std::scoped_lock lock(state->exception_mutex);
+                    if (!state->exception)
+                    {
+                        state->exception = std::current_exception();
+                    }
+                }
+                state->done.count_down();
+            }
+        };
+
+        const std::size_t task_count = (std::min)(chunk_count - 1, size());
+        for (std::size_t i = 0; i < task_count; ++i)
+        {
+            enqueue_task(run_chunks);
+        }
+
+        run_chunks();
+        state->done.wait();
+
+        if (state->exception)
+        {
+            std::rethrow_exception(state->exception);
+        }
+    }
+
+    /**
+     * @brief Invoke a function for every index of [first, last) in the thread pool and collect
+     * the results in index order.
+     * @details Same as parallel_for, each result is written to its own slot of the output.
+     * @tparam Function An invokable type taking the index.
+     * @tparam ReturnType The return type of the Function
+     * @param first First index.
+     * @param last One past the last index.
+     * @param func The callable to be executed for each index.
+     * @param chunk_size Indices per chunk, 0 picks about 4 chunks per thread.
+     * @return A std::vector<ReturnType> with the result of func(first + i) at i.
+     */
+    template <typename Function,
+        typename ReturnType = std::invoke_result_t<Function&, std::size_t>>
+    requires std::invocable<Function&, std::size_t>
+    [[nodiscard]] std::vector<ReturnType> parallel_map(std::size_t first, std::size_t last,
+        Function&& func, std::size_t chunk_size = 0)
+    {
+        const std::size_t count = first < last ? last - first : 0;
+        if constexpr (std::is_default_constructible_v<ReturnType>)
+        {
+            std::vector<ReturnType> result(count);
+            parallel_for(
+                first, last, [&](std::size_t i) { result[i - first] = func(i); }, chunk_size);
+            return result;
+        }
+        else
+        {
+            std::vector<std::optional<ReturnType>> slots(count);
+            parallel_for(
+                first, last, [&](std::size_t i) { slots[i - first].emplace(func(i)); },
+                chunk_size);
+
+            std::vector<ReturnType> result;
+            result.reserve(count);
+            for (std::optional<ReturnType>& slot : slots)
+            {
+                result.push_back(std::move(*slot));
+            }
+            return result;
+        }
+    }
+
     [[nodiscard]] auto size() const { return threads_.size(); }
 
 private:
+    void start(unsigned int number_of_threads, bool pin_threads)
+    {
+        if (number_of_threads == 0)
+        {
+            number_of_threads = (std::max)(1u, std::thread::hardware_concurrency());
+        }
+
+        std::deque<task_item>(number_of_threads).swap(tasks_);
+        pending_tasks_.store(0, std::memory_order_relaxed);
+
+        std::size_t current_id = 0;
+        for (std::size_t i = 0; i < number_of_threads; ++i)
+        {
+            priority_queue_.push_back(size_t(current_id));
+            try
+            {
+                threads_.emplace_back([&, id = current_id](const std::stop_token& stop_tok) {
+                    current_pool_ = this;
+                    current_worker_id_ = id;
+                    worker_loop(id, stop_tok);
+                });
+
+                if (pin_threads)
+                {
+                    pin_thread(threads_.back(), current_id);
+                }
+
+                // increment the thread id
+                ++current_id;
+            }
+            catch (...)
+            {
+                // catch all
+
+                // remove one item from the tasks
+                tasks_.pop_back();
+
+                // remove our thread from the priority queue
+                std::ignore = priority_queue_.pop_back();
+            }
+        }
+    }
+
+    void stop()
+    {
+        // stop all threads
+        for (std::size_t i = 0; i < threads_.size(); ++i)
+        {
+            threads_[i].request_stop();
+            tasks_[i].signal.release();
+            threads_[i].join();
+        }
+
+        threads_.clear();
+        while (priority_queue_.pop_back())
+        {
+        }
+    }
+
+    void worker_loop(const std::size_t id, const std::stop_token& stop_tok)
+    {
+        task_item& item = tasks_[id];
+        do
+        {
+            // wait until signaled
+            const auto idle_start = std::chrono::steady_clock::now();
+            item.signal.acquire();
+            item.idle_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - idle_start)
+                    .count(),
+                std::memory_order_relaxed);
+
+            do
+            {
+                // invoke the task
+                while (auto task = item.tasks.pop_front())
+                {
+                    try
+                    {
+                        pending_tasks_.fetch_sub(1, std::memory_order_release);
+                        item.tasks_executed.fetch_add(1, std::memory_order_relaxed);
+                        std::invoke(std::move(task.value()));
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+
+                // try to steal a task
+                for (std::size_t j = 1; j < tasks_.size(); ++j)
+                {
+                    const std::size_t index = (id + j) % tasks_.size();
+                    if (auto task = tasks_[index].tasks.steal())
+                    {
+                        // steal a task
+                        pending_tasks_.fetch_sub(1, std::memory_order_release);
+                        item.tasks_executed.fetch_add(1, std::memory_order_relaxed);
+                        item.tasks_stolen.fetch_add(1, std::memory_order_relaxed);
+                        try
+                        {
+                            std::invoke(std::move(task.value()));
+                        }
+                        catch (...)
+                        {
+                        }
+                        // stop stealing once we have invoked a stolen task
+                        break;
+                    }
+                }
+
+            } while (pending_tasks_.load(std::memory_order_acquire) > 0);
+
+            priority_queue_.rotate_to_front(id);
+
+        } while (!stop_tok.stop_requested());
+    }
+
+    // runs one task of the own queue, or steals one, returns false if there is none
+    bool run_queued_task(const std::size_t id)
+    {
+        for (std::size_t j = 0; j < tasks_.size(); ++j)
+        {
+            const std::size_t index = (id + j) % tasks_.size();
+            auto task = j == 0 ? tasks_[index].tasks.pop_front() : tasks_[index].tasks.steal();
+            if (!task)
+            {
+                continue;
+            }
+
+            pending_tasks_.fetch_sub(1, std::memory_order_release);
+            tasks_[id].tasks_executed.fetch_add(1, std::memory_order_relaxed);
+            if (j != 0)
+            {
+                tasks_[id].tasks_stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+            try
+            {
+                std::invoke(std::move(task.value()));
+            }
+            catch (...)
+            {
+            }
+            return true;
+        }
+        return false;
+    }
+
+    static void pin_thread(ThreadType& thread, const std::size_t id)
+    {
+        // failing to pin leaves the thread to the scheduler
+#if defined(_WIN32)
+        // only the processor group of the process, up to 64 logical processors
+        const std::size_t bits = sizeof(DWORD_PTR) * 8;
+        std::ignore = SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (id % bits));
+#elif defined(__linux__)
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(id % (std::max)(1u, std::thread::hardware_concurrency()), &cpu_set);
+        std::ignore = pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+        std::ignore = thread;
+        std::ignore = id;
+#endif
+    }
+
     template <typename Function>
     void enqueue_task(Function&& f)
     {
@@ -242,7 +581,14 @@ private:
         }
         auto i = *(i_opt);
         pending_tasks_.fetch_add(1, std::memory_order_relaxed);
-        tasks_[i].tasks.push_back(std::forward<Function>(f));
+        const std::size_t depth = tasks_[i].tasks.push_back(std::forward<Function>(f));
+
+        std::size_t max_depth = tasks_[i].max_queue_depth.load(std::memory_order_relaxed);
+        while (max_depth < depth &&
+            !tasks_[i].max_queue_depth.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed))
+        {
+        }
+
         tasks_[i].signal.release();
     }
 
@@ -250,8 +596,15 @@ private:
     {
         dp::thread_safe_queue<FunctionType> tasks {};
         std::binary_semaphore signal { 0 };
+        std::atomic_uint64_t tasks_executed {};
+        std::atomic_uint64_t tasks_stolen {};
+        std::atomic_int64_t idle_ns {};
+        std::atomic_size_t max_queue_depth {};
     };
 
+    static inline thread_local const thread_pool* current_pool_ = nullptr;
+    static inline thread_local std::size_t current_worker_id_ = 0;
+
     std::vector<ThreadType> threads_;
     std::deque<task_item> tasks_;
     dp::thread_safe_queue<std::size_t> priority_queue_;
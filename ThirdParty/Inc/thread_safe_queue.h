@@ -32,10 +32,12 @@ public:
 
     thread_safe_queue() = default;
 
-    void push_back(T&& value)
+    /// returns the size of the queue after the push
+    size_type push_back(T&& value)
     {
         std::scoped_lock lock(mutex_);
         data_.push_back(std::forward<T>(value));
+        return data_.size();
     }
 
     void push_front(T&& value)
@@ -50,6 +52,12 @@ public:
         return data_.empty();
     }
 
+    [[nodiscard]] size_type size() const
+    {
+        std::scoped_lock lock(mutex_);
+        return data_.size();
+    }
+
     [[nodiscard]] std::optional<T> pop_front()
     {
         std::scoped_lock lock(mutex_);